@@ -0,0 +1,56 @@
+#ifndef CHILD_PROCESS_H
+#define CHILD_PROCESS_H
+
+#include <stddef.h>
+#include <type_traits>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+namespace bench
+{
+
+/// @brief 在fork出来的子进程中运行func 通过管道把结果传回父进程
+/// 各个内存池之间的缓存状态和RSS互不影响 子进程的地址空间限制为memLimitMb(0表示不限制)
+/// 超出限制的运行记为失败 不会触发整机的OOM
+/// @param memLimitMb 子进程地址空间上限
+/// @param func 返回Result的函数
+/// @param result 子进程的结果
+/// @return bool 子进程是否正常结束并传回了结果
+template <typename Result, typename Func>
+bool runInChild(size_t memLimitMb, Func&& func, Result& result)
+{
+    static_assert(std::is_trivially_copyable<Result>::value, "result is copied through a pipe");
+
+    int fds[2];
+    if (pipe(fds) != 0)
+        return false;
+
+    pid_t pid = fork();
+    if (pid < 0)
+        return false;
+    if (pid == 0)
+    {
+        close(fds[0]);
+        if (memLimitMb)
+        {
+            struct rlimit limit;
+            limit.rlim_cur = limit.rlim_max = static_cast<rlim_t>(memLimitMb) * 1024 * 1024;
+            setrlimit(RLIMIT_AS, &limit);
+        }
+        Result res = func();
+        ssize_t written = write(fds[1], &res, sizeof(res));
+        _exit(written == sizeof(res) ? 0 : 1);
+    }
+
+    close(fds[1]);
+    ssize_t n = read(fds[0], &result, sizeof(result));
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return n == sizeof(result) && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+}
+
+#endif // CHILD_PROCESS_H
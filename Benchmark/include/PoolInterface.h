@@ -0,0 +1,38 @@
+#ifndef POOL_INTERFACE_H
+#define POOL_INTERFACE_H
+
+#include <stddef.h>
+#include <vector>
+
+// 各个版本的内存池都使用同名的命名空间和类 不能出现在同一个编译单元中
+// 每个版本单独编译一个适配文件 通过这里的函数指针接口统一调用
+namespace bench
+{
+
+struct PoolInterface
+{
+    const char* name;
+
+    // 进程内只调用一次 不需要初始化的内存池为空函数
+    void (*init)();
+
+    void* (*allocate)(size_t size);
+
+    void (*deallocate)(void* ptr, size_t size);
+};
+
+PoolInterface v1CasPool();
+PoolInterface v1MutexPool();
+PoolInterface v2Pool();
+PoolInterface v3Pool();
+PoolInterface systemMalloc();
+
+/// @brief 所有参与对比的内存池 系统malloc作为基准
+inline std::vector<PoolInterface> allPools()
+{
+    return {v1CasPool(), v1MutexPool(), v2Pool(), v3Pool(), systemMalloc()};
+}
+
+}
+
+#endif // POOL_INTERFACE_H
@@ -0,0 +1,17 @@
+#include "PoolInterface.h"
+#include <cstdlib>
+
+namespace bench
+{
+
+PoolInterface systemMalloc()
+{
+    return {
+        "malloc",
+        []() {},
+        [](size_t size) { return malloc(size); },
+        [](void* ptr, size_t) { free(ptr); },
+    };
+}
+
+}
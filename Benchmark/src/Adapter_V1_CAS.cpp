@@ -0,0 +1,17 @@
+#include "PoolInterface.h"
+#include "MemoryPool_CAS.h"
+
+namespace bench
+{
+
+PoolInterface v1CasPool()
+{
+    return {
+        "v1_cas",
+        []() {},
+        [](size_t size) { return memory_pool_CAS::HashBucket::allocate(size); },
+        [](void* ptr, size_t size) { memory_pool_CAS::HashBucket::deallocate(ptr, size); },
+    };
+}
+
+}
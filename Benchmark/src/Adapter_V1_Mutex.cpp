@@ -0,0 +1,18 @@
+// 编译时定义 memory_pool=memory_pool_v1 与Version_2/Version_3的同名命名空间区分
+#include "PoolInterface.h"
+#include "MemoryPool_mutex.h"
+
+namespace bench
+{
+
+PoolInterface v1MutexPool()
+{
+    return {
+        "v1_mutex",
+        []() {},
+        [](size_t size) { return memory_pool::HashBucket::allocate(size); },
+        [](void* ptr, size_t size) { memory_pool::HashBucket::deallocate(ptr, size); },
+    };
+}
+
+}
@@ -0,0 +1,18 @@
+// 编译时定义 memory_pool=memory_pool_v3
+#include "PoolInterface.h"
+#include "MemoryPool.h"
+
+namespace bench
+{
+
+PoolInterface v3Pool()
+{
+    return {
+        "v3",
+        []() {},
+        [](size_t size) { return memory_pool::MemoryPool::allocate(size); },
+        [](void* ptr, size_t size) { memory_pool::MemoryPool::deallocate(ptr, size); },
+    };
+}
+
+}
@@ -0,0 +1,303 @@
+/**
+ * 统一的内存池基准测试
+ * 对Version_1(CAS/互斥锁)、Version_2、Version_3以及系统malloc使用相同的负载
+ * 输出每次操作延迟的p50/p99/p999(rdtsc计时)、吞吐量以及峰值RSS 结果为CSV格式
+ *
+ * 用法: memoryPool_benchmark [--threads N] [--ops N] [--live N] [--pools a,b] [--dists a,b] [--mem-limit MB]
+ * 线程数从1开始按2的幂增加到N 每一种(内存池, 大小分布, 线程数)组合都在fork出来的子进程中运行
+ * 这样各个内存池之间的缓存状态和RSS互不影响 子进程的地址空间限制为mem-limit(0表示不限制)
+ * 超出限制的组合记为失败 不会触发整机的OOM
+ */
+#include "PoolInterface.h"
+#include "ChildProcess.h"
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <sys/resource.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+using namespace bench;
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+
+// 每隔多少次操作记录一次延迟 计时本身的开销不计入吞吐量之外的操作
+constexpr int sampleInterval = 8;
+
+struct Options
+{
+    int maxThreads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    size_t opsPerThread = 500000;
+    size_t liveObjects = 4096;
+    size_t memLimitMb = 4096;
+    std::vector<std::string> pools;
+    std::vector<std::string> dists = {"small", "mixed", "large"};
+};
+
+// 读取时间戳 x86上使用rdtsc 其他平台退化为steady_clock
+inline uint64_t readTicks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+#endif
+}
+
+// 每个tick对应的纳秒数
+double ticksToNs()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    auto start = Clock::now();
+    uint64_t t0 = readTicks();
+    while (Clock::now() - start < std::chrono::milliseconds(100))
+        ;
+    uint64_t t1 = readTicks();
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    return ns / static_cast<double>(t1 - t0);
+#else
+    return 1.0;
+#endif
+}
+
+/// @brief 按照分布生成申请大小
+/// small: 8~512均匀分布 全部落在Version_1的哈希桶范围内
+/// mixed: 80% 8~256, 15% 257~4096, 5% 4097~32768 接近一般程序的对象大小分布
+/// large: 4KB~256KB均匀分布 主要考察页面缓存
+std::vector<size_t> generateSizes(const std::string& dist, size_t count, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::vector<size_t> sizes(count);
+    for (size_t& size : sizes)
+    {
+        if (dist == "small")
+        {
+            size = std::uniform_int_distribution<size_t>(8, 512)(rng);
+        }
+        else if (dist == "mixed")
+        {
+            int p = std::uniform_int_distribution<int>(0, 99)(rng);
+            if (p < 80)
+                size = std::uniform_int_distribution<size_t>(8, 256)(rng);
+            else if (p < 95)
+                size = std::uniform_int_distribution<size_t>(257, 4096)(rng);
+            else
+                size = std::uniform_int_distribution<size_t>(4097, 32768)(rng);
+        }
+        else
+        {
+            size = std::uniform_int_distribution<size_t>(4096, 256 * 1024)(rng);
+        }
+    }
+    return sizes;
+}
+
+struct ThreadResult
+{
+    std::vector<uint64_t> latencies;
+};
+
+/// @brief 单个线程的负载 维护liveObjects个存活对象 每次操作随机替换其中一个(先释放再申请)
+void threadTask(const PoolInterface& pool, const std::vector<size_t>& sizes, size_t liveObjects,
+                std::atomic<int>& ready, const std::atomic<bool>& go, ThreadResult& result)
+{
+    std::vector<std::pair<void*, size_t>> slots(liveObjects, {nullptr, 0});
+    std::vector<uint32_t> order(sizes.size());
+    std::mt19937 rng(static_cast<uint32_t>(sizes.size() ^ sizes[0]));
+    for (uint32_t& idx : order)
+        idx = static_cast<uint32_t>(rng() % liveObjects);
+
+    result.latencies.reserve(sizes.size() * 2 / sampleInterval + 2);
+
+    ready.fetch_add(1);
+    while (!go.load(std::memory_order_acquire))
+        std::this_thread::yield();
+
+    for (size_t i = 0; i < sizes.size(); ++i)
+    {
+        auto& slot = slots[order[i]];
+        bool sample = i % sampleInterval == 0;
+
+        if (slot.first)
+        {
+            if (sample)
+            {
+                uint64_t t0 = readTicks();
+                pool.deallocate(slot.first, slot.second);
+                result.latencies.push_back(readTicks() - t0);
+            }
+            else
+            {
+                pool.deallocate(slot.first, slot.second);
+            }
+        }
+
+        size_t size = sizes[i];
+        void* ptr;
+        if (sample)
+        {
+            uint64_t t0 = readTicks();
+            ptr = pool.allocate(size);
+            result.latencies.push_back(readTicks() - t0);
+        }
+        else
+        {
+            ptr = pool.allocate(size);
+        }
+        // 写入首字节 保证内存真的被使用
+        *static_cast<volatile char*>(ptr) = static_cast<char>(i);
+        slot = {ptr, size};
+    }
+
+    for (auto& slot : slots)
+    {
+        if (slot.first)
+            pool.deallocate(slot.first, slot.second);
+    }
+}
+
+struct RunResult
+{
+    double throughput = 0;  // 百万次操作每秒 一次申请和一次释放各计一次
+    double p50 = 0;
+    double p99 = 0;
+    double p999 = 0;
+    long peakRssKb = 0;
+};
+
+RunResult runConfig(const PoolInterface& pool, const std::string& dist, int threadNums, const Options& opt, double nsPerTick)
+{
+    pool.init();
+
+    std::vector<std::vector<size_t>> sizes;
+    for (int i = 0; i < threadNums; ++i)
+        sizes.push_back(generateSizes(dist, opt.opsPerThread, 12345u + i));
+
+    std::vector<ThreadResult> results(threadNums);
+    std::vector<std::thread> threads;
+    std::atomic<int> ready{0};
+    std::atomic<bool> go{false};
+    for (int i = 0; i < threadNums; ++i)
+        threads.emplace_back(threadTask, std::cref(pool), std::cref(sizes[i]), opt.liveObjects,
+                             std::ref(ready), std::cref(go), std::ref(results[i]));
+    while (ready.load() < threadNums)
+        std::this_thread::yield();
+
+    auto start = Clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& t : threads)
+        t.join();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::vector<uint64_t> all;
+    for (auto& r : results)
+        all.insert(all.end(), r.latencies.begin(), r.latencies.end());
+    std::sort(all.begin(), all.end());
+
+    auto percentile = [&](double p) {
+        if (all.empty())
+            return 0.0;
+        size_t idx = std::min(all.size() - 1, static_cast<size_t>(p * all.size()));
+        return all[idx] * nsPerTick;
+    };
+
+    RunResult res;
+    // 第一次填满存活对象时只有申请没有释放 这里近似按照两次操作计算
+    res.throughput = 2.0 * opt.opsPerThread * threadNums / seconds / 1e6;
+    res.p50 = percentile(0.50);
+    res.p99 = percentile(0.99);
+    res.p999 = percentile(0.999);
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    res.peakRssKb = usage.ru_maxrss;
+    return res;
+}
+
+std::vector<std::string> split(const std::string& s)
+{
+    std::vector<std::string> parts;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, ','))
+    {
+        if (!item.empty())
+            parts.push_back(item);
+    }
+    return parts;
+}
+
+Options parseOptions(int argc, char** argv)
+{
+    Options opt;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string key = argv[i];
+        std::string value = argv[i + 1];
+        if (key == "--threads")
+            opt.maxThreads = std::max(1, std::atoi(value.c_str()));
+        else if (key == "--ops")
+            opt.opsPerThread = std::max<size_t>(1, std::strtoull(value.c_str(), nullptr, 10));
+        else if (key == "--live")
+            opt.liveObjects = std::max<size_t>(1, std::strtoull(value.c_str(), nullptr, 10));
+        else if (key == "--mem-limit")
+            opt.memLimitMb = std::strtoull(value.c_str(), nullptr, 10);
+        else if (key == "--pools")
+            opt.pools = split(value);
+        else if (key == "--dists")
+            opt.dists = split(value);
+        else
+            std::cerr << "unknown option " << key << std::endl;
+    }
+    return opt;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    Options opt = parseOptions(argc, argv);
+    double nsPerTick = ticksToNs();
+
+    std::vector<int> threadCounts;
+    for (int t = 1; t < opt.maxThreads; t *= 2)
+        threadCounts.push_back(t);
+    threadCounts.push_back(opt.maxThreads);
+
+    std::cout << "pool,dist,threads,ops_per_thread,throughput_mops,p50_ns,p99_ns,p999_ns,peak_rss_kb" << std::endl;
+    for (const PoolInterface& pool : allPools())
+    {
+        if (!opt.pools.empty() && std::find(opt.pools.begin(), opt.pools.end(), pool.name) == opt.pools.end())
+            continue;
+
+        for (const std::string& dist : opt.dists)
+        {
+            for (int threadNums : threadCounts)
+            {
+                RunResult res;
+                auto run = [&]() { return runConfig(pool, dist, threadNums, opt, nsPerTick); };
+                if (!runInChild(opt.memLimitMb, run, res))
+                {
+                    std::cerr << pool.name << " " << dist << " " << threadNums << " threads failed" << std::endl;
+                    continue;
+                }
+                std::cout << pool.name << "," << dist << "," << threadNums << "," << opt.opsPerThread << ","
+                          << res.throughput << "," << res.p50 << "," << res.p99 << "," << res.p999 << ","
+                          << res.peakRssKb << std::endl;
+            }
+        }
+    }
+    return 0;
+}
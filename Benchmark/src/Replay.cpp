@@ -0,0 +1,307 @@
+/**
+ * 内存申请轨迹回放
+ * 读取TraceRecorder记录的轨迹文件(Version_3定义MEMORY_POOL_TRACE编译, 或者LD_PRELOAD libmemorypool_malloc_trace.so
+ * 并设置MEMPOOL_TRACE_FILE) 在各个版本的内存池以及系统malloc上重放相同的申请释放序列
+ * 输出回放耗时、峰值RSS、峰值存活字节以及碎片率(回放增加的RSS / 峰值存活字节) 结果为CSV格式
+ *
+ * 用法: memoryPool_replay <trace file> [--pools a,b] [--mem-limit MB]
+ * 轨迹中的每个线程对应一个回放线程 每个线程按照时间顺序执行自己的操作
+ * 跨线程释放时 释放线程会等待对应的申请完成 保证回放的因果顺序与记录时一致
+ */
+#include "PoolInterface.h"
+#include "ChildProcess.h"
+#include "TraceFormat.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+using namespace bench;
+using namespace memory_pool;
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+
+struct Options
+{
+    std::string tracePath;
+    size_t memLimitMb = 4096;
+    std::vector<std::string> pools;
+};
+
+// 回放使用的操作 地址替换为从0开始的对象编号
+struct ReplayOp
+{
+    uint32_t id;
+    uint8_t op;
+};
+
+struct Trace
+{
+    std::vector<std::vector<ReplayOp>> threadOps;
+    std::vector<uint32_t> objectSizes;     // 按照对象编号保存申请大小 释放时使用
+    size_t opNums = 0;
+    size_t droppedNums = 0;                // 找不到对应申请的释放(开始记录之前申请的内存)
+    size_t peakLiveBytes = 0;
+};
+
+/// @brief 读取轨迹文件 按照时间戳合并各个线程的记录并把地址转换为对象编号
+/// @param path 轨迹文件路径
+/// @param trace 读取结果
+/// @return bool 文件格式是否正确
+bool loadTrace(const std::string& path, Trace& trace)
+{
+    /**
+     * 整体流程:
+     * 校验文件头 读出所有数据块;
+     * 按照时间戳排序 时间戳相同时释放在前 (记录时释放在调用之前、申请在调用之后打时间戳);
+     * 顺序扫描 申请时分配新的对象编号 释放时查找地址当前对应的编号 找不到的释放丢弃;
+     * 同时统计存活字节的峰值 作为计算碎片率的基准;
+     */
+    std::ifstream file(path, std::ios::binary);
+    TraceFileHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+        return false;
+    if (memcmp(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0 || header.version != TRACE_VERSION ||
+        header.recordSize != sizeof(TraceRecord))
+        return false;
+
+    struct Event
+    {
+        TraceRecord record;
+        uint32_t threadId;
+    };
+    std::vector<Event> events;
+
+    TraceChunkHeader chunk;
+    std::vector<TraceRecord> records;
+    while (file.read(reinterpret_cast<char*>(&chunk), sizeof(chunk)))
+    {
+        records.resize(chunk.recordNums);
+        if (!file.read(reinterpret_cast<char*>(records.data()), sizeof(TraceRecord) * chunk.recordNums))
+            return false;
+        for (const TraceRecord& record : records)
+            events.push_back({record, chunk.threadId});
+    }
+
+    std::stable_sort(events.begin(), events.end(), [](const Event& a, const Event& b) {
+        if (a.record.timestamp != b.record.timestamp)
+            return a.record.timestamp < b.record.timestamp;
+        return a.record.op > b.record.op;
+    });
+
+    // 线程编号可能不连续(线程没有任何记录) 重新编号
+    std::unordered_map<uint32_t, uint32_t> threadIndex;
+    std::unordered_map<uint64_t, uint32_t> liveObjects;
+    size_t liveBytes = 0;
+    for (const Event& event : events)
+    {
+        auto [it, inserted] = threadIndex.try_emplace(event.threadId, static_cast<uint32_t>(threadIndex.size()));
+        if (inserted)
+            trace.threadOps.emplace_back();
+        std::vector<ReplayOp>& ops = trace.threadOps[it->second];
+
+        if (event.record.op == TRACE_ALLOCATE)
+        {
+            uint32_t id = static_cast<uint32_t>(trace.objectSizes.size());
+            trace.objectSizes.push_back(event.record.size);
+            // 同一地址没有释放就再次被申请 说明释放没有被记录 旧对象按照泄漏处理
+            liveObjects[event.record.ptr] = id;
+            liveBytes += event.record.size;
+            trace.peakLiveBytes = std::max(trace.peakLiveBytes, liveBytes);
+            ops.push_back({id, TRACE_ALLOCATE});
+        }
+        else
+        {
+            auto live = liveObjects.find(event.record.ptr);
+            if (live == liveObjects.end())
+            {
+                trace.droppedNums++;
+                continue;
+            }
+            uint32_t id = live->second;
+            liveObjects.erase(live);
+            liveBytes -= trace.objectSizes[id];
+            ops.push_back({id, TRACE_DEALLOCATE});
+        }
+        trace.opNums++;
+    }
+    return true;
+}
+
+// 当前进程的RSS 单位KB
+long currentRssKb()
+{
+    std::ifstream statm("/proc/self/statm");
+    long pages = 0;
+    long rssPages = 0;
+    statm >> pages >> rssPages;
+    return rssPages * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+// 当前进程的RSS峰值 单位KB
+long peakRssKb()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+struct ReplayResult
+{
+    double seconds = 0;
+    long peakRssKb = 0;
+    long rssGrowthKb = 0;   // 回放期间RSS峰值相对回放前的增长
+};
+
+/// @brief 单个回放线程 跨线程释放时等待申请线程写入地址
+void replayThread(const PoolInterface& pool, const Trace& trace, const std::vector<ReplayOp>& ops,
+                  std::atomic<void*>* objects, std::atomic<int>& ready, const std::atomic<bool>& go)
+{
+    ready.fetch_add(1);
+    while (!go.load(std::memory_order_acquire))
+        std::this_thread::yield();
+
+    for (const ReplayOp& op : ops)
+    {
+        size_t size = std::max<uint32_t>(1, trace.objectSizes[op.id]);
+        if (op.op == TRACE_ALLOCATE)
+        {
+            void* ptr = pool.allocate(size);
+            // 写入首字节 保证内存真的被使用
+            *static_cast<volatile char*>(ptr) = 1;
+            objects[op.id].store(ptr, std::memory_order_release);
+        }
+        else
+        {
+            void* ptr;
+            while ((ptr = objects[op.id].load(std::memory_order_acquire)) == nullptr)
+                std::this_thread::yield();
+            pool.deallocate(ptr, size);
+            objects[op.id].store(nullptr, std::memory_order_relaxed);
+        }
+    }
+}
+
+ReplayResult replay(const PoolInterface& pool, const Trace& trace)
+{
+    pool.init();
+
+    std::unique_ptr<std::atomic<void*>[]> objects(new std::atomic<void*>[trace.objectSizes.size()]);
+    for (size_t i = 0; i < trace.objectSizes.size(); ++i)
+        objects[i].store(nullptr, std::memory_order_relaxed);
+
+    std::vector<std::thread> threads;
+    std::atomic<int> ready{0};
+    std::atomic<bool> go{false};
+    for (const std::vector<ReplayOp>& ops : trace.threadOps)
+        threads.emplace_back(replayThread, std::cref(pool), std::cref(trace), std::cref(ops),
+                             objects.get(), std::ref(ready), std::cref(go));
+    int threadNums = static_cast<int>(threads.size());
+    while (ready.load() < threadNums)
+        std::this_thread::yield();
+
+    long baseRssKb = currentRssKb();
+    auto start = Clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& t : threads)
+        t.join();
+
+    ReplayResult res;
+    res.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    res.peakRssKb = peakRssKb();
+    res.rssGrowthKb = std::max(0L, res.peakRssKb - baseRssKb);
+
+    // 轨迹结束时仍然存活的对象
+    for (size_t i = 0; i < trace.objectSizes.size(); ++i)
+    {
+        void* ptr = objects[i].load(std::memory_order_relaxed);
+        if (ptr)
+            pool.deallocate(ptr, std::max<uint32_t>(1, trace.objectSizes[i]));
+    }
+    return res;
+}
+
+std::vector<std::string> split(const std::string& s)
+{
+    std::vector<std::string> parts;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, ','))
+    {
+        if (!item.empty())
+            parts.push_back(item);
+    }
+    return parts;
+}
+
+bool parseOptions(int argc, char** argv, Options& opt)
+{
+    if (argc < 2)
+        return false;
+    opt.tracePath = argv[1];
+    for (int i = 2; i + 1 < argc; i += 2)
+    {
+        std::string key = argv[i];
+        std::string value = argv[i + 1];
+        if (key == "--mem-limit")
+            opt.memLimitMb = std::strtoull(value.c_str(), nullptr, 10);
+        else if (key == "--pools")
+            opt.pools = split(value);
+        else
+            std::cerr << "unknown option " << key << std::endl;
+    }
+    return true;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    Options opt;
+    if (!parseOptions(argc, argv, opt))
+    {
+        std::cerr << "usage: " << argv[0] << " <trace file> [--pools a,b] [--mem-limit MB]" << std::endl;
+        return 1;
+    }
+
+    Trace trace;
+    if (!loadTrace(opt.tracePath, trace))
+    {
+        std::cerr << "invalid trace file " << opt.tracePath << std::endl;
+        return 1;
+    }
+    std::cerr << "trace: " << trace.opNums << " ops, " << trace.threadOps.size() << " threads, "
+              << trace.droppedNums << " unmatched frees dropped, peak live " << trace.peakLiveBytes / 1024 << " KB"
+              << std::endl;
+
+    long peakLiveKb = std::max<long>(1, static_cast<long>(trace.peakLiveBytes / 1024));
+    std::cout << "pool,threads,ops,seconds,peak_rss_kb,peak_live_kb,fragmentation" << std::endl;
+    for (const PoolInterface& pool : allPools())
+    {
+        if (!opt.pools.empty() && std::find(opt.pools.begin(), opt.pools.end(), pool.name) == opt.pools.end())
+            continue;
+
+        ReplayResult res;
+        if (!runInChild(opt.memLimitMb, [&]() { return replay(pool, trace); }, res))
+        {
+            std::cerr << pool.name << " replay failed" << std::endl;
+            continue;
+        }
+        std::cout << pool.name << "," << trace.threadOps.size() << "," << trace.opNums << "," << res.seconds << ","
+                  << res.peakRssKb << "," << trace.peakLiveBytes / 1024 << ","
+                  << static_cast<double>(res.rssGrowthKb) / peakLiveKb << std::endl;
+    }
+    return 0;
+}
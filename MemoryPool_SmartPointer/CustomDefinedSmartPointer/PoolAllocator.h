@@ -0,0 +1,93 @@
+#ifndef POOL_ALLOCATOR_H
+#define POOL_ALLOCATOR_H
+
+#include "MemoryPool_CAS.h"
+#include <new>
+#include <limits>
+#include <memory>
+#include <cstddef>
+#include <type_traits>
+
+namespace memory_pool_CAS
+{
+
+/// @brief 基于哈希桶内存池的STL分配器 无状态 所有实例之间可以互相释放
+/// 配合std::allocate_shared使用时 控制块和对象位于同一个内存槽中 只需要一次申请
+/// @tparam T 分配的对象类型
+template<class T>
+class PoolAllocator
+{
+public:
+    using value_type = T;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+    using is_always_equal = std::true_type;
+
+    template<class U>
+    struct rebind
+    {
+        using other = PoolAllocator<U>;
+    };
+
+    PoolAllocator() noexcept = default;
+
+    template<class U>
+    PoolAllocator(const PoolAllocator<U>&) noexcept {}
+
+    /// @brief 申请n个对象大小的内存
+    /// 内存槽只保证8字节对齐 对齐要求更高的类型直接使用对齐的operator new
+    T* allocate(size_t n)
+    {
+        if (n > std::numeric_limits<size_t>::max() / sizeof(T))
+            throw std::bad_array_new_length();
+
+        if constexpr (alignof(T) > SLOT_BASE_SIZE)
+            return static_cast<T*>(operator new(n * sizeof(T), std::align_val_t(alignof(T))));
+
+        void* ptr = HashBucket::allocate(n * sizeof(T));
+        if (!ptr)
+            throw std::bad_alloc();
+        return static_cast<T*>(ptr);
+    }
+
+    /// @brief 归还n个对象大小的内存
+    /// @param n 对象数量 需要与allocate时一致
+    void deallocate(T* ptr, size_t n) noexcept
+    {
+        if constexpr (alignof(T) > SLOT_BASE_SIZE)
+        {
+            operator delete(ptr, std::align_val_t(alignof(T)));
+            return;
+        }
+
+        HashBucket::deallocate(ptr, n * sizeof(T));
+    }
+};
+
+template<class T, class U>
+bool operator==(const PoolAllocator<T>&, const PoolAllocator<U>&) noexcept
+{
+    return true;
+}
+
+template<class T, class U>
+bool operator!=(const PoolAllocator<T>&, const PoolAllocator<U>&) noexcept
+{
+    return false;
+}
+
+
+/// @brief 在内存池中创建shared_ptr管理的对象 控制块和对象共用一个内存槽
+template<class T, class... Args>
+std::shared_ptr<T> allocate_shared_from_pool(Args&&... args)
+{
+    return std::allocate_shared<T>(PoolAllocator<T>(), std::forward<Args>(args)...);
+}
+
+};
+
+#endif // POOL_ALLOCATOR_H
@@ -0,0 +1,239 @@
+#ifndef POOL_INTRUSIVE_PTR_H
+#define POOL_INTRUSIVE_PTR_H
+
+#include "MemoryPool_CAS.h"
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <type_traits>
+
+namespace memory_pool_CAS
+{
+
+template<class T>
+class pool_intrusive_ptr;
+
+/// @brief 侵入式引用计数基类 引用计数和对象位于同一个内存槽中 不需要单独的控制块
+/// 同时记录申请时的大小 通过基类指针释放时也能归还到正确的哈希桶
+/// @tparam ThreadSafe 为true时引用计数使用原子操作 只在一个线程内使用的对象可以设为false 避免原子操作的开销
+template<bool ThreadSafe = true>
+class pool_ref_counted
+{
+public:
+    uint32_t use_count() const noexcept
+    {
+        if constexpr (ThreadSafe)
+            return this->m_refCount.load(std::memory_order_relaxed);
+        else
+            return this->m_refCount;
+    }
+
+protected:
+    pool_ref_counted() noexcept = default;
+
+    // 拷贝对象时不拷贝引用计数 新对象的引用由自己的智能指针管理
+    pool_ref_counted(const pool_ref_counted&) noexcept {}
+    pool_ref_counted& operator=(const pool_ref_counted&) noexcept { return *this; }
+
+    ~pool_ref_counted() = default;
+
+private:
+    template<class T>
+    friend class pool_intrusive_ptr;
+
+    void addRef() const noexcept
+    {
+        if constexpr (ThreadSafe)
+            this->m_refCount.fetch_add(1, std::memory_order_relaxed);
+        else
+            ++this->m_refCount;
+    }
+
+    /// @brief 减少引用计数
+    /// @return 是否是最后一个引用
+    bool release() const noexcept
+    {
+        if constexpr (ThreadSafe)
+            return this->m_refCount.fetch_sub(1, std::memory_order_acq_rel) == 1;
+        else
+            return --this->m_refCount == 0;
+    }
+
+private:
+    using Counter = std::conditional_t<ThreadSafe, std::atomic<uint32_t>, uint32_t>;
+
+    mutable Counter m_refCount{0};
+    uint32_t m_slotSize = 0;
+};
+
+
+/**
+ * 侵入式智能指针 对象必须继承pool_ref_counted 并且通过make_pool_intrusive在内存池中创建
+ * 和shared_ptr相比没有控制块 指针本身只有8字节 不支持weak_ptr
+ * 最后一个引用释放时析构对象并归还内存槽 多态类型需要虚析构函数
+ */
+template<class T>
+class pool_intrusive_ptr
+{
+public:
+    using element_type = T;
+
+    constexpr pool_intrusive_ptr() noexcept : m_ptr(nullptr) {}
+    constexpr pool_intrusive_ptr(std::nullptr_t) noexcept : m_ptr(nullptr) {}
+
+    /// @brief 从裸指针构造 增加引用计数 对象必须是通过make_pool_intrusive创建的
+    explicit pool_intrusive_ptr(T* ptr) noexcept : m_ptr(ptr)
+    {
+        if (this->m_ptr)
+        {
+            assert(this->m_ptr->m_slotSize != 0);
+            this->m_ptr->addRef();
+        }
+    }
+
+    pool_intrusive_ptr(const pool_intrusive_ptr& other) noexcept : m_ptr(other.m_ptr)
+    {
+        if (this->m_ptr)
+            this->m_ptr->addRef();
+    }
+
+    pool_intrusive_ptr(pool_intrusive_ptr&& other) noexcept : m_ptr(other.m_ptr)
+    {
+        other.m_ptr = nullptr;
+    }
+
+    template<class U, class = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+    pool_intrusive_ptr(const pool_intrusive_ptr<U>& other) noexcept : m_ptr(other.get())
+    {
+        static_assert(std::is_same_v<T, U> || std::has_virtual_destructor_v<T>,
+                      "converting to a base pointer requires a virtual destructor");
+        if (this->m_ptr)
+            this->m_ptr->addRef();
+    }
+
+    template<class U, class = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+    pool_intrusive_ptr(pool_intrusive_ptr<U>&& other) noexcept : m_ptr(other.detach())
+    {
+        static_assert(std::is_same_v<T, U> || std::has_virtual_destructor_v<T>,
+                      "converting to a base pointer requires a virtual destructor");
+    }
+
+    ~pool_intrusive_ptr()
+    {
+        this->releasePtr();
+    }
+
+    pool_intrusive_ptr& operator=(const pool_intrusive_ptr& other) noexcept
+    {
+        pool_intrusive_ptr(other).swap(*this);
+        return *this;
+    }
+
+    pool_intrusive_ptr& operator=(pool_intrusive_ptr&& other) noexcept
+    {
+        pool_intrusive_ptr(std::move(other)).swap(*this);
+        return *this;
+    }
+
+    void reset() noexcept
+    {
+        pool_intrusive_ptr().swap(*this);
+    }
+
+    void swap(pool_intrusive_ptr& other) noexcept
+    {
+        std::swap(this->m_ptr, other.m_ptr);
+    }
+
+    /// @brief 放弃所有权但不减少引用计数
+    T* detach() noexcept
+    {
+        T* ptr = this->m_ptr;
+        this->m_ptr = nullptr;
+        return ptr;
+    }
+
+    T* get() const noexcept { return this->m_ptr; }
+    T& operator*() const noexcept { return *this->m_ptr; }
+    T* operator->() const noexcept { return this->m_ptr; }
+    explicit operator bool() const noexcept { return this->m_ptr != nullptr; }
+
+    uint32_t use_count() const noexcept
+    {
+        return this->m_ptr ? this->m_ptr->use_count() : 0;
+    }
+
+    /// @brief 在内存池中创建对象 对象和引用计数只占用一个内存槽
+    template<class... Args>
+    static pool_intrusive_ptr make(Args&&... args)
+    {
+        // 内存槽只保证8字节对齐
+        static_assert(alignof(T) <= SLOT_BASE_SIZE, "over-aligned types are not supported by the pool");
+        static_assert(sizeof(T) <= UINT32_MAX, "object too large");
+
+        void* addr = HashBucket::allocate(sizeof(T));
+        if (!addr)
+            throw std::bad_alloc();
+
+        T* ptr;
+        try
+        {
+            ptr = new (addr) T(std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            HashBucket::deallocate(addr, sizeof(T));
+            throw;
+        }
+        ptr->m_slotSize = sizeof(T);
+        return pool_intrusive_ptr(ptr);
+    }
+
+private:
+    void releasePtr() noexcept
+    {
+        if (!this->m_ptr || !this->m_ptr->release())
+            return;
+
+        // 多态类型通过基类指针释放时 内存槽的起始地址是最终派生类对象的地址
+        size_t size = this->m_ptr->m_slotSize;
+        void* addr;
+        if constexpr (std::is_polymorphic_v<T>)
+            addr = dynamic_cast<void*>(this->m_ptr);
+        else
+            addr = this->m_ptr;
+
+        this->m_ptr->~T();
+        HashBucket::deallocate(addr, size);
+        this->m_ptr = nullptr;
+    }
+
+private:
+    T* m_ptr;
+};
+
+template<class T, class U>
+bool operator==(const pool_intrusive_ptr<T>& a, const pool_intrusive_ptr<U>& b) noexcept
+{
+    return a.get() == b.get();
+}
+
+template<class T, class U>
+bool operator!=(const pool_intrusive_ptr<T>& a, const pool_intrusive_ptr<U>& b) noexcept
+{
+    return a.get() != b.get();
+}
+
+
+/// @brief 在内存池中创建侵入式智能指针管理的对象
+template<class T, class... Args>
+pool_intrusive_ptr<T> make_pool_intrusive(Args&&... args)
+{
+    return pool_intrusive_ptr<T>::make(std::forward<Args>(args)...);
+}
+
+};
+
+#endif // POOL_INTRUSIVE_PTR_H
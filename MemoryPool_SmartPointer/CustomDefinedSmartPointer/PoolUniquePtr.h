@@ -0,0 +1,139 @@
+#ifndef POOL_UNIQUE_PTR_H
+#define POOL_UNIQUE_PTR_H
+
+#include "MemoryPool_CAS.h"
+#include <memory>
+#include <new>
+#include <limits>
+#include <cstddef>
+#include <utility>
+#include <type_traits>
+
+namespace memory_pool_CAS
+{
+
+/// @brief 归还到内存池的删除器 空类 unique_ptr通过空基类优化不占额外空间
+/// 按照sizeof(T)计算哈希桶 所以不提供从派生类删除器的转换 否则会归还到错误的哈希桶
+template<class T>
+struct PoolDeleter
+{
+    constexpr PoolDeleter() noexcept = default;
+
+    void operator()(T* ptr) const noexcept
+    {
+        static_assert(sizeof(T) > 0, "can't delete an incomplete type");
+        ptr->~T();
+        HashBucket::deallocate(ptr, sizeof(T));
+    }
+};
+
+
+/// @brief 数组的删除器 元素个数保存在数组前面的头部中 删除器本身仍然是空类
+template<class T>
+struct PoolDeleter<T[]>
+{
+    // 数组头部 保存元素个数 大小为8字节 不影响元素的对齐
+    struct ArrayHeader
+    {
+        size_t count;
+    };
+
+    constexpr PoolDeleter() noexcept = default;
+
+    static ArrayHeader* headerOf(T* ptr) noexcept
+    {
+        return reinterpret_cast<ArrayHeader*>(reinterpret_cast<char*>(ptr) - sizeof(ArrayHeader));
+    }
+
+    static size_t allocSize(size_t count) noexcept
+    {
+        return sizeof(ArrayHeader) + count * sizeof(T);
+    }
+
+    void operator()(T* ptr) const noexcept
+    {
+        ArrayHeader* header = headerOf(ptr);
+        size_t count = header->count;
+        // 和构造顺序相反
+        for (size_t i = count; i > 0; --i)
+            ptr[i - 1].~T();
+        HashBucket::deallocate(header, allocSize(count));
+    }
+};
+
+
+/// @brief 内存池中对象的独占智能指针 和裸指针一样大小
+template<class T>
+using pool_unique_ptr = std::unique_ptr<T, PoolDeleter<T>>;
+
+
+/// @brief 在内存池中创建对象
+template<class T, class... Args>
+std::enable_if_t<!std::is_array_v<T>, pool_unique_ptr<T>> make_pool_unique(Args&&... args)
+{
+    // 内存槽只保证8字节对齐
+    static_assert(alignof(T) <= SLOT_BASE_SIZE, "over-aligned types are not supported by the pool");
+
+    void* addr = HashBucket::allocate(sizeof(T));
+    if (!addr)
+        throw std::bad_alloc();
+    try
+    {
+        return pool_unique_ptr<T>(new (addr) T(std::forward<Args>(args)...));
+    }
+    catch (...)
+    {
+        HashBucket::deallocate(addr, sizeof(T));
+        throw;
+    }
+}
+
+
+/// @brief 在内存池中创建count个值初始化的元素
+template<class T>
+std::enable_if_t<std::is_array_v<T> && std::extent_v<T> == 0, pool_unique_ptr<T>> make_pool_unique(size_t count)
+{
+    using Element = std::remove_extent_t<T>;
+    using Deleter = PoolDeleter<T>;
+    using Header = typename Deleter::ArrayHeader;
+    static_assert(alignof(Element) <= SLOT_BASE_SIZE, "over-aligned types are not supported by the pool");
+
+    if (count > (std::numeric_limits<size_t>::max() - sizeof(Header)) / sizeof(Element))
+        throw std::bad_array_new_length();
+
+    size_t size = Deleter::allocSize(count);
+    void* addr = HashBucket::allocate(size);
+    if (!addr)
+        throw std::bad_alloc();
+
+    Header* header = static_cast<Header*>(addr);
+    header->count = count;
+    Element* elements = reinterpret_cast<Element*>(header + 1);
+
+    size_t constructed = 0;
+    try
+    {
+        for (; constructed < count; ++constructed)
+            new (elements + constructed) Element();
+    }
+    catch (...)
+    {
+        for (size_t i = constructed; i > 0; --i)
+            elements[i - 1].~Element();
+        HashBucket::deallocate(addr, size);
+        throw;
+    }
+    return pool_unique_ptr<T>(elements);
+}
+
+// 定长数组和std::make_unique一样不支持
+template<class T, class... Args>
+std::enable_if_t<std::extent_v<T> != 0> make_pool_unique(Args&&...) = delete;
+
+
+static_assert(sizeof(pool_unique_ptr<int>) == sizeof(int*), "pool_unique_ptr must stay pointer-sized");
+static_assert(sizeof(pool_unique_ptr<int[]>) == sizeof(int*), "pool_unique_ptr<T[]> must stay pointer-sized");
+
+};
+
+#endif // POOL_UNIQUE_PTR_H
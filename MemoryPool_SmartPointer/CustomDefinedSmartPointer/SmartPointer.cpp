@@ -1,5 +1,8 @@
 #include <iostream>
 #include "MemoryPool_CAS.h"
+#include "PoolAllocator.h"
+#include "PoolIntrusivePtr.h"
+#include "PoolUniquePtr.h"
 #include <string>
 #include <memory> // 智能指针
 using namespace memory_pool_CAS;
@@ -7,41 +10,16 @@ using namespace memory_pool_CAS;
 template <class T, class... Args>
 std::shared_ptr<T> make_shared_ptr_from_pool(Args &&...args)
 {
-    // 分配内存
-    void *addr = HashBucket::allocate(sizeof(T));
-
-    // 构造对象 placement new
-    T *ptr = new (addr) T(std::forward<Args>(args)...);
-
-    // 自定义删除器 结合内存池使用
-    auto deleter = [](T *p)
-    {
-        p->~T();
-        HashBucket::deallocate(p, sizeof(T));
-    };
-
-    // 智能指针包装 返回
-    return std::shared_ptr<T>(ptr, deleter);
+    // shared_ptr(ptr, deleter)会通过全局new单独申请控制块
+    // allocate_shared把控制块和对象放在同一个内存槽中 只需要一次申请 并且全部来自内存池
+    return allocate_shared_from_pool<T>(std::forward<Args>(args)...);
 }
 
 template <class T, class... Args>
-std::unique_ptr<T> make_unique_ptr_from_pool(Args &&...args)
+pool_unique_ptr<T> make_unique_ptr_from_pool(Args &&...args)
 {
-    // 分配内存
-    void *addr = HashBucket::allocate(sizeof(T));
-
-    // 构造对象 placement new
-    T *ptr = new (addr) T(std::forward<Args>(args)...);
-
-    // 自定义删除器 结合内存池使用
-    auto deleter = [](T *p)
-    {
-        p->~T();
-        HashBucket::deallocate(p, sizeof(T));
-    };
-
-    // 智能指针包装 返回
-    return std::unique_ptr<T>(ptr, deleter);
+    // 删除器是具名的空类 unique_ptr和裸指针一样大小 析构时按照sizeof(T)归还到对应的哈希桶
+    return make_pool_unique<T>(std::forward<Args>(args)...);
 }
 
 struct Student
@@ -57,6 +35,13 @@ struct Student
     }
 };
 
+// 引用计数和对象在同一个内存槽中
+struct Teacher : pool_ref_counted<>
+{
+    std::string name;
+    Teacher(std::string _name) : name(_name) {}
+};
+
 int main()
 {
     HashBucket::initMemoryPool();
@@ -77,5 +62,16 @@ int main()
     std::cout << ptr1.use_count() << std::endl;
     std::cout << ptr2.use_count() << std::endl;
 
+    pool_intrusive_ptr<Teacher> ptr3 = make_pool_intrusive<Teacher>("xyz");
+    pool_intrusive_ptr<Teacher> ptr4 = ptr3;
+    std::cout << "name: " << ptr4->name << ", use_count: " << ptr3.use_count() << std::endl;
+
+    pool_unique_ptr<Student> ptr5 = make_unique_ptr_from_pool<Student>("def", 60);
+    std::cout << "name: " << ptr5->name << ", score: " << ptr5->score << ", sizeof: " << sizeof(ptr5) << std::endl;
+
+    pool_unique_ptr<Student[]> ptr6 = make_pool_unique<Student[]>(3);
+    ptr6[1].name = "ghi";
+    std::cout << "name: " << ptr6[1].name << ", sizeof: " << sizeof(ptr6) << std::endl;
+
     return 0;
 }
\ No newline at end of file
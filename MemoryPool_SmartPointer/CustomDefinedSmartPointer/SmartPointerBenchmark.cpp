@@ -0,0 +1,134 @@
+/**
+ * 智能指针的申请/复制/释放对比
+ * 1. std::make_shared: 对象和控制块一次全局new
+ * 2. shared_ptr(ptr, deleter): 对象在内存池中 控制块仍然单独全局new
+ * 3. allocate_shared + PoolAllocator: 对象和控制块共用一个内存槽 不经过全局new
+ * 4. pool_intrusive_ptr 原子引用计数 / 非原子引用计数: 没有控制块 引用计数在对象内部
+ * 每个对象创建后复制几次模拟引用计数的增减 同时统计每个对象平均调用全局new的次数
+ *
+ * libstdc++在进程从未创建过线程时 shared_ptr的引用计数不使用原子操作
+ * 测试前先创建一个线程 和实际的多线程程序一样 所有shared_ptr都使用原子引用计数
+ */
+#include "MemoryPool_CAS.h"
+#include "PoolAllocator.h"
+#include "PoolIntrusivePtr.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <memory>
+#include <cstdlib>
+#include <new>
+#include <thread>
+
+using namespace memory_pool_CAS;
+using Clock = std::chrono::steady_clock;
+
+constexpr int objectNums = 1000;
+constexpr int roundNums = 1000;
+constexpr int copyNums = 4;
+
+// 统计全局new的调用次数
+static size_t g_globalNewNums = 0;
+
+void* operator new(size_t size)
+{
+    ++g_globalNewNums;
+    if (void* ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+struct Point
+{
+    double x, y, z;
+    int id;
+    Point(int _id) : x(0), y(0), z(0), id(_id) {}
+};
+
+struct AtomicPoint : pool_ref_counted<true>
+{
+    double x, y, z;
+    int id;
+    AtomicPoint(int _id) : x(0), y(0), z(0), id(_id) {}
+};
+
+struct PlainPoint : pool_ref_counted<false>
+{
+    double x, y, z;
+    int id;
+    PlainPoint(int _id) : x(0), y(0), z(0), id(_id) {}
+};
+
+// 防止读取被优化掉
+volatile int g_sink;
+
+template<class Ptr, class Make>
+void runCase(const char* name, Make make)
+{
+    std::vector<Ptr> ptrs;
+    std::vector<Ptr> copies;
+    ptrs.reserve(objectNums);
+    copies.reserve(objectNums * copyNums);
+
+    size_t newBase = g_globalNewNums;
+    auto start = Clock::now();
+    for (int round = 0; round < roundNums; ++round)
+    {
+        for (int i = 0; i < objectNums; ++i)
+            ptrs.push_back(make(i));
+        for (int c = 0; c < copyNums; ++c)
+            for (const Ptr& ptr : ptrs)
+                copies.push_back(ptr);
+        int sum = 0;
+        for (const Ptr& ptr : copies)
+            sum += ptr->id;
+        g_sink = sum;
+        copies.clear();
+        ptrs.clear();
+    }
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    double newPerObject = double(g_globalNewNums - newBase) / (double(objectNums) * roundNums);
+
+    std::cout << std::left << std::setw(32) << name << std::right << std::setw(10) << std::fixed << std::setprecision(2)
+              << ms << " ms" << std::setw(12) << newPerObject << " global new/object" << std::endl;
+}
+
+int main()
+{
+    HashBucket::initMemoryPool();
+    std::thread([] {}).join();
+
+    std::cout << objectNums * roundNums << " objects, " << copyNums << " copies each, sizeof(shared_ptr) = "
+              << sizeof(std::shared_ptr<Point>) << ", sizeof(pool_intrusive_ptr) = "
+              << sizeof(pool_intrusive_ptr<AtomicPoint>) << std::endl;
+
+    runCase<std::shared_ptr<Point>>("std::make_shared", [](int i) {
+        return std::make_shared<Point>(i);
+    });
+    runCase<std::shared_ptr<Point>>("shared_ptr(pool ptr, deleter)", [](int i) {
+        Point* ptr = HashBucket::newElement<Point>(i);
+        return std::shared_ptr<Point>(ptr, [](Point* p) { HashBucket::deleteElement(p); });
+    });
+    runCase<std::shared_ptr<Point>>("allocate_shared(PoolAllocator)", [](int i) {
+        return allocate_shared_from_pool<Point>(i);
+    });
+    runCase<pool_intrusive_ptr<AtomicPoint>>("pool_intrusive_ptr (atomic)", [](int i) {
+        return make_pool_intrusive<AtomicPoint>(i);
+    });
+    runCase<pool_intrusive_ptr<PlainPoint>>("pool_intrusive_ptr (non-atomic)", [](int i) {
+        return make_pool_intrusive<PlainPoint>(i);
+    });
+
+    return 0;
+}
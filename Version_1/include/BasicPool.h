@@ -0,0 +1,873 @@
+#ifndef BASIC_POOL_H
+#define BASIC_POOL_H
+
+// 按照同步策略参数化的内存池 互斥锁版本和无锁版本的哈希桶都是它的实例 也可以创建线程私有的实例
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <algorithm>
+#include <cassert>
+#include <sys/mman.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#define MEMORYPOOL_MAX_NUM 64
+#define SLOT_BASE_SIZE 8
+#define SLOT_MAX_SIZE 512
+
+namespace memory_pool_basic{
+
+/// @brief 内存池块的增长策略
+/// 每个哈希桶的第一个块为initialBlockSize 之后每次申请新块时翻倍 直到maxBlockSize
+/// 加锁的策略释放时屏蔽地址低位找到所属的块 所有块都通过mmap映射 起始地址按照不小于maxBlockSize的2的幂对齐
+/// 无锁策略不需要按地址查找块 小于mmapThreshold的块使用operator new 其余直接mmap 都不需要额外对齐
+/// useHugePages时不小于2MB的块优先使用大页 大页地址没有对齐或者映射失败时退回普通页并建议透明大页
+/// 加锁的策略中所有内存槽都归还之后的空块最多缓存maxEmptyBlocks个 超过时释放给系统 无锁策略的块只在析构时释放
+/// 默认每个哈希桶最多缓存2个空块(不超过2MB) 峰值过后多余的块归还给系统
+/// 反复申请释放到同一峰值的负载可以通过initMemoryPool调大 避免每轮都释放再缺页
+struct BlockGrowthPolicy
+{
+    size_t initialBlockSize = 4096;
+    size_t maxBlockSize = 1024 * 1024;
+    bool useHugePages = false;
+    size_t maxEmptyBlocks = 2;
+    size_t mmapThreshold = 64 * 1024;
+};
+
+
+/// @brief 带版本号的无锁栈 内存槽空闲链表、弹匣栈以及对象池共用
+/// 栈顶 低48位为地址 高16位为版本号 每次修改栈顶时版本号加1
+/// 弹出时即使栈顶又变回了原来的地址 版本号也已经不同 CAS失败 避免ABA问题
+/// 节点需要有std::atomic<Node*> next成员 并且在栈的使用期间不能释放(弹出时可能读取已经被其他线程弹出的节点)
+template<class Node>
+class TaggedStack
+{
+public:
+    constexpr TaggedStack() : m_head(0) {}
+
+    /// @brief 弹出栈顶
+    /// @return Node* 栈为空时返回nullptr
+    Node* pop()
+    {
+        /**
+         * 整体流程:
+         * 读取带版本号的栈顶 栈为空时直接返回;
+         * 读取栈顶节点的next 此时节点可能已经被其他线程弹出并写入了数据 读到的值可能无效;
+         * CAS同时比较地址和版本号 只要期间栈顶被修改过(即使地址相同) 版本号就不同 CAS失败后重试;
+         */
+        uint64_t oldHead = this->m_head.load(std::memory_order_acquire);
+        while (true)
+        {
+            Node* node = headPtr(oldHead);
+            if (!node)
+                return nullptr;
+
+            Node* next = node->next.load(std::memory_order_relaxed);
+
+            // 失败时oldHead被更新为当前值
+            if (this->m_head.compare_exchange_weak(oldHead, packHead(next, nextTag(oldHead)),
+                                                   std::memory_order_acquire, std::memory_order_acquire))
+            {
+                return node;
+            }
+        }
+    }
+
+    /// @brief 压入栈顶
+    /// @param node 待压入的节点
+    void push(Node* node)
+    {
+        uint64_t oldHead = this->m_head.load(std::memory_order_relaxed);
+        while (true)
+        {
+            node->next.store(headPtr(oldHead), std::memory_order_relaxed);
+            if (this->m_head.compare_exchange_weak(oldHead, packHead(node, nextTag(oldHead)),
+                                                   std::memory_order_release, std::memory_order_relaxed))
+            {
+                return;
+            }
+        }
+    }
+
+    /// @brief 清空 只能在没有其他线程访问时调用
+    void clear() { this->m_head.store(0, std::memory_order_relaxed); }
+
+private:
+    // x86-64和AArch64用户态地址不超过48位
+    static constexpr int HEAD_PTR_BITS = 48;
+    static constexpr uint64_t HEAD_PTR_MASK = (uint64_t(1) << HEAD_PTR_BITS) - 1;
+    static_assert(sizeof(void*) == sizeof(uint64_t), "tagged stack head requires 64-bit pointers");
+
+    static uint64_t packHead(Node* ptr, uint64_t tag)
+    {
+        return (tag << HEAD_PTR_BITS) | (reinterpret_cast<uint64_t>(ptr) & HEAD_PTR_MASK);
+    }
+
+    static Node* headPtr(uint64_t head)
+    {
+        return reinterpret_cast<Node*>(head & HEAD_PTR_MASK);
+    }
+
+    static uint64_t nextTag(uint64_t head)
+    {
+        return (head >> HEAD_PTR_BITS) + 1;
+    }
+
+private:
+    std::atomic<uint64_t> m_head;
+};
+
+
+namespace detail
+{
+    constexpr size_t BLOCK_PAGE_SIZE = 4096;
+    constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+    inline size_t roundUp(size_t size, size_t align)
+    {
+        return (size + align - 1) / align * align;
+    }
+
+    /// @brief 上一次按照对齐映射的块的起始地址 之后的块优先映射在它的下方
+    /// 映射区域从高地址向低地址增长 下方通常是空闲的 一次mmap就能得到对齐的地址
+    inline std::atomic<size_t> g_alignedMapHint{0};
+
+    /// @brief 按照增长策略映射内存池块 起始地址按照align对齐
+    /// @param size 块大小 向上取整到页大小 不超过align
+    /// @param policy 增长策略
+    /// @param align 对齐字节数 2的幂
+    inline void* allocateBlockMemory(size_t& size, const BlockGrowthPolicy& policy, size_t align)
+    {
+        /**
+         * 整体流程:
+         * 需要时优先映射大页 大页地址没有对齐时退回普通页;
+         * 在上一个对齐映射的块下方找对齐的地址 MAP_FIXED_NOREPLACE映射 地址已经被占用时失败 不会覆盖已有的映射;
+         * 失败时多映射align - BLOCK_PAGE_SIZE字节 其中一定有对齐的起始地址 头尾多余的部分直接归还;
+         */
+        if (policy.useHugePages && size >= HUGE_PAGE_SIZE)
+        {
+            size_t hugeSize = roundUp(size, HUGE_PAGE_SIZE);
+            void* addr = mmap(nullptr, hugeSize, PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (addr != MAP_FAILED)
+            {
+                // 大页只保证按照大页大小对齐 没有按照align对齐时退回普通页
+                if (reinterpret_cast<size_t>(addr) % align == 0)
+                {
+                    size = hugeSize;
+                    return addr;
+                }
+                munmap(addr, hugeSize);
+            }
+        }
+
+        size = roundUp(size, BLOCK_PAGE_SIZE);
+        char* alignAddr = nullptr;
+
+#ifdef MAP_FIXED_NOREPLACE
+        size_t hint = g_alignedMapHint.load(std::memory_order_relaxed);
+        if (hint > size + align)
+        {
+            size_t hintAddr = (hint - size) & ~(align - 1);
+            void* addr = mmap(reinterpret_cast<void*>(hintAddr), size, PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+            // 不支持MAP_FIXED_NOREPLACE的内核把地址当作提示 可能映射到其他位置
+            if (addr == reinterpret_cast<void*>(hintAddr))
+                alignAddr = static_cast<char*>(addr);
+            else if (addr != MAP_FAILED)
+                munmap(addr, size);
+        }
+#endif
+
+        if (alignAddr == nullptr)
+        {
+            size_t mapSize = size + align - BLOCK_PAGE_SIZE;
+            void* addr = mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (addr == MAP_FAILED)
+                throw std::bad_alloc();
+
+            char* mapAddr = static_cast<char*>(addr);
+            alignAddr = reinterpret_cast<char*>(roundUp(reinterpret_cast<size_t>(mapAddr), align));
+            size_t headSize = alignAddr - mapAddr;
+            size_t tailSize = mapSize - headSize - size;
+            if (headSize > 0)
+                munmap(mapAddr, headSize);
+            if (tailSize > 0)
+                munmap(alignAddr + size, tailSize);
+        }
+        g_alignedMapHint.store(reinterpret_cast<size_t>(alignAddr), std::memory_order_relaxed);
+
+        // 没有预留大页时由透明大页在后台合并
+        if (policy.useHugePages)
+            madvise(alignAddr, size, MADV_HUGEPAGE);
+        return alignAddr;
+    }
+}
+
+
+/* 同步策略 LOCK_FREE为false时提供lock/unlock 由内存池在每次操作时加锁 */
+
+/// @brief 单线程 不做任何同步 用于只在一个线程内使用的内存池 整个过程没有原子操作
+struct SingleThreadPolicy
+{
+    static constexpr bool LOCK_FREE = false;
+    void lock() {}
+    void unlock() {}
+};
+
+
+/// @brief 互斥锁 竞争时线程挂起
+struct MutexPolicy
+{
+    static constexpr bool LOCK_FREE = false;
+    void lock() { this->m_mutex.lock(); }
+    void unlock() { this->m_mutex.unlock(); }
+
+private:
+    std::mutex m_mutex;
+};
+
+
+/// @brief 自旋锁 临界区只有几条指令 竞争时先自旋 一段时间后让出CPU
+struct SpinLockPolicy
+{
+    static constexpr bool LOCK_FREE = false;
+
+    void lock()
+    {
+        int spinNums = 0;
+        while (this->m_locked.exchange(true, std::memory_order_acquire))
+        {
+            // 只读等待 避免持续写同一个缓存行
+            while (this->m_locked.load(std::memory_order_relaxed))
+            {
+                if (++spinNums < 64)
+                {
+#if defined(__x86_64__) || defined(__i386__)
+                    _mm_pause();
+#endif
+                }
+                else
+                {
+                    std::this_thread::yield();
+                }
+            }
+        }
+    }
+
+    void unlock() { this->m_locked.store(false, std::memory_order_release); }
+
+private:
+    std::atomic<bool> m_locked{false};
+};
+
+
+/// @brief 无锁 空闲链表使用带标签的无锁栈 块内切分使用fetch_add
+struct LockFreePolicy
+{
+    static constexpr bool LOCK_FREE = true;
+};
+
+
+/**
+ * 定长内存槽的内存池
+ * 块大小每次翻倍直到上限 加锁的策略中所有块按照m_blockAlign对齐映射
+ *
+ * 加锁的策略(slab): 每个块维护自己的空闲链表和存活数量 锁内全部是普通读写
+ * 申请时从有空闲内存槽的块链表头部取块 释放时屏蔽地址低位找到所属的块
+ * 块内所有内存槽都归还之后缓存为空块 超过maxEmptyBlocks时释放给系统
+ * 单线程策略下锁是空函数 等价于没有同步的内存池
+ *
+ * 无锁策略: 归还的内存槽放入整个内存池共用的带标签无锁栈 申请时优先弹出 否则在当前块上fetch_add切分
+ * 块只在内存池析构时释放 EpochReclaimer只能解决其中一个问题 其余的问题没有解决 不释放空块:
+ * 1. 判断块是否全部空闲需要每个块的存活计数 每次申请释放都要对块头部做一次原子操作 多线程时争用同一个缓存行
+ * 2. 块的内存槽分散在共用的无锁栈、各线程的弹匣以及弹匣仓库中 不能只把一个块的内存槽从无锁栈中摘除
+ * 3. 弹出时会读取可能已经被其他线程弹出的内存槽的next 释放块之前每次弹出都需要进入epoch临界区(EpochReclaimer能解决)
+ * 需要归还内存的场景使用互斥锁版本的哈希桶或者加锁策略的BasicPool
+ */
+template<class LockPolicy>
+class BasicPool
+{
+    struct Slot
+    {
+        std::atomic<Slot*> next;
+    };
+
+    /// @brief 内存池块头部 位于每个内存池块的起始位置
+    struct Block
+    {
+        std::atomic<Block*> allNext;    // 所有块组成的链表 析构时释放
+        Block* allPrev;                 // 加锁的策略释放空块时从链表中摘除
+        Block* prev;                    // 加锁的策略中有空闲内存槽的块组成的双向链表 空块缓存只使用next
+        Block* next;
+        std::atomic<size_t> cursor;     // 下一个未切分的内存槽相对于块起始位置的偏移
+        size_t size;                    // 块大小 包括头部
+        bool mapped;                    // 是否通过mmap映射 否则通过operator new申请
+        bool inPartialList;             // 是否在有空闲内存槽的块链表中
+        size_t liveNums;                // 已经分配出去的内存槽数量
+        Slot* freeSlotPtr;              // 块内归还的内存槽
+    };
+
+public:
+    /// @brief 构造函数 可以在编译期完成初始化 哈希桶中的内存池不需要再调用init
+    /// @param slotSize 内存槽大小
+    /// @param policy 内存池块的增长策略
+    constexpr explicit BasicPool(size_t slotSize = SLOT_BASE_SIZE, const BlockGrowthPolicy& policy = BlockGrowthPolicy())
+        : m_slotSize(slotSize)
+        , m_nextBlockSize(policy.initialBlockSize)
+        , m_growthPolicy(policy)
+        , m_blockAlign(blockAlignOf(slotSize, policy))
+        , m_curBlock(nullptr)
+        , m_partialBlockPtr(nullptr)
+        , m_emptyBlockPtr(nullptr)
+        , m_emptyBlockNums(0)
+        , m_allBlockPtr(nullptr)
+        , m_blockNums(0)
+    {
+    }
+
+    ~BasicPool()
+    {
+        // 释放内存池 不需要操作里面的每个内存槽 而是直接将整个内存池进行删除
+        Block* block = this->m_allBlockPtr.load(std::memory_order_acquire);
+        while (block)
+        {
+            Block* next = block->allNext.load(std::memory_order_relaxed);
+            freeBlock(block);
+            block = next;
+        }
+    }
+
+    BasicPool(const BasicPool&) = delete;
+    BasicPool& operator=(const BasicPool&) = delete;
+
+    /// @brief 重新设置内存池参数 只能在使用之前调用
+    /// @param slotSize 内存槽大小
+    /// @param policy 内存池块的增长策略
+    void init(size_t slotSize, const BlockGrowthPolicy& policy = BlockGrowthPolicy())
+    {
+        assert(slotSize > 0 && slotSize % 8 == 0);
+        assert(policy.initialBlockSize > 0 && policy.initialBlockSize <= policy.maxBlockSize);
+        this->m_slotSize = slotSize;
+        this->m_growthPolicy = policy;
+        this->m_nextBlockSize.store(policy.initialBlockSize, std::memory_order_relaxed);
+        this->m_blockAlign = blockAlignOf(slotSize, policy);
+        this->m_freeSlotList.clear();
+        this->m_curBlock.store(nullptr, std::memory_order_relaxed);
+        this->m_partialBlockPtr = nullptr;
+        this->m_emptyBlockPtr = nullptr;
+        this->m_emptyBlockNums = 0;
+    }
+
+    /// @brief 从内存池中申请一个内存槽
+    void* allocate()
+    {
+        if constexpr (LockPolicy::LOCK_FREE)
+        {
+            if (Slot* slot = this->m_freeSlotList.pop())
+                return slot;
+            return this->carveLockFree();
+        }
+        else
+        {
+            std::lock_guard<LockPolicy> lock(this->m_lock);
+            return this->allocateLocked();
+        }
+    }
+
+    /// @brief 归还内存槽
+    /// @param ptr 待归还的地址
+    void deallocate(void* ptr)
+    {
+        assert(ptr != nullptr);
+        if (!ptr)
+            return;
+        if constexpr (LockPolicy::LOCK_FREE)
+        {
+            this->m_freeSlotList.push(reinterpret_cast<Slot*>(ptr));
+        }
+        else
+        {
+            std::lock_guard<LockPolicy> lock(this->m_lock);
+            this->deallocateLocked(ptr);
+        }
+    }
+
+    size_t getSlotSize() const { return this->m_slotSize; }
+
+    /// @brief 当前持有的内存池块数量 包括缓存的空块
+    size_t getBlockNums() const { return this->m_blockNums.load(std::memory_order_relaxed); }
+
+private:
+    /// @brief 块的对齐字节数 不小于任何一个块的大小 所以同一个对齐区间内只有一个块
+    /// 无锁策略不按地址查找块 只需要页对齐
+    static constexpr size_t blockAlignOf(size_t slotSize, const BlockGrowthPolicy& policy)
+    {
+        if constexpr (LockPolicy::LOCK_FREE)
+            return detail::BLOCK_PAGE_SIZE;
+
+        size_t minSize = sizeof(Block) + 2 * slotSize;
+        size_t maxSize = policy.maxBlockSize > minSize ? policy.maxBlockSize : minSize;
+        size_t align = detail::BLOCK_PAGE_SIZE;
+        while (align < maxSize)
+            align <<= 1;
+        return align;
+    }
+
+    /// @brief 查找地址所属的内存池块 屏蔽低位就是块的起始地址
+    Block* findBlock(void* ptr) const
+    {
+        return reinterpret_cast<Block*>(reinterpret_cast<size_t>(ptr) & ~(this->m_blockAlign - 1));
+    }
+
+    /// @brief 第一个内存槽相对于块起始位置的偏移 按照内存槽大小对齐
+    size_t firstSlotOffset(Block* block) const
+    {
+        size_t addr = reinterpret_cast<size_t>(block) + sizeof(Block);
+        size_t padSize = (this->m_slotSize - addr % this->m_slotSize) % this->m_slotSize;
+        return sizeof(Block) + padSize;
+    }
+
+    /// @brief 申请新块 块大小按照增长策略翻倍 至少能放下头部和一个对齐后的内存槽
+    /// 无锁策略的小块使用operator new 其余通过mmap映射
+    Block* allocateNewBlock()
+    {
+        size_t blockSize = std::max(this->m_nextBlockSize.load(std::memory_order_relaxed), sizeof(Block) + 2 * this->m_slotSize);
+        Block* block;
+        if (LockPolicy::LOCK_FREE && blockSize < this->m_growthPolicy.mmapThreshold)
+        {
+            block = reinterpret_cast<Block*>(operator new(blockSize));
+            block->mapped = false;
+        }
+        else
+        {
+            block = reinterpret_cast<Block*>(detail::allocateBlockMemory(blockSize, this->m_growthPolicy, this->m_blockAlign));
+            block->mapped = true;
+        }
+        block->allNext.store(nullptr, std::memory_order_relaxed);
+        block->allPrev = nullptr;
+        block->size = blockSize;
+        this->resetBlock(block);
+        return block;
+    }
+
+    /// @brief 按照申请的方式释放块
+    static void freeBlock(Block* block)
+    {
+        if (block->mapped)
+            munmap(block, block->size);
+        else
+            operator delete(block);
+    }
+
+    /// @brief 新块挂到所有块的链表上 并增大下一个块的大小
+    void linkNewBlock(Block* block)
+    {
+        Block* head = this->m_allBlockPtr.load(std::memory_order_relaxed);
+        if constexpr (LockPolicy::LOCK_FREE)
+        {
+            // 只有压入没有弹出 不存在ABA问题
+            do
+            {
+                block->allNext.store(head, std::memory_order_relaxed);
+            } while (!this->m_allBlockPtr.compare_exchange_weak(head, block, std::memory_order_release, std::memory_order_relaxed));
+        }
+        else
+        {
+            block->allNext.store(head, std::memory_order_relaxed);
+            if (head)
+                head->allPrev = block;
+            this->m_allBlockPtr.store(block, std::memory_order_relaxed);
+        }
+        this->m_blockNums.fetch_add(1, std::memory_order_relaxed);
+
+        // 只有安装成功的线程更新
+        size_t nextSize = std::min(block->size * 2, this->m_growthPolicy.maxBlockSize);
+        if (nextSize > this->m_nextBlockSize.load(std::memory_order_relaxed))
+            this->m_nextBlockSize.store(nextSize, std::memory_order_relaxed);
+    }
+
+    /// @brief 将块重置为没有切分的状态
+    void resetBlock(Block* block)
+    {
+        block->prev = nullptr;
+        block->next = nullptr;
+        block->inPartialList = false;
+        block->liveNums = 0;
+        block->freeSlotPtr = nullptr;
+        block->cursor.store(this->firstSlotOffset(block), std::memory_order_relaxed);
+    }
+
+    /* 加锁的策略 调用时已经加锁 */
+
+    void* allocateLocked()
+    {
+        /**
+         * 申请内存槽
+         * 整体流程:
+         * 从有空闲内存槽的块链表头部取块 链表为空时优先使用缓存的空块 没有再申请新块;
+         * 块内优先使用归还的内存槽 否则从还没有切分的部分切分;
+         * 块用完之后移出链表 直到有内存槽归还;
+         */
+        Block* block = this->m_partialBlockPtr;
+        if (block == nullptr)
+        {
+            if (this->m_emptyBlockPtr != nullptr)
+            {
+                block = this->m_emptyBlockPtr;
+                this->m_emptyBlockPtr = block->next;
+                this->m_emptyBlockNums--;
+            }
+            else
+            {
+                block = this->allocateNewBlock();
+                this->linkNewBlock(block);
+            }
+            this->linkPartialBlock(block);
+        }
+
+        void* addr;
+        size_t offset = block->cursor.load(std::memory_order_relaxed);
+        if (block->freeSlotPtr != nullptr)
+        {
+            Slot* slot = block->freeSlotPtr;
+            block->freeSlotPtr = slot->next.load(std::memory_order_relaxed);
+            addr = slot;
+        }
+        else
+        {
+            addr = reinterpret_cast<char*>(block) + offset;
+            offset += this->m_slotSize;
+            block->cursor.store(offset, std::memory_order_relaxed);
+        }
+        block->liveNums++;
+
+        if (block->freeSlotPtr == nullptr && offset + this->m_slotSize > block->size)
+            this->unlinkPartialBlock(block);
+        return addr;
+    }
+
+    void deallocateLocked(void* ptr)
+    {
+        /**
+         * 归还内存槽
+         * 整体流程:
+         * 屏蔽地址低位找到所属的块 放入块内的空闲链表;
+         * 块原来已经用完时重新放入有空闲内存槽的块链表;
+         * 块内所有内存槽都归还之后移出链表 缓存的空块不超过上限时缓存 否则释放给系统;
+         */
+        Block* block = this->findBlock(ptr);
+        assert(block->liveNums > 0);
+
+        Slot* slot = reinterpret_cast<Slot*>(ptr);
+        slot->next.store(block->freeSlotPtr, std::memory_order_relaxed);
+        block->freeSlotPtr = slot;
+        block->liveNums--;
+
+        if (block->liveNums > 0)
+        {
+            if (!block->inPartialList)
+                this->linkPartialBlock(block);
+            return;
+        }
+
+        if (block->inPartialList)
+            this->unlinkPartialBlock(block);
+
+        if (this->m_emptyBlockNums < this->m_growthPolicy.maxEmptyBlocks)
+        {
+            this->resetBlock(block);
+            block->next = this->m_emptyBlockPtr;
+            this->m_emptyBlockPtr = block;
+            this->m_emptyBlockNums++;
+        }
+        else
+        {
+            Block* allNext = block->allNext.load(std::memory_order_relaxed);
+            if (block->allPrev)
+                block->allPrev->allNext.store(allNext, std::memory_order_relaxed);
+            else
+                this->m_allBlockPtr.store(allNext, std::memory_order_relaxed);
+            if (allNext)
+                allNext->allPrev = block->allPrev;
+            this->m_blockNums.fetch_sub(1, std::memory_order_relaxed);
+            freeBlock(block);
+        }
+    }
+
+    /// @brief 将块放入/移出有空闲内存槽的块链表
+    void linkPartialBlock(Block* block)
+    {
+        block->prev = nullptr;
+        block->next = this->m_partialBlockPtr;
+        if (this->m_partialBlockPtr)
+            this->m_partialBlockPtr->prev = block;
+        this->m_partialBlockPtr = block;
+        block->inPartialList = true;
+    }
+
+    void unlinkPartialBlock(Block* block)
+    {
+        if (block->prev)
+            block->prev->next = block->next;
+        else
+            this->m_partialBlockPtr = block->next;
+        if (block->next)
+            block->next->prev = block->prev;
+        block->prev = nullptr;
+        block->next = nullptr;
+        block->inPartialList = false;
+    }
+
+    /* 无锁策略 */
+
+    void* carveLockFree()
+    {
+        /**
+         * 无锁切分
+         * 整体流程:
+         * 在当前块上fetch_add移动游标 得到的偏移没有超出块的范围时 该内存槽归自己所有;
+         * 当前块已经用完时申请新块 通过CAS安装为当前块 新块的第一个内存槽留给自己;
+         * CAS失败说明其他线程已经安装了新块 释放自己申请的块 在对方的块上重试;
+         */
+        const size_t slotSize = this->m_slotSize;
+
+        Block* block = this->m_curBlock.load(std::memory_order_acquire);
+        while (true)
+        {
+            if (block)
+            {
+                size_t offset = block->cursor.fetch_add(slotSize, std::memory_order_relaxed);
+                if (offset + slotSize <= block->size)
+                    return reinterpret_cast<char*>(block) + offset;
+
+                // 当前块已经用完 申请新块之前再确认一次 其他线程可能已经安装了新块
+                Block* current = this->m_curBlock.load(std::memory_order_acquire);
+                if (current != block)
+                {
+                    block = current;
+                    continue;
+                }
+            }
+
+            Block* newBlock = this->allocateNewBlock();
+            size_t offset = newBlock->cursor.load(std::memory_order_relaxed);
+            newBlock->cursor.store(offset + slotSize, std::memory_order_relaxed);
+            if (this->m_curBlock.compare_exchange_strong(block, newBlock, std::memory_order_acq_rel, std::memory_order_acquire))
+            {
+                this->linkNewBlock(newBlock);
+                return reinterpret_cast<char*>(newBlock) + offset;
+            }
+
+            // 失败时block已经被更新为其他线程安装的块
+            freeBlock(newBlock);
+        }
+    }
+
+private:
+    size_t m_slotSize;
+    // 下一个新块的大小 每次申请新块后翻倍 直到增长策略的上限
+    std::atomic<size_t> m_nextBlockSize;
+    BlockGrowthPolicy m_growthPolicy;
+    // 所有块都按照该值对齐映射 释放时通过地址屏蔽找到所属的块
+    size_t m_blockAlign;
+    LockPolicy m_lock;
+
+    // 无锁策略: 归还的内存槽 以及当前用于切分内存槽的块
+    TaggedStack<Slot> m_freeSlotList;
+    std::atomic<Block*> m_curBlock;
+
+    // 加锁的策略: 有空闲内存槽的块 申请时从链表头部的块中获取 以及缓存的空块
+    Block* m_partialBlockPtr;
+    Block* m_emptyBlockPtr;
+    size_t m_emptyBlockNums;
+
+    std::atomic<Block*> m_allBlockPtr;  // 所有块 包括缓存的空块
+    std::atomic<size_t> m_blockNums;
+};
+
+
+/**
+ * 按照大小分桶的内存池 64个哈希桶 第i个内存池的内存槽大小为(i + 1) * SLOT_BASE_SIZE 8字节到512字节
+ * 不是单例 可以在每个工作线程中创建一个单线程策略的实例 也可以创建一个全局的共享实例
+ */
+template<class LockPolicy>
+class BasicHashBucket
+{
+public:
+    constexpr BasicHashBucket() : BasicHashBucket(std::make_index_sequence<MEMORYPOOL_MAX_NUM>()) {}
+
+    BasicHashBucket(const BasicHashBucket&) = delete;
+    BasicHashBucket& operator=(const BasicHashBucket&) = delete;
+
+    /// @brief 使用其他增长策略重新设置每个哈希桶中的内存池 只能在第一次申请内存之前调用
+    void initMemoryPool(const BlockGrowthPolicy& policy = BlockGrowthPolicy())
+    {
+        for (int i = 0; i < MEMORYPOOL_MAX_NUM; ++i)
+            this->m_pools[i].init((i + 1) * SLOT_BASE_SIZE, policy);
+    }
+
+    BasicPool<LockPolicy>& getMemoryPool(int index)
+    {
+        return this->m_pools[index];
+    }
+
+    void* allocate(size_t size)
+    {
+        assert(size > 0);
+        if (size > SLOT_MAX_SIZE)
+            return operator new(size);
+        return this->m_pools[(size - 1) / SLOT_BASE_SIZE].allocate();
+    }
+
+    void deallocate(void* ptr, size_t size)
+    {
+        if (!ptr)
+            return;
+        if (size > SLOT_MAX_SIZE)
+        {
+            operator delete(ptr);
+            return;
+        }
+        this->m_pools[(size - 1) / SLOT_BASE_SIZE].deallocate(ptr);
+    }
+
+    template<class T, class... Args>
+    T* newElement(Args&&... args)
+    {
+        void* ptr = this->allocate(sizeof(T));
+        if (!ptr)
+            return nullptr;
+        return new (ptr) T(std::forward<Args>(args)...);
+    }
+
+    template<class T>
+    void deleteElement(T* ptr)
+    {
+        if (!ptr)
+            return;
+        ptr->~T();
+        this->deallocate(ptr, sizeof(T));
+    }
+
+private:
+    template<size_t... I>
+    constexpr explicit BasicHashBucket(std::index_sequence<I...>)
+        : m_pools{BasicPool<LockPolicy>((I + 1) * SLOT_BASE_SIZE)...}
+    {
+    }
+
+private:
+    BasicPool<LockPolicy> m_pools[MEMORYPOOL_MAX_NUM];
+};
+
+
+/// @brief 直接访问内存池 不经过线程缓存
+template<class LockPolicy>
+struct DirectAccess
+{
+    static void* allocate(BasicPool<LockPolicy>& pool, int index) { return pool.allocate(); }
+    static void deallocate(BasicPool<LockPolicy>& pool, void* ptr, int index) { pool.deallocate(ptr); }
+};
+
+
+/**
+ * 进程内共享的哈希桶 所有接口都是静态函数
+ * 哈希桶在编译期完成初始化(常量初始化) 没有初始化顺序问题 获取时也不需要检查是否已经初始化
+ * 哈希桶不会析构 进程退出时由系统回收 所以其他编译单元的静态对象在构造和析构时也可以使用
+ * Access决定小内存经过什么到达内存池 例如线程缓存 需要提供静态的allocate(pool, index)和deallocate(pool, ptr, index)
+ */
+template<class LockPolicy, class Access = DirectAccess<LockPolicy>>
+class GlobalHashBucket
+{
+public:
+    /// @brief 使用其他增长策略重新设置每个哈希桶中的内存池 只能在第一次申请内存之前调用
+    /// 哈希桶中的内存池在编译期按照默认策略初始化 使用默认策略时不需要调用
+    /// @param policy 所有哈希桶使用的内存池块增长策略
+    static void initMemoryPool(const BlockGrowthPolicy& policy = BlockGrowthPolicy())
+    {
+        s_storage.buckets.initMemoryPool(policy);
+    }
+
+    /// @brief 获取索引位置上的内存池
+    /// @param index 哈希桶索引
+    static BasicPool<LockPolicy>& getMemoryPool(int index)
+    {
+        return s_storage.buckets.getMemoryPool(index);
+    }
+
+    /// @brief 开辟内存空间 超过SLOT_MAX_SIZE时使用operator new
+    /// @param size 需要开辟的大小 用于计算哈希桶索引
+    static void* useMemory(size_t size)
+    {
+        assert(size > 0);
+        if (size > SLOT_MAX_SIZE)
+            return operator new(size);
+        int index = (size - 1) / SLOT_BASE_SIZE;
+        return Access::allocate(getMemoryPool(index), index);
+    }
+
+    /// @brief 释放内存
+    /// @param ptr 待归还的指针
+    /// @param size 对象大小 用于计算哈希桶索引
+    static void freeMemory(void* ptr, size_t size)
+    {
+        if (!ptr)
+            return;
+        if (size > SLOT_MAX_SIZE)
+        {
+            operator delete(ptr);
+            return;
+        }
+        int index = (size - 1) / SLOT_BASE_SIZE;
+        Access::deallocate(getMemoryPool(index), ptr, index);
+    }
+
+    static void* allocate(size_t size) { return useMemory(size); }
+    static void deallocate(void* ptr, size_t size) { freeMemory(ptr, size); }
+
+    template<class T, class... Args>
+    static T* newElement(Args&&... args)
+    {
+        void* ptr = useMemory(sizeof(T));
+        if (!ptr)
+            return nullptr;
+        return new (ptr) T(std::forward<Args>(args)...);
+    }
+
+    template<class T>
+    static void deleteElement(T* ptr)
+    {
+        if (!ptr)
+            return;
+        ptr->~T();
+        freeMemory(ptr, sizeof(T));
+    }
+
+private:
+    union Storage
+    {
+        constexpr Storage() : buckets() {}
+        ~Storage() {}
+
+        BasicHashBucket<LockPolicy> buckets;
+    };
+
+    static inline Storage s_storage;
+};
+
+
+using SingleThreadPool = BasicPool<SingleThreadPolicy>;
+using MutexPool = BasicPool<MutexPolicy>;
+using SpinLockPool = BasicPool<SpinLockPolicy>;
+using LockFreePool = BasicPool<LockFreePolicy>;
+
+};
+
+#endif // BASIC_POOL_H
@@ -2,147 +2,283 @@
 #define MEMORY_POOL_CAS_H
 
 // 该版本的内存池使用无所队列结构进行内存槽的插入和弹出
+#include "BasicPool.h"
 #include <mutex>
 #include <atomic>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <type_traits>
 
 namespace memory_pool_CAS{
 
-#define MEMORYPOOL_MAX_NUM 64
-#define SLOT_BASE_SIZE 8
-#define SLOT_MAX_SIZE 512
+// 每个弹匣保存的内存槽数量
+#define MAGAZINE_SIZE 32
+// 线程的延迟释放列表达到该数量时尝试推进纪元并批量释放
+#define RETIRE_BATCH_SIZE 64
 
 
-class MemoryPool
+using memory_pool_basic::BlockGrowthPolicy;
+using memory_pool_basic::TaggedStack;
+
+/// @brief 无锁内存池 空闲链表使用带标签的无锁栈 块内切分使用fetch_add
+using MemoryPool = memory_pool_basic::BasicPool<memory_pool_basic::LockFreePolicy>;
+
+
+/**
+ * 弹匣仓库 每个哈希桶一个 位于内存池之上
+ * 线程缓存和仓库之间整个弹匣交换 满的弹匣和空的弹匣分别放在两个无锁栈中
+ * 弹匣只在仓库析构时释放
+ */
+class MagazineDepot
 {
-    struct Slot
+public:
+    /// @brief 弹匣 线程缓存中保存内存槽的定长数组
+    struct Magazine
     {
-        std::atomic<Slot*> next;
+        std::atomic<Magazine*> next;
+        Magazine* allNext;      // 仓库申请过的所有弹匣组成的链表 不在无锁栈中的弹匣也能找到
+        int count;
+        void* slots[MAGAZINE_SIZE];
     };
-public:
 
-    /// @brief 构造函数
-    /// @param blockSize 内存池块大小 
-    MemoryPool(size_t blockSize = 4096);
+    constexpr MagazineDepot() : m_allMagazines(nullptr) {}
+
+    ~MagazineDepot();
+
+    MagazineDepot(const MagazineDepot&) = delete;
+    MagazineDepot& operator=(const MagazineDepot&) = delete;
 
-    /// @brief 析构函数 释放内存池空间
-    ~MemoryPool();
+    /// @brief 用空弹匣换取一个满弹匣
+    /// @param empty 线程缓存中的空弹匣 换取成功时放入空弹匣栈
+    /// @return Magazine* 满弹匣 仓库中没有满弹匣时返回nullptr
+    Magazine* exchangeFullMagazine(Magazine* empty);
 
-    /// @brief 初始化内存池参数
-    /// @param slotSize 内存槽大小
-    void init(size_t lotSize);
+    /// @brief 用满弹匣换取一个空弹匣
+    /// @param full 线程缓存中的满弹匣 放入满弹匣栈
+    /// @return Magazine* 空弹匣 没有空弹匣时新申请一个
+    Magazine* exchangeEmptyMagazine(Magazine* full);
 
-    /// @brief 从内存池中分配内存
-    /// @param size 
-    /// @return 
-    void* allocate();
+    /// @brief 获取一个空弹匣 线程缓存第一次使用该哈希桶时调用
+    Magazine* getEmptyMagazine();
 
-    /// @brief 将内存归还给内存池
-    /// @param ptr 待回收的地址
-    void deallocate(void* ptr);
+    /// @brief 线程退出时归还弹匣 有内存槽的放入满弹匣栈 其余放入空弹匣栈
+    /// @param magazine 待归还的弹匣
+    void returnMagazine(Magazine* magazine);
 
 private:
-    /// @brief 分配新的内存池块 需要内存对齐 4个Slot*指针指向更新
-    void allocateNewBlock();
+    TaggedStack<Magazine> m_fullMagazines;
+    TaggedStack<Magazine> m_emptyMagazines;
+    // 申请过的所有弹匣 只会压入 不存在ABA问题 析构时通过它释放
+    std::atomic<Magazine*> m_allMagazines;
+};
 
-    /// @brief 对起始位置的Slot*剩余内存进行对齐
-    /// @param ptr Slot*后面的起始地址
-    /// @param align 内存槽大小
-    /// @return 
-    size_t padPointer(char* ptr, size_t align);
 
-    /// @brief 从无锁链表中弹出一个内存槽 并返回对应的地址
-    /// @return 
-    Slot* popFreeSlotList();
+/// @brief 经过线程缓存访问内存池 申请释放先在线程缓存的弹匣上进行 弹匣用完或者满了才和仓库整个交换
+/// 线程缓存析构之后(线程退出时其他thread_local的析构以及进程退出时静态对象的析构) 直接访问内存池
+struct MagazineAccess
+{
+    static void* allocate(MemoryPool& pool, int index);
+    static void deallocate(MemoryPool& pool, void* ptr, int index);
+};
 
 
-    /// @brief 将内存槽压入无锁链表当中 前插
-    /// @param ptr 待插入的地址指针
-    /// @return 
-    bool pushFreeSlotList(Slot* ptr);
+/**
+ * 基于纪元(epoch)的延迟释放
+ * 无锁数据结构中的节点从结构中摘除后 其他线程可能还持有它的指针 不能立即归还给内存池
+ * 读取无锁结构之前通过EpochGuard进入临界区 线程记录进入时的全局纪元
+ * 摘除的节点通过retire放入当前线程的延迟释放列表 并记录当时的全局纪元
+ * 所有处于临界区的线程都已经看到当前全局纪元时 全局纪元才能加一
+ * 全局纪元比节点的纪元大2时 不可能还有线程持有该节点 可以真正释放
+ * 延迟释放列表每RETIRE_BATCH_SIZE个节点处理一次 推进纪元和扫描线程记录的开销分摊到整批节点上
+ */
+class EpochReclaimer
+{
+public:
+    /// @brief 进入临界区 可以嵌套 只有最外层记录纪元
+    static void enter();
 
+    /// @brief 离开临界区
+    static void leave();
 
-private:
+    /// @brief 延迟释放 所有线程都经过宽限期之后调用destroy 为空时直接归还给哈希桶
+    /// @param ptr 已经从无锁结构中摘除的地址
+    /// @param size 对象大小 用于计算哈希桶索引
+    /// @param destroy 释放时调用的函数 负责析构和归还内存
+    static void retire(void* ptr, size_t size, void (*destroy)(void*) = nullptr);
 
-    int m_slotSize;
-    int m_blockSize;
-    // Slot* m_freeSlotPtr;
-    std::atomic<Slot*> m_freeSlotPtr;
-    Slot* m_curSlotPtr;
-    Slot* m_lastSlotPtr;
-    Slot* m_firstBlockPtr;
+    /// @brief 尝试推进全局纪元 释放当前线程以及已退出线程中可以释放的节点
+    static void collect();
 
-    std::mutex m_blockMutex;
+    /// @brief 当前线程还没有释放的节点数量
+    static size_t getRetiredNums();
+};
 
+
+/// @brief 临界区守卫 构造时进入临界区 析构时离开
+class EpochGuard
+{
+public:
+    EpochGuard() { EpochReclaimer::enter(); }
+    ~EpochGuard() { EpochReclaimer::leave(); }
+
+    EpochGuard(const EpochGuard&) = delete;
+    EpochGuard& operator=(const EpochGuard&) = delete;
 };
 
 
-class HashBucket
+/// @brief 全局哈希桶 useMemory/freeMemory经过线程缓存的弹匣 并提供基于纪元的延迟释放
+class HashBucket : public memory_pool_basic::GlobalHashBucket<memory_pool_basic::LockFreePolicy, MagazineAccess>
 {
 public:
-    /// @brief 对哈希桶中的每个内存池块进行初始化
-    static void initMemoryPool();
+    /// @brief 获取索引位置上的弹匣仓库
+    /// @param index 哈希桶索引
+    static MagazineDepot& getMagazineDepot(int index);
 
+    /// @brief 延迟释放内存 等所有线程都经过宽限期之后再归还给内存池 用于无锁数据结构中摘除的节点
+    /// @param ptr 待释放的地址
+    /// @param size 对象大小 用于计算哈希桶索引
+    static void retire(void* ptr, size_t size)
+    {
+        EpochReclaimer::retire(ptr, size);
+    }
 
-    /// @brief 获取索引位置上的内存池
-    /// @param index 哈希桶索引 
-    /// @return 
-    static MemoryPool& getMemoryPool(int index);
+    /// @brief 延迟销毁对象 析构也推迟到宽限期之后 其他线程在此之前仍然可以读取对象
+    template<class T>
+    static void retireElement(T* ptr);
+};
 
+template<class T>
+void HashBucket::retireElement(T* ptr)
+{
+    if(!ptr)
+        return;
 
-    /// @brief 开辟内存空间 对allocate的包装
-    /// @param size 需要开辟的大小 用于计算哈希桶索引
-    /// @return void*指针
-    static void* useMemory(size_t size);
+    EpochReclaimer::retire(ptr, sizeof(T), [](void* p) {
+        static_cast<T*>(p)->~T();
+        HashBucket::freeMemory(p, sizeof(T));
+    });
+}
 
 
-    /// @brief 释放内存 归还给内存池
-    /// @param ptr 待归还的指针
-    /// @param size 对象大小 用于计算哈希桶索引
-    static void freeMemory(void* ptr, size_t size);
+/// @brief 类型是否提供了回收时的重置钩子 void poolReset()
+template<class T, class = void>
+struct HasPoolReset : std::false_type {};
 
+template<class T>
+struct HasPoolReset<T, std::void_t<decltype(std::declval<T&>().poolReset())>> : std::true_type {};
 
-    template<class T, class... Args>
-    static T* newElement(Args&&... args);
 
-    template<class T>
-    static void deleteElement(T* ptr);
+/**
+ * 类型化的对象池
+ * 每个类型拥有独立的内存池和空闲链表 不与其他大小相近的类型共用哈希桶
+ * 内存槽大小和对齐在编译期计算 按照alignof(T)对齐 支持超过8字节对齐的类型
+ *
+ * KeepConstructed模式(类型提供poolReset()时默认开启)类似slab的对象缓存:
+ * 归还的对象不析构 只调用poolReset()恢复到可复用的状态 放入已构造对象链表
+ * 再次申请时直接返回 跳过构造和析构 构造参数只在第一次构造时使用
+ * 此时链表指针放在对象之后 不会覆盖对象本身
+ */
+template<class T, bool KeepConstructed = HasPoolReset<T>::value>
+class ObjectPool
+{
+    static_assert(!KeepConstructed || HasPoolReset<T>::value, "keep-constructed mode requires T::poolReset()");
+
+    struct Node
+    {
+        std::atomic<Node*> next;
+    };
+
+    static constexpr size_t maxOf(size_t a, size_t b) { return a > b ? a : b; }
+    static constexpr size_t roundUp(size_t size, size_t align) { return (size + align - 1) / align * align; }
+
+public:
+    // 内存槽对齐 至少能放下链表指针
+    static constexpr size_t SLOT_ALIGN = maxOf(alignof(T), alignof(Node));
+
+    // 链表指针在内存槽中的偏移 KeepConstructed模式下位于对象之后
+    static constexpr size_t NODE_OFFSET = KeepConstructed ? roundUp(sizeof(T), alignof(Node)) : 0;
 
-    static void* allocate(size_t size)
+    // 内存槽大小 SLOT_ALIGN的整数倍 内存池按照内存槽大小对齐第一个内存槽 之后每个内存槽都满足对齐
+    static constexpr size_t SLOT_SIZE = roundUp(maxOf(NODE_OFFSET + sizeof(Node), sizeof(T)), SLOT_ALIGN);
+
+    /// @brief 构造函数
+    /// @param policy 内存池块的增长策略
+    constexpr explicit ObjectPool(const BlockGrowthPolicy& policy = BlockGrowthPolicy())
+        : m_pool(SLOT_SIZE, policy)
     {
-        return HashBucket::useMemory(size);
     }
 
-    static void deallocate(void* ptr, size_t size)
+    /// @brief 析构函数 析构已构造对象链表中的对象 内存由内存池统一释放
+    ~ObjectPool()
     {
-        HashBucket::freeMemory(ptr, size);
+        if constexpr (KeepConstructed)
+        {
+            while (Node* node = this->m_constructedList.pop())
+                objectOf(node)->~T();
+        }
     }
 
-};
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
 
-template <class T, class... Args>
-T *HashBucket::newElement(Args &&...args)
-{
-    void* addr = HashBucket::useMemory(sizeof(T));
-    if(!addr)
-        return nullptr;
-    else
+    /// @brief 每个类型默认的对象池
+    static ObjectPool& getInstance()
+    {
+        static ObjectPool pool;
+        return pool;
+    }
+
+    /// @brief 创建对象 KeepConstructed模式下优先返回已构造的对象 此时不使用构造参数
+    template<class... Args>
+    T* newElement(Args&&... args)
+    {
+        if constexpr (KeepConstructed)
+        {
+            if (Node* node = this->m_constructedList.pop())
+                return objectOf(node);
+        }
+
+        void* addr = this->m_pool.allocate();
+        if (!addr)
+            return nullptr;
         return new (addr) T(std::forward<Args>(args)...);
+    }
 
-}
+    /// @brief 归还对象 KeepConstructed模式下只调用poolReset 否则析构后归还内存
+    void deleteElement(T* ptr)
+    {
+        if (!ptr)
+            return;
+
+        if constexpr (KeepConstructed)
+        {
+            ptr->poolReset();
+            this->m_constructedList.push(nodeOf(ptr));
+        }
+        else
+        {
+            ptr->~T();
+            this->m_pool.deallocate(ptr);
+        }
+    }
 
-template <class T>
-void HashBucket::deleteElement(T* ptr)
-{
-    if(!ptr)
-        return;
+private:
+    static Node* nodeOf(T* ptr)
+    {
+        return reinterpret_cast<Node*>(reinterpret_cast<char*>(ptr) + NODE_OFFSET);
+    }
 
-    // 先析构
-    ptr->~T();
+    static T* objectOf(Node* node)
+    {
+        return reinterpret_cast<T*>(reinterpret_cast<char*>(node) - NODE_OFFSET);
+    }
 
-    // 在归还内存
-    void* p = reinterpret_cast<void*>(ptr);
-    HashBucket::freeMemory(p, sizeof(T));
-}
+private:
+    MemoryPool m_pool;
+    // 归还之后仍然保持构造状态的对象
+    TaggedStack<Node> m_constructedList;
+};
 };
 
 #endif // MEMORY_POOL_CAS_H
\ No newline at end of file
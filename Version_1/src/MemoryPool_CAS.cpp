@@ -1,199 +1,438 @@
 #include "MemoryPool_CAS.h"
 #include <assert.h>
 #include <thread>
+#include <utility>
+#include <algorithm>
+#include <new>
+#include <vector>
 
 namespace memory_pool_CAS
 {
-    MemoryPool::MemoryPool(size_t blockSize) : m_blockSize(blockSize)
+    MagazineDepot::~MagazineDepot()
     {
-    }
-
-    MemoryPool::~MemoryPool()
-    {
-        Slot *curNode = this->m_firstBlockPtr;
-        while (curNode != nullptr)
+        this->m_fullMagazines.clear();
+        this->m_emptyMagazines.clear();
+        Magazine *magazine = this->m_allMagazines.exchange(nullptr, std::memory_order_acquire);
+        while (magazine != nullptr)
         {
-            Slot *delNode = curNode;
-            curNode = curNode->next;
-            operator delete(reinterpret_cast<void *>(delNode));
+            Magazine *delMagazine = magazine;
+            magazine = magazine->allNext;
+            delete delMagazine;
         }
-        this->m_firstBlockPtr = nullptr;
     }
 
-    void MemoryPool::init(size_t slotSize)
+    MagazineDepot::Magazine *MagazineDepot::exchangeFullMagazine(Magazine *empty)
     {
-        assert(slotSize > 0);
-        this->m_slotSize = slotSize;
-        this->m_freeSlotPtr = nullptr;
-        this->m_curSlotPtr = nullptr;
-        this->m_lastSlotPtr = nullptr;
-        this->m_firstBlockPtr = nullptr;
+        assert(empty != nullptr && empty->count == 0);
+
+        Magazine *full = this->m_fullMagazines.pop();
+        if (full)
+            this->m_emptyMagazines.push(empty);
+        return full;
     }
 
-    void *MemoryPool::allocate()
+    MagazineDepot::Magazine *MagazineDepot::exchangeEmptyMagazine(Magazine *full)
     {
-        Slot *ptr = this->popFreeSlotList();
-        if (ptr != nullptr)
-            return ptr;
-
-        Slot *addr = nullptr;
-        {
-            std::lock_guard<std::mutex> lock(this->m_blockMutex);
+        assert(full != nullptr && full->count > 0);
 
-            if (this->m_curSlotPtr >= this->m_lastSlotPtr)
-                this->allocateNewBlock();
+        this->m_fullMagazines.push(full);
+        return this->getEmptyMagazine();
+    }
 
-            addr = this->m_curSlotPtr;
-            this->m_curSlotPtr = reinterpret_cast<Slot *>(reinterpret_cast<char *>(this->m_curSlotPtr) + this->m_slotSize);
+    MagazineDepot::Magazine *MagazineDepot::getEmptyMagazine()
+    {
+        Magazine *empty = this->m_emptyMagazines.pop();
+        if (!empty)
+        {
+            empty = new Magazine;
+            empty->next.store(nullptr, std::memory_order_relaxed);
+            empty->allNext = this->m_allMagazines.load(std::memory_order_relaxed);
+            while (!this->m_allMagazines.compare_exchange_weak(empty->allNext, empty,
+                                                               std::memory_order_release, std::memory_order_relaxed))
+                ;
         }
-
-        return addr;
+        empty->count = 0;
+        return empty;
     }
 
-    void MemoryPool::deallocate(void *ptr)
+    void MagazineDepot::returnMagazine(Magazine *magazine)
     {
-        assert(ptr != nullptr);
-
-        Slot *addr = reinterpret_cast<Slot *>(ptr);
-        this->pushFreeSlotList(addr);
+        if (magazine->count > 0)
+            this->m_fullMagazines.push(magazine);
+        else
+            this->m_emptyMagazines.push(magazine);
     }
 
-    void MemoryPool::allocateNewBlock()
+    namespace
     {
-        // 申请一块内存池块
-        void *newBlockAddr = operator new(this->m_blockSize);
+        /// @brief 每个哈希桶的弹匣仓库 和哈希桶一样常量初始化并且不会析构
+        /// 静态对象析构时主线程的线程缓存已经析构 弹匣已经交还 之后的申请释放依靠t_magazineCacheDestroyed直接使用内存池
+        /// EpochReclaimer不在此列: 线程的纪元状态析构之后 本线程不能再进入临界区或者retire
+        struct MagazineDepotArray
+        {
+            constexpr MagazineDepotArray() : depots() {}
 
-        // 更新 this->m_firstBlockPtr;
-        reinterpret_cast<Slot *>(newBlockAddr)->next = this->m_firstBlockPtr;
-        this->m_firstBlockPtr = reinterpret_cast<Slot *>(newBlockAddr);
+            ~MagazineDepotArray() {}
 
-        // 内存对齐
-        char *alignStartAddr = reinterpret_cast<char *>(newBlockAddr) + sizeof(Slot *);
-        size_t padSize = this->padPointer(alignStartAddr, this->m_slotSize);
-        char *alignEndAddr = alignStartAddr + padSize;
+            union
+            {
+                MagazineDepot depots[MEMORYPOOL_MAX_NUM];
+            };
+        };
+
+        MagazineDepotArray s_magazineDepots;
+
+        /**
+         * 线程缓存 每个哈希桶持有两个弹匣
+         * 申请和释放只在当前弹匣上进行 不需要任何原子操作
+         * 当前弹匣用完(申请时为空 释放时已满)时先和备用弹匣交换 两个都不满足时才和仓库整个交换
+         * 两个弹匣避免了申请释放在弹匣边界来回切换时每次都访问仓库
+         */
+        class MagazineCache
+        {
+        public:
+            ~MagazineCache();
 
-        // 内存槽开始位置 结束位置标志
-        this->m_curSlotPtr = reinterpret_cast<Slot *>(alignEndAddr);
+            void *allocate(MemoryPool &pool, int index)
+            {
+                MagazineDepot &depot = HashBucket::getMagazineDepot(index);
+                Bucket &bucket = this->getBucket(depot, index);
+
+                if (bucket.loaded->count == 0)
+                {
+                    if (bucket.previous->count > 0)
+                    {
+                        std::swap(bucket.loaded, bucket.previous);
+                    }
+                    else
+                    {
+                        // 两个弹匣都为空 用空弹匣换一个满弹匣 仓库中也没有时直接从内存池申请
+                        MagazineDepot::Magazine *full = depot.exchangeFullMagazine(bucket.previous);
+                        if (!full)
+                            return pool.allocate();
+                        bucket.previous = bucket.loaded;
+                        bucket.loaded = full;
+                    }
+                }
+                return bucket.loaded->slots[--bucket.loaded->count];
+            }
 
-        this->m_lastSlotPtr = reinterpret_cast<Slot *>(
-            reinterpret_cast<char *>(newBlockAddr) + this->m_blockSize - this->m_slotSize + 1);
+            void deallocate(void *ptr, int index)
+            {
+                MagazineDepot &depot = HashBucket::getMagazineDepot(index);
+                Bucket &bucket = this->getBucket(depot, index);
+
+                if (bucket.loaded->count == MAGAZINE_SIZE)
+                {
+                    if (bucket.previous->count < MAGAZINE_SIZE)
+                    {
+                        std::swap(bucket.loaded, bucket.previous);
+                    }
+                    else
+                    {
+                        // 两个弹匣都满了 用满弹匣换一个空弹匣
+                        MagazineDepot::Magazine *empty = depot.exchangeEmptyMagazine(bucket.previous);
+                        bucket.previous = bucket.loaded;
+                        bucket.loaded = empty;
+                    }
+                }
+                bucket.loaded->slots[bucket.loaded->count++] = ptr;
+            }
 
-        // 空闲内存槽链表指针
-        this->m_freeSlotPtr = nullptr;
-    }
+        private:
+            struct Bucket
+            {
+                MagazineDepot::Magazine *loaded = nullptr;
+                MagazineDepot::Magazine *previous = nullptr;
+            };
 
-    size_t MemoryPool::padPointer(char *ptr, size_t align)
-    {
-        assert(ptr != nullptr && align > 0);
+            Bucket &getBucket(MagazineDepot &depot, int index)
+            {
+                Bucket &bucket = this->m_buckets[index];
+                if (!bucket.loaded)
+                {
+                    bucket.loaded = depot.getEmptyMagazine();
+                    bucket.previous = depot.getEmptyMagazine();
+                }
+                return bucket;
+            }
+
+        private:
+            Bucket m_buckets[MEMORYPOOL_MAX_NUM];
+        };
 
-        return (align - reinterpret_cast<size_t>(ptr)) % align;
+        thread_local MagazineCache t_magazineCache;
 
-        // // char*转为size_t
-        // size_t addr = reinterpret_cast<size_t>(ptr);
+        // 线程缓存析构之后为true 之后本线程的申请释放不再经过弹匣 直接使用内存池
+        // 线程退出时其他thread_local的析构以及进程退出时静态对象的析构都在线程缓存析构之后
+        // 没有析构函数 常量初始化 读取时不需要检查是否已经初始化
+        thread_local bool t_magazineCacheDestroyed = false;
 
-        // // addr相对于align内存槽大小的偏移
-        // size_t offset = addr % align;
+        MagazineCache::~MagazineCache()
+        {
+            // 线程退出时弹匣中的内存槽交还给仓库 其他线程可以继续使用
+            // 弹匣归还之后属于仓库 本线程不能再使用
+            for (int i = 0; i < MEMORYPOOL_MAX_NUM; ++i)
+            {
+                Bucket &bucket = this->m_buckets[i];
+                if (!bucket.loaded)
+                    continue;
+                MagazineDepot &depot = HashBucket::getMagazineDepot(i);
+                depot.returnMagazine(bucket.loaded);
+                depot.returnMagazine(bucket.previous);
+                bucket.loaded = nullptr;
+                bucket.previous = nullptr;
+            }
+            t_magazineCacheDestroyed = true;
+        }
+    }
 
-        // // 计算需要填补的内存大小
-        // // size_t padSize = (align - offset) % align;
+    void *MagazineAccess::allocate(MemoryPool &pool, int index)
+    {
+        if (__builtin_expect(t_magazineCacheDestroyed, 0))
+            return pool.allocate();
+        return t_magazineCache.allocate(pool, index);
+    }
 
-        // size_t padSize = (offset == 0) ? 0 : (align - offset) % align;
+    void MagazineAccess::deallocate(MemoryPool &pool, void *ptr, int index)
+    {
+        if (__builtin_expect(t_magazineCacheDestroyed, 0))
+            return pool.deallocate(ptr);
+        t_magazineCache.deallocate(ptr, index);
+    }
 
-        // return padSize;
+    MagazineDepot &HashBucket::getMagazineDepot(int index)
+    {
+        return s_magazineDepots.depots[index];
     }
 
-    MemoryPool::Slot *MemoryPool::popFreeSlotList()
+    namespace
     {
+        /// @brief 等待释放的节点
+        struct RetiredNode
+        {
+            void *ptr;
+            size_t size;
+            void (*destroy)(void *);
+            uint64_t epoch; // retire时的全局纪元
+        };
+
+        /// @brief 线程记录 临界区中的线程在这里公布进入时的全局纪元
+        /// 线程退出后记录留给之后的线程复用 不会释放
+        struct alignas(64) ThreadRecord
+        {
+            std::atomic<uint64_t> state{0}; // 最低位表示是否处于临界区 其余位为进入时的全局纪元
+            std::atomic<bool> inUse{true};
+            ThreadRecord *next = nullptr;
+        };
+
+        /// @brief 已退出线程留下的还不能释放的节点 由之后调用collect的线程接管
+        struct OrphanBatch
+        {
+            OrphanBatch *next;
+            std::vector<RetiredNode> nodes;
+        };
+
+        std::atomic<uint64_t> s_globalEpoch{0};
+        // 所有线程记录组成的链表 只会压入
+        std::atomic<ThreadRecord *> s_threadRecords{nullptr};
+        std::atomic<OrphanBatch *> s_orphanBatches{nullptr};
+        std::mutex s_orphanMutex;
 
-        while (true)
+        void reclaim(const RetiredNode &node)
         {
-            Slot *oldHead = this->m_freeSlotPtr.load(std::memory_order_acquire);
-            // 空闲内存槽为空 此时直接返回即可
-            if (!oldHead)
-                return nullptr;
-
-            // 获取下一个节点
-            Slot *next;
-            try
+            if (node.destroy)
+                node.destroy(node.ptr);
+            else
+                HashBucket::freeMemory(node.ptr, node.size);
+        }
+
+        /**
+         * 线程的纪元状态和延迟释放列表
+         * 线程退出时不释放任何节点(此时线程缓存可能已经析构) 只把剩余节点交给其他线程
+         */
+        class EpochLocal
+        {
+        public:
+            ~EpochLocal()
             {
-                next = oldHead->next.load(std::memory_order_relaxed);
+                if (!this->m_retired.empty())
+                {
+                    OrphanBatch *batch = new OrphanBatch{nullptr, std::move(this->m_retired)};
+                    std::lock_guard<std::mutex> lock(s_orphanMutex);
+                    batch->next = s_orphanBatches.load(std::memory_order_relaxed);
+                    s_orphanBatches.store(batch, std::memory_order_release);
+                }
+                if (this->m_record)
+                {
+                    this->m_record->state.store(0, std::memory_order_release);
+                    this->m_record->inUse.store(false, std::memory_order_release);
+                }
             }
-            catch (...)
+
+            void enter()
             {
-                continue;
+                if (this->m_nesting++ > 0)
+                    return;
+                // 先公布纪元再读取无锁结构 全局纪元在两者之间推进时公布的纪元偏旧 只会让释放更保守
+                uint64_t epoch = s_globalEpoch.load(std::memory_order_relaxed);
+                this->getRecord()->state.store((epoch << 1) | 1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
             }
 
-            // 更新头节点
-            if (this->m_freeSlotPtr.compare_exchange_weak(
-                    oldHead, next,
-                    std::memory_order_acquire,
-                    std::memory_order_relaxed))
+            void leave()
             {
-                return oldHead;
+                assert(this->m_nesting > 0);
+                if (--this->m_nesting == 0)
+                    this->m_record->state.store(0, std::memory_order_release);
             }
-        }
-        return nullptr;
-    }
 
-    bool MemoryPool::pushFreeSlotList(Slot *ptr)
-    {
-        while (true)
-        {
-            // 获取当前头节点 作为expect使用
-            Slot *oldHead = this->m_freeSlotPtr.load(std::memory_order_relaxed);
+            void retire(void *ptr, size_t size, void (*destroy)(void *))
+            {
+                // 节点已经从无锁结构中摘除 摘除之后再读取全局纪元
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                uint64_t epoch = s_globalEpoch.load(std::memory_order_relaxed);
+                this->m_retired.push_back({ptr, size, destroy, epoch});
+                if (this->m_retired.size() >= this->m_collectThreshold)
+                    this->collect();
+            }
 
-            // 当前内存槽的next指针指向oldHead
-            ptr->next.store(oldHead, std::memory_order_relaxed);
+            void collect()
+            {
+                /**
+                 * 批量释放
+                 * 整体流程:
+                 * 接管已退出线程留下的节点;
+                 * 尝试推进全局纪元 释放纪元比当前全局纪元小2及以上的节点;
+                 * 剩余节点留在列表中 下一次在此基础上再积累一批之后处理;
+                 * 释放函数中可能再次调用retire 处理期间新加入的节点直接留到下一次;
+                 */
+                if (this->m_collecting)
+                    return;
+                this->m_collecting = true;
+
+                this->adoptOrphans();
+                uint64_t epoch = tryAdvance();
+
+                std::vector<RetiredNode> nodes;
+                nodes.swap(this->m_retired);
+                for (const RetiredNode &node : nodes)
+                {
+                    if (node.epoch + 2 <= epoch)
+                        reclaim(node);
+                    else
+                        this->m_retired.push_back(node);
+                }
+                this->m_collectThreshold = this->m_retired.size() + RETIRE_BATCH_SIZE;
+
+                this->m_collecting = false;
+            }
 
-            // 通过compare_exchange_weak判断
-            // 如果头节点仍然是原来的那一个(确保其他线程没有改动 仍然是在自己这个线程当中) 就把当前链表头指针指向新添加的内存槽地址
-            // 如果失败则下一个while循环重新尝试
-            if (this->m_freeSlotPtr.compare_exchange_weak(oldHead, ptr, std::memory_order_release, std::memory_order_relaxed))
+            size_t getRetiredNums() const
             {
-                return true;
+                return this->m_retired.size();
             }
-        }
-        return false;
+
+        private:
+            /// @brief 所有临界区中的线程都已经看到当前全局纪元时推进一次
+            /// @return 推进之后的全局纪元
+            static uint64_t tryAdvance()
+            {
+                uint64_t epoch = s_globalEpoch.load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                for (ThreadRecord *record = s_threadRecords.load(std::memory_order_acquire); record; record = record->next)
+                {
+                    uint64_t state = record->state.load(std::memory_order_relaxed);
+                    if ((state & 1) && (state >> 1) != epoch)
+                        return epoch;
+                }
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (s_globalEpoch.compare_exchange_strong(epoch, epoch + 1, std::memory_order_acq_rel, std::memory_order_relaxed))
+                    return epoch + 1;
+                return epoch;
+            }
+
+            void adoptOrphans()
+            {
+                if (!s_orphanBatches.load(std::memory_order_acquire))
+                    return;
+
+                OrphanBatch *batch;
+                {
+                    std::lock_guard<std::mutex> lock(s_orphanMutex);
+                    batch = s_orphanBatches.exchange(nullptr, std::memory_order_acquire);
+                }
+                while (batch)
+                {
+                    OrphanBatch *next = batch->next;
+                    this->m_retired.insert(this->m_retired.end(), batch->nodes.begin(), batch->nodes.end());
+                    delete batch;
+                    batch = next;
+                }
+            }
+
+            ThreadRecord *getRecord()
+            {
+                if (this->m_record)
+                    return this->m_record;
+
+                // 优先复用已退出线程的记录
+                for (ThreadRecord *record = s_threadRecords.load(std::memory_order_acquire); record; record = record->next)
+                {
+                    bool expected = false;
+                    if (!record->inUse.load(std::memory_order_relaxed) &&
+                        record->inUse.compare_exchange_strong(expected, true, std::memory_order_acquire))
+                    {
+                        this->m_record = record;
+                        return record;
+                    }
+                }
+
+                ThreadRecord *record = new ThreadRecord;
+                record->next = s_threadRecords.load(std::memory_order_relaxed);
+                while (!s_threadRecords.compare_exchange_weak(record->next, record,
+                                                              std::memory_order_release, std::memory_order_relaxed))
+                    ;
+                this->m_record = record;
+                return record;
+            }
+
+        private:
+            ThreadRecord *m_record = nullptr;
+            int m_nesting = 0;
+            bool m_collecting = false;
+            size_t m_collectThreshold = RETIRE_BATCH_SIZE;
+            std::vector<RetiredNode> m_retired;
+        };
+
+        thread_local EpochLocal t_epochLocal;
     }
 
-    void HashBucket::initMemoryPool()
+    void EpochReclaimer::enter()
     {
-        for (int i = 0; i < MEMORYPOOL_MAX_NUM; ++i)
-        {
-            HashBucket::getMemoryPool(i).init((i + 1) * SLOT_BASE_SIZE);
-        }
+        t_epochLocal.enter();
     }
 
-    MemoryPool &HashBucket::getMemoryPool(int index)
+    void EpochReclaimer::leave()
     {
-        static MemoryPool memoryPool[MEMORYPOOL_MAX_NUM];
-        return memoryPool[index];
+        t_epochLocal.leave();
     }
 
-    void *HashBucket::useMemory(size_t size)
+    void EpochReclaimer::retire(void *ptr, size_t size, void (*destroy)(void *))
     {
         assert(size > 0);
-        if (size > SLOT_MAX_SIZE)
-            return operator new(size);
-        else
-        {
-            int hashIdx = (size - 1) / 8;
-            // int hashIdx = (size + SLOT_BASE_SIZE - 1) / SLOT_BASE_SIZE  - 1;
-            return HashBucket::getMemoryPool(hashIdx).allocate();
-        }
-        return nullptr;
+        if (!ptr)
+            return;
+        t_epochLocal.retire(ptr, size, destroy);
     }
 
-    void HashBucket::freeMemory(void *ptr, size_t size)
+    void EpochReclaimer::collect()
     {
-        if (!ptr)
-            return;
-        if (size > SLOT_MAX_SIZE)
-            operator delete(ptr);
-        else
-        {
-            int hashIdx = (size - 1) / 8;
-            HashBucket::getMemoryPool(hashIdx).deallocate(ptr);
-        }
+        t_epochLocal.collect();
+    }
+
+    size_t EpochReclaimer::getRetiredNums()
+    {
+        return t_epochLocal.getRetiredNums();
     }
 };
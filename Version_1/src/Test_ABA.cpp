@@ -0,0 +1,146 @@
+/**
+ * 无锁链表ABA问题的压力测试
+ * 多个线程在同一个内存池上反复弹出1~4个内存槽再按照随机顺序压回 让空闲链表头在极短时间内变回原来的地址
+ * 而它后面的节点已经改变
+ * 如果弹出时只比较地址 线程A读到 head=X next=Y 后被切换 其他线程弹出X、Y再压回X
+ * A的CAS仍然成功 把已经分配出去的Y重新挂回链表头 同一个内存槽被分配两次
+ *
+ * 核数较少的机器上线程很少恰好在读取next和CAS之间被切换 测试期间开启一个高精度定时器
+ * 每隔几微秒向进程发送一次信号 内核把信号交给正在运行的线程 信号处理函数中调用sched_yield
+ * 相当于在任意指令处强制切换线程
+ *
+ * 检测方法: 内存槽的第二个8字节(链表指针之后)保存当前持有者 申请后写入自己的编号
+ * 如果写入前已经是其他线程的编号 或者归还前被其他线程改写 说明同一个内存槽同时被两个线程持有
+ */
+#include "MemoryPool_CAS.h"
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <utility>
+#include <cstdint>
+#include <signal.h>
+#include <sched.h>
+#include <time.h>
+
+using namespace memory_pool_CAS;
+using Clock = std::chrono::steady_clock;
+
+constexpr int loopNums = 200000;
+constexpr size_t slotSize = 16;
+// 强制切换线程的间隔
+constexpr long preemptIntervalNs = 20000;
+// 持有者编号 取不容易和未初始化内存重合的值
+constexpr uint64_t ownerBase = 0xABA0000000000000ull;
+
+std::atomic<size_t> duplicateNums{0};
+
+void onPreemptSignal(int)
+{
+    sched_yield();
+}
+
+std::atomic<uint64_t>& ownerOf(void* slot)
+{
+    return *reinterpret_cast<std::atomic<uint64_t>*>(static_cast<char*>(slot) + sizeof(void*));
+}
+
+void acquire(void* slot, uint64_t owner)
+{
+    uint64_t prev = ownerOf(slot).exchange(owner, std::memory_order_acq_rel);
+    if ((prev & 0xFFFF000000000000ull) == ownerBase && prev != owner)
+        duplicateNums.fetch_add(1, std::memory_order_relaxed);
+}
+
+void release(void* slot, uint64_t owner)
+{
+    uint64_t expected = owner;
+    if (!ownerOf(slot).compare_exchange_strong(expected, 0, std::memory_order_acq_rel))
+        duplicateNums.fetch_add(1, std::memory_order_relaxed);
+}
+
+void stressTask(MemoryPool& pool, int id)
+{
+    uint64_t owner = ownerBase | static_cast<uint64_t>(id + 1);
+    uint32_t random = 2463534242u + id;
+    void* held[4];
+    for (int i = 0; i < loopNums; ++i)
+    {
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+
+        int count = 1 + random % 4;
+        for (int j = 0; j < count; ++j)
+        {
+            held[j] = pool.allocate();
+            acquire(held[j], owner);
+        }
+        // 随机交换一次 改变压回的顺序
+        std::swap(held[0], held[(random >> 8) % count]);
+        for (int j = 0; j < count; ++j)
+        {
+            release(held[j], owner);
+            pool.deallocate(held[j]);
+        }
+    }
+}
+
+int main()
+{
+    MemoryPool& pool = HashBucket::getMemoryPool(slotSize / SLOT_BASE_SIZE - 1);
+
+    int threadNums = static_cast<int>(std::max(8u, 2 * std::thread::hardware_concurrency()));
+
+    struct sigaction action = {};
+    action.sa_handler = onPreemptSignal;
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGUSR1, &action, nullptr);
+
+    struct sigevent event = {};
+    event.sigev_notify = SIGEV_SIGNAL;
+    event.sigev_signo = SIGUSR1;
+    timer_t timer;
+    bool hasTimer = timer_create(CLOCK_MONOTONIC, &event, &timer) == 0;
+
+    // 预先放入少量内存槽 链表越短 链表头越频繁地回到同一个地址
+    std::vector<void*> slots;
+    for (int i = 0; i < threadNums * 2; ++i)
+    {
+        void* slot = pool.allocate();
+        ownerOf(slot).store(0, std::memory_order_relaxed);
+        slots.push_back(slot);
+    }
+    for (void* slot : slots)
+        pool.deallocate(slot);
+
+    if (hasTimer)
+    {
+        struct itimerspec spec = {};
+        spec.it_value.tv_nsec = preemptIntervalNs;
+        spec.it_interval.tv_nsec = preemptIntervalNs;
+        timer_settime(timer, 0, &spec, nullptr);
+    }
+
+    auto start = Clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < threadNums; ++i)
+        threads.emplace_back(stressTask, std::ref(pool), i);
+    for (auto& t : threads)
+        t.join();
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+    if (hasTimer)
+        timer_delete(timer);
+
+    size_t duplicates = duplicateNums.load();
+    std::cout << threadNums << " threads x " << loopNums << " rounds, " << ms << " ms, "
+              << duplicates << " duplicate allocations" << std::endl;
+    if (duplicates != 0)
+    {
+        std::cout << "ABA test failed" << std::endl;
+        return 1;
+    }
+    std::cout << "ABA test passed" << std::endl;
+    return 0;
+}
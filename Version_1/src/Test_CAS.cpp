@@ -222,8 +222,6 @@ double computeAverage(const std::vector<double>& v) {
 }
 
 int main() {
-    HashBucket::initMemoryPool();
-
     // 🔁 预热内存池
     useMemoryPoolTask();
 
@@ -0,0 +1,191 @@
+/**
+ * 基于纪元的延迟释放测试
+ * 1. 宽限期: 一个线程停留在临界区中时 其他线程retire的节点一个都不能释放 离开之后全部释放
+ * 2. 无锁栈压力测试: 多个线程在同一个Treiber栈上压入弹出 弹出的节点通过retireElement延迟销毁
+ *    弹出时读取的栈顶节点如果已经析构(magic被改写) 说明节点在其他线程还持有时就被释放了
+ *    节点在宽限期之后才会回到内存池 也就不会出现栈顶地址被复用导致的ABA问题
+ * 3. 已退出线程留下的节点由之后调用collect的线程接管释放 最终析构次数等于申请次数
+ */
+#include "MemoryPool_CAS.h"
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+using namespace memory_pool_CAS;
+using Clock = std::chrono::steady_clock;
+
+constexpr int threadNums = 4;
+constexpr int loopNums = 200000;
+constexpr uint64_t ALIVE = 0xA11CEA11CEA11CEull;
+constexpr uint64_t DEAD = 0xDEADDEADDEADDEADull;
+
+std::atomic<int> constructNums{0};
+std::atomic<int> destructNums{0};
+std::atomic<int> useAfterFreeNums{0};
+
+struct Node
+{
+    explicit Node(int v) : magic(ALIVE), next(nullptr), value(v) { constructNums++; }
+    ~Node()
+    {
+        magic.store(DEAD, std::memory_order_relaxed);
+        destructNums++;
+    }
+
+    std::atomic<uint64_t> magic;
+    Node* next;
+    int value;
+};
+
+class LockFreeStack
+{
+public:
+    void push(int value)
+    {
+        Node* node = HashBucket::newElement<Node>(value);
+        node->next = this->m_top.load(std::memory_order_relaxed);
+        while (!this->m_top.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed))
+            ;
+    }
+
+    bool pop(int& value)
+    {
+        EpochGuard guard;
+        Node* top = this->m_top.load(std::memory_order_acquire);
+        while (top)
+        {
+            // 临界区中读到的节点即使已经被其他线程弹出 也还没有析构
+            if (top->magic.load(std::memory_order_relaxed) != ALIVE)
+                useAfterFreeNums++;
+            if (this->m_top.compare_exchange_weak(top, top->next, std::memory_order_acq_rel, std::memory_order_acquire))
+                break;
+        }
+        if (!top)
+            return false;
+        value = top->value;
+        HashBucket::retireElement(top);
+        return true;
+    }
+
+private:
+    std::atomic<Node*> m_top{nullptr};
+};
+
+bool collectAll()
+{
+    // 第一次接管已退出线程的节点 之后每次推进一个纪元
+    for (int i = 0; i < 8 && EpochReclaimer::getRetiredNums() > 0; ++i)
+        EpochReclaimer::collect();
+    EpochReclaimer::collect();
+    return EpochReclaimer::getRetiredNums() == 0;
+}
+
+bool testGracePeriod()
+{
+    int constructBase = constructNums.load();
+    int destructBase = destructNums.load();
+    const int retireNums = 4 * RETIRE_BATCH_SIZE;
+
+    std::atomic<bool> pinned{false};
+    std::atomic<bool> retired{false};
+    std::atomic<bool> released{false};
+    int destructWhilePinned = -1;
+
+    std::thread reader([&] {
+        EpochReclaimer::enter();
+        pinned = true;
+        while (!retired)
+            std::this_thread::yield();
+        EpochReclaimer::leave();
+        released = true;
+    });
+
+    while (!pinned)
+        std::this_thread::yield();
+
+    std::vector<Node*> nodes;
+    for (int i = 0; i < retireNums; ++i)
+        nodes.push_back(HashBucket::newElement<Node>(i));
+    for (Node* node : nodes)
+        HashBucket::retireElement(node);
+    for (int i = 0; i < 8; ++i)
+        EpochReclaimer::collect();
+    destructWhilePinned = destructNums.load() - destructBase;
+
+    retired = true;
+    while (!released)
+        std::this_thread::yield();
+    reader.join();
+
+    bool collected = collectAll();
+    bool ok = destructWhilePinned == 0 && collected &&
+              destructNums.load() - destructBase == retireNums &&
+              constructNums.load() - constructBase == retireNums;
+    std::cout << "grace period: " << destructWhilePinned << " reclaimed while pinned, "
+              << destructNums.load() - destructBase << "/" << retireNums << " reclaimed after" << std::endl;
+    return ok;
+}
+
+bool testStack()
+{
+    LockFreeStack stack;
+    std::atomic<long long> pushSum{0};
+    std::atomic<long long> popSum{0};
+
+    auto start = Clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadNums; ++t)
+    {
+        threads.emplace_back([&, t] {
+            long long pushed = 0;
+            long long popped = 0;
+            int value;
+            for (int i = 0; i < loopNums; ++i)
+            {
+                int v = t * loopNums + i;
+                stack.push(v);
+                pushed += v;
+                if (i % 2 == 1)
+                {
+                    for (int j = 0; j < 2; ++j)
+                        if (stack.pop(value))
+                            popped += value;
+                }
+            }
+            pushSum += pushed;
+            popSum += popped;
+        });
+    }
+    for (auto& th : threads)
+        th.join();
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+
+    int value;
+    long long rest = 0;
+    while (stack.pop(value))
+        rest += value;
+
+    bool collected = collectAll();
+    std::cout << threadNums << " threads x " << loopNums << " push/pop: " << ms << " ms, "
+              << useAfterFreeNums.load() << " use-after-free" << std::endl;
+    return useAfterFreeNums.load() == 0 && collected && pushSum.load() == popSum.load() + rest;
+}
+
+int main()
+{
+    bool ok = testGracePeriod();
+    ok = testStack() && ok;
+    ok = constructNums.load() == destructNums.load() && ok;
+    std::cout << "constructed " << constructNums.load() << ", destructed " << destructNums.load() << std::endl;
+
+    if (!ok)
+    {
+        std::cout << "Epoch test failed" << std::endl;
+        return 1;
+    }
+    std::cout << "Epoch test passed" << std::endl;
+    return 0;
+}
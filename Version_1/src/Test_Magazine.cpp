@@ -0,0 +1,126 @@
+/**
+ * 线程缓存(弹匣)构造之前和析构之后的申请释放
+ * 0. 静态初始化时 内存池是常量初始化的 其他静态对象的构造函数中就可以申请内存槽
+ * 1. 线程退出时 比线程缓存先构造的thread_local对象在线程缓存析构之后才析构 析构中释放并重新申请内存槽
+ * 2. 进程退出时 静态对象在主线程的线程缓存析构之后才析构 析构中释放并重新申请内存槽
+ * 线程缓存析构时已经把弹匣交还给内存池 之后如果仍然使用这些弹匣 同一个内存槽会被分配两次
+ * 检测方法: 重新申请得到的内存槽写入各自的编号 全部申请完之后再检查编号是否被改写
+ */
+#include "MemoryPool_CAS.h"
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <cstdlib>
+
+using namespace memory_pool_CAS;
+
+constexpr int slotNums = 2000;
+constexpr size_t slotSize = 64;
+
+std::atomic<size_t> duplicateNums{0};
+
+/// @brief 释放持有的内存槽 再申请同样数量的内存槽 检查有没有重复分配
+void recycle(std::vector<void*>& slots)
+{
+    for (void* ptr : slots)
+        HashBucket::freeMemory(ptr, slotSize);
+    slots.clear();
+
+    for (int i = 0; i < slotNums; ++i)
+    {
+        void* ptr = HashBucket::useMemory(slotSize);
+        *static_cast<size_t*>(ptr) = i;
+        slots.push_back(ptr);
+    }
+    for (int i = 0; i < slotNums; ++i)
+    {
+        if (*static_cast<size_t*>(slots[i]) != static_cast<size_t>(i))
+            duplicateNums.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+/// @brief 析构时回收内存槽 线程退出和进程退出时都在线程缓存析构之后
+struct SlotHolder
+{
+    std::vector<void*> slots;
+    bool checkAtExit = false;
+
+    ~SlotHolder()
+    {
+        recycle(this->slots);
+        for (void* ptr : this->slots)
+            HashBucket::freeMemory(ptr, slotSize);
+
+        // 静态对象析构时main已经返回 发现重复分配时通过退出码报告
+        if (this->checkAtExit)
+        {
+            if (duplicateNums.load() != 0)
+            {
+                std::cout << "static destruction: " << duplicateNums.load() << " duplicate slots" << std::endl;
+                std::_Exit(1);
+            }
+            std::cout << "static destruction: no duplicate slots" << std::endl;
+        }
+    }
+};
+
+/// @brief 构造时申请内存槽 动态初始化 和内存池的初始化顺序无关
+struct StaticInitHolder
+{
+    std::vector<void*> slots;
+
+    StaticInitHolder()
+    {
+        for (int i = 0; i < slotNums; ++i)
+        {
+            void* ptr = HashBucket::useMemory(slotSize);
+            *static_cast<size_t*>(ptr) = i;
+            this->slots.push_back(ptr);
+        }
+    }
+};
+
+StaticInitHolder g_staticInitHolder;
+SlotHolder g_staticHolder;
+
+void threadExitTask()
+{
+    // 先构造 thread_local按照构造的逆序析构 所以在线程缓存之后析构
+    thread_local SlotHolder holder;
+    for (int i = 0; i < slotNums; ++i)
+        holder.slots.push_back(HashBucket::useMemory(slotSize));
+}
+
+int main()
+{
+    for (int i = 0; i < slotNums; ++i)
+    {
+        if (*static_cast<size_t*>(g_staticInitHolder.slots[i]) != static_cast<size_t>(i))
+            duplicateNums.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (duplicateNums.load() != 0)
+    {
+        std::cout << "static initialization: " << duplicateNums.load() << " duplicate slots" << std::endl;
+        return 1;
+    }
+    std::cout << "static initialization: no duplicate slots" << std::endl;
+    // 静态初始化时申请的内存槽在进程退出时和其他内存槽一起检查
+    g_staticHolder.slots.swap(g_staticInitHolder.slots);
+
+    for (int i = 0; i < 4; ++i)
+        std::thread(threadExitTask).join();
+
+    if (duplicateNums.load() != 0)
+    {
+        std::cout << "thread exit: " << duplicateNums.load() << " duplicate slots" << std::endl;
+        return 1;
+    }
+    std::cout << "thread exit: no duplicate slots" << std::endl;
+
+    // 进程退出时检查 主线程的线程缓存已经构造
+    for (int i = 0; i < slotNums; ++i)
+        g_staticHolder.slots.push_back(HashBucket::useMemory(slotSize));
+    g_staticHolder.checkAtExit = true;
+    return 0;
+}
@@ -0,0 +1,201 @@
+/**
+ * 类型化对象池的测试
+ * 1. 普通模式: 每次申请都构造 每次归还都析构 构造和析构次数一致
+ * 2. 超过8字节对齐的类型: 每个对象的地址都满足alignof(T)
+ * 3. 保持构造模式: 归还的对象只调用poolReset 再次申请时不重新构造 对象池析构时才统一析构
+ * 4. 和按照大小分桶的newElement对比申请/归还的耗时
+ */
+#include "MemoryPool_CAS.h"
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include <atomic>
+#include <assert.h>
+
+using namespace memory_pool_CAS;
+using Clock = std::chrono::steady_clock;
+
+constexpr int loopNums = 1000000;
+constexpr int batchNums = 100;
+
+std::atomic<int> failedNums{0};
+
+void check(bool cond, const char* msg)
+{
+    if (!cond)
+    {
+        std::cout << "FAILED: " << msg << std::endl;
+        failedNums++;
+    }
+}
+
+struct Counted
+{
+    static std::atomic<int> constructNums;
+    static std::atomic<int> destructNums;
+
+    Counted(int v) : value(v) { constructNums++; }
+    ~Counted() { destructNums++; }
+
+    int value;
+    char payload[20];
+};
+std::atomic<int> Counted::constructNums{0};
+std::atomic<int> Counted::destructNums{0};
+
+struct alignas(64) CacheLine
+{
+    uint64_t data[3];
+};
+
+// 构造代价较高的对象 例如持有自己的缓冲区
+struct Connection
+{
+    static std::atomic<int> constructNums;
+    static std::atomic<int> destructNums;
+
+    Connection() : buffer(4096) { constructNums++; }
+    ~Connection() { destructNums++; }
+
+    void poolReset() { used = 0; }
+
+    std::vector<char> buffer;
+    size_t used = 0;
+};
+std::atomic<int> Connection::constructNums{0};
+std::atomic<int> Connection::destructNums{0};
+
+void testCounted()
+{
+    {
+        ObjectPool<Counted> pool;
+        std::vector<Counted*> objs;
+        for (int i = 0; i < 1000; ++i)
+            objs.push_back(pool.newElement(i));
+        for (int i = 0; i < 1000; ++i)
+            check(objs[i]->value == i, "object value");
+        for (Counted* obj : objs)
+            pool.deleteElement(obj);
+    }
+    check(Counted::constructNums == 1000, "construct count");
+    check(Counted::destructNums == 1000, "destruct count");
+}
+
+void testAlignment()
+{
+    static_assert(ObjectPool<CacheLine>::SLOT_ALIGN == 64, "slot align");
+    static_assert(ObjectPool<CacheLine>::SLOT_SIZE == 64, "slot size");
+
+    ObjectPool<CacheLine> pool;
+    std::vector<CacheLine*> objs;
+    for (int i = 0; i < 10000; ++i)
+    {
+        CacheLine* obj = pool.newElement();
+        check(reinterpret_cast<uintptr_t>(obj) % alignof(CacheLine) == 0, "over-aligned object");
+        objs.push_back(obj);
+    }
+    for (CacheLine* obj : objs)
+        pool.deleteElement(obj);
+}
+
+void testKeepConstructed()
+{
+    static_assert(HasPoolReset<Connection>::value, "poolReset detected");
+    static_assert(!HasPoolReset<Counted>::value, "no poolReset");
+    {
+        ObjectPool<Connection> pool;
+        for (int round = 0; round < 100; ++round)
+        {
+            Connection* objs[10];
+            for (auto& obj : objs)
+            {
+                obj = pool.newElement();
+                check(obj->buffer.size() == 4096 && obj->used == 0, "reused object state");
+                obj->used = 100;
+            }
+            for (auto& obj : objs)
+                pool.deleteElement(obj);
+        }
+        check(Connection::constructNums == 10, "reused objects are not constructed again");
+        check(Connection::destructNums == 0, "recycled objects are not destructed");
+    }
+    check(Connection::destructNums == 10, "objects destructed with the pool");
+}
+
+template<class Alloc, class Free>
+double measure(Alloc&& alloc, Free&& dealloc)
+{
+    auto start = Clock::now();
+    Connection* objs[batchNums];
+    for (int i = 0; i < loopNums / batchNums; ++i)
+    {
+        for (auto& obj : objs)
+            obj = alloc();
+        for (auto& obj : objs)
+            dealloc(obj);
+    }
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void benchmark()
+{
+    ObjectPool<Connection, false> rawPool;
+    ObjectPool<Connection> keepPool;
+
+    double bucketMs = measure([] { return HashBucket::newElement<Connection>(); },
+                              [](Connection* obj) { HashBucket::deleteElement(obj); });
+    double rawMs = measure([&] { return rawPool.newElement(); },
+                           [&](Connection* obj) { rawPool.deleteElement(obj); });
+    double keepMs = measure([&] { return keepPool.newElement(); },
+                            [&](Connection* obj) { keepPool.deleteElement(obj); });
+
+    std::cout << loopNums << " objects with 4KB buffer" << std::endl;
+    std::cout << "HashBucket newElement: " << bucketMs << " ms" << std::endl;
+    std::cout << "ObjectPool: " << rawMs << " ms" << std::endl;
+    std::cout << "ObjectPool keep constructed: " << keepMs << " ms" << std::endl;
+}
+
+int main()
+{
+    testCounted();
+    testAlignment();
+    testKeepConstructed();
+
+    // 多线程共用同一个对象池
+    {
+        ObjectPool<Counted> pool;
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t)
+            threads.emplace_back([&pool, t] {
+                std::vector<Counted*> objs;
+                for (int i = 0; i < 100000; ++i)
+                {
+                    objs.push_back(pool.newElement(t));
+                    if (objs.size() == 64)
+                    {
+                        for (Counted* obj : objs)
+                            check(obj->value == t, "object owned by another thread");
+                        for (Counted* obj : objs)
+                            pool.deleteElement(obj);
+                        objs.clear();
+                    }
+                }
+                for (Counted* obj : objs)
+                    pool.deleteElement(obj);
+            });
+        for (auto& th : threads)
+            th.join();
+    }
+
+    benchmark();
+
+    if (failedNums != 0)
+    {
+        std::cout << "ObjectPool test failed" << std::endl;
+        return 1;
+    }
+    std::cout << "ObjectPool test passed" << std::endl;
+    return 0;
+}
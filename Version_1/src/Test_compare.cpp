@@ -11,6 +11,7 @@
 // #include <assert.h>
 // #include <mutex>
 // #include <numeric>
+#include <atomic>
 // #include <algorithm>
 // #include <vector>
 
@@ -177,11 +178,13 @@
 
 #include "MemoryPool_CAS.h"
 #include "MemoryPool_mutex.h"
+#include "BasicPool.h"
 #include <iostream>
 #include <chrono>
 #include <thread>
 #include <vector>
 #include <numeric>
+#include <atomic>
 #include <cassert>
 
 constexpr size_t blockSizes[] = {8, 16, 32, 64, 128, 256, 512};
@@ -211,6 +214,19 @@ void work_cas(int loopNums)
         memory_pool_CAS::HashBucket::deallocate(block.first, block.second);
 }
 
+// CAS内存池 不经过线程缓存的弹匣 每次申请释放都直接在哈希桶的内存池上CAS
+void work_cas_no_magazine(int loopNums)
+{
+    std::vector<std::pair<void*, size_t>> ptrVec;
+    ptrVec.reserve(loopNums * std::size(blockSizes));
+    for (int i = 0; i < loopNums; ++i)
+        for (size_t size : blockSizes)
+            ptrVec.emplace_back(memory_pool_CAS::HashBucket::getMemoryPool((size - 1) / SLOT_BASE_SIZE).allocate(), size);
+
+    for (auto& block : ptrVec)
+        memory_pool_CAS::HashBucket::getMemoryPool((block.second - 1) / SLOT_BASE_SIZE).deallocate(block.first);
+}
+
 // ==================== 预热函数 ====================
 void warmup()
 {
@@ -233,6 +249,38 @@ void warmup()
 }
 
 // ==================== 性能测试函数 ====================
+// 同步策略对比 共享的实例在编译期完成初始化
+memory_pool_basic::BasicHashBucket<memory_pool_basic::MutexPolicy> g_mutexBuckets;
+memory_pool_basic::BasicHashBucket<memory_pool_basic::SpinLockPolicy> g_spinBuckets;
+memory_pool_basic::BasicHashBucket<memory_pool_basic::LockFreePolicy> g_lockFreeBuckets;
+// 单线程策略不能在线程之间共享 每个线程使用自己的实例 实例在多轮测试之间保留 和共享实例一样是预热过的
+constexpr int arenaNums = 4;
+std::atomic<unsigned> g_nextArena{0};
+memory_pool_basic::BasicHashBucket<memory_pool_basic::SingleThreadPolicy> g_singleThreadBuckets[arenaNums];
+
+template<class Buckets>
+void work_buckets(Buckets& buckets, int loopNums)
+{
+    std::vector<std::pair<void*, size_t>> ptrVec;
+    ptrVec.reserve(loopNums * std::size(blockSizes));
+    for (int i = 0; i < loopNums; ++i)
+        for (size_t size : blockSizes)
+            ptrVec.emplace_back(buckets.allocate(size), size);
+
+    for (auto& block : ptrVec)
+        buckets.deallocate(block.first, block.second);
+}
+
+void work_single_thread_policy(int loopNums)
+{
+    // 同时运行的线程不超过arenaNums个 连续的编号取模之后互不相同
+    thread_local unsigned arenaIdx = g_nextArena++ % arenaNums;
+    work_buckets(g_singleThreadBuckets[arenaIdx], loopNums);
+}
+void work_mutex_policy(int loopNums) { work_buckets(g_mutexBuckets, loopNums); }
+void work_spin_policy(int loopNums) { work_buckets(g_spinBuckets, loopNums); }
+void work_lock_free_policy(int loopNums) { work_buckets(g_lockFreeBuckets, loopNums); }
+
 template<typename Func>
 double test_function(Func f, int loopNums, int threadNums = 1)
 {
@@ -260,14 +308,12 @@ double test_function(Func f, int loopNums, int threadNums = 1)
 // ==================== 主函数 ====================
 int main()
 {
-    memory_pool::HashBucket::initMemoryPool();
-    memory_pool_CAS::HashBucket::initMemoryPool();
-
     warmup();
 
     const int loopNums = 100000;
     const int repeatTimes = 10;
     const int threadNums = 4;
+    static_assert(threadNums <= arenaNums, "each thread needs its own single-thread arena");
 
     std::vector<double> singleThreadRatios;
     std::vector<double> multiThreadRatios;
@@ -300,7 +346,54 @@ int main()
     }
 
     double avgMulti = std::accumulate(multiThreadRatios.begin(), multiThreadRatios.end(), 0.0) / repeatTimes;
-    std::cout << "Average Time speedup (Multi Thread): " << avgMulti << " %\n";
+    std::cout << "Average Time speedup (Multi Thread): " << avgMulti << " %\n\n";
+
+    // 弹匣开启和关闭时CAS内存池的吞吐量 关闭时所有线程竞争同一个空闲链表头 开启时只有整个弹匣交换时才访问内存池
+    std::cout << "========= CAS 弹匣开启/关闭 吞吐量 =========\n";
+    for (int threads : {1, 2, 4, 8})
+    {
+        test_function(work_cas_no_magazine, 1000, threads);
+        double onTime = 0;
+        double offTime = 0;
+        for (int i = 0; i < repeatTimes; ++i)
+        {
+            onTime += test_function(work_cas, loopNums, threads);
+            offTime += test_function(work_cas_no_magazine, loopNums, threads);
+        }
+
+        // 每轮每个线程申请和释放各loopNums * size(blockSizes)次
+        double ops = 2.0 * loopNums * std::size(blockSizes) * threads * repeatTimes;
+        std::cout << threads << " threads: magazine on = " << ops / onTime / 1000 << " Mops/s, off = "
+                  << ops / offTime / 1000 << " Mops/s\n";
+    }
+    std::cout << "\n";
+
+    // BasicPool的四种同步策略 多线程时单线程策略的每个线程使用自己的实例
+    struct PolicyCase
+    {
+        const char* name;
+        void (*work)(int);
+    };
+    const PolicyCase policyCases[] = {
+        {"SingleThread", work_single_thread_policy},
+        {"Mutex", work_mutex_policy},
+        {"SpinLock", work_spin_policy},
+        {"LockFree", work_lock_free_policy},
+    };
+
+    for (int threads : {1, threadNums})
+    {
+        std::cout << "========= BasicPool 同步策略对比 (" << threads << " 线程) =========\n";
+        for (const PolicyCase& policy : policyCases)
+        {
+            test_function(policy.work, 1000, threads);
+            double total = 0;
+            for (int i = 0; i < repeatTimes; ++i)
+                total += test_function(policy.work, loopNums, threads);
+            std::cout << policy.name << ": " << total / repeatTimes << " ms\n";
+        }
+        std::cout << "\n";
+    }
 
     return 0;
 }
@@ -220,7 +220,10 @@ double computeAverage(const std::vector<double>& v) {
 }
 
 int main() {
-    HashBucket::initMemoryPool();
+    // 每轮都申请释放到同一峰值 缓存足够的空块 避免每轮都释放给系统再缺页
+    BlockGrowthPolicy policy;
+    policy.maxEmptyBlocks = 256;
+    HashBucket::initMemoryPool(policy);
 
     // 🔁 预热内存池
     useMemoryPoolTask();
@@ -263,5 +266,17 @@ int main() {
     }
 
     std::cout << "Average speedup (multi-thread): " << computeAverage(speedupMulti) << "%\n";
+
+    // 默认策略: 峰值过后只缓存少量空块 其余释放给系统
+    MemoryPool pool(64);
+    std::vector<void*> slots;
+    for (int i = 0; i < 200000; ++i)
+        slots.push_back(pool.allocate());
+    size_t peakBlocks = pool.getBlockNums();
+    for (void* p : slots)
+        pool.deallocate(p);
+    std::cout << "\nBlocks after peak: " << peakBlocks << " -> " << pool.getBlockNums() << std::endl;
+    if (pool.getBlockNums() > BlockGrowthPolicy().maxEmptyBlocks)
+        return 1;
     return 0;
 }
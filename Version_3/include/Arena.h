@@ -0,0 +1,142 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "Common.h"
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <memory_resource>
+
+namespace memory_pool
+{
+
+/**
+ * 区域分配器 从页面缓存申请的内存页中顺序切分内存 不支持单独释放
+ * 适合一次请求中申请大量小对象 请求结束时整体释放的场景:
+ * reset()把切分位置退回第一个内存页 内存页保留给下一次使用
+ * release()把所有内存页归还给页面缓存
+ * 通过create创建的非平凡析构对象会记录在析构链表中 reset/release时按照创建的相反顺序析构
+ * 同一个Arena只能在一个线程中使用
+ * 继承std::pmr::memory_resource 可以作为pmr容器的内存资源 容器释放内存时不做任何操作
+ */
+class Arena : public std::pmr::memory_resource
+{
+public:
+    // 默认每次向页面缓存申请的内存页数量
+    static constexpr size_t DEFAULT_SPAN_PAGE = 16;
+
+    /// @brief 构造函数 不会立即申请内存页
+    /// @param spanPageNums 每次向页面缓存申请的内存页数量 超过该大小的申请单独使用足够大的内存页
+    explicit Arena(size_t spanPageNums = DEFAULT_SPAN_PAGE);
+
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    /// @brief 申请内存 只移动切分位置
+    /// @param size 内存大小
+    /// @param align 对齐大小 需要是2的幂
+    /// @return void* 不需要释放 reset/release时统一回收
+    void* allocate(size_t size, size_t align = alignof(std::max_align_t))
+    {
+        assert(align > 0 && (align & (align - 1)) == 0);
+        size_t addr = (reinterpret_cast<size_t>(this->m_cursor) + align - 1) & ~(align - 1);
+        if (this->m_cursor && addr + size <= reinterpret_cast<size_t>(this->m_limit))
+        {
+            this->m_cursor = reinterpret_cast<char*>(addr + size);
+            return reinterpret_cast<void*>(addr);
+        }
+        return this->allocateSlow(size, align);
+    }
+
+    /// @brief 在区域中创建对象 非平凡析构的对象在reset/release时析构
+    template<class T, class... Args>
+    T* create(Args&&... args)
+    {
+        if constexpr (std::is_trivially_destructible_v<T>)
+        {
+            return new (this->allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        }
+        else
+        {
+            // 先申请析构链表节点 构造之后不会再因为申请失败导致对象无法析构
+            DestructorNode* node = static_cast<DestructorNode*>(this->allocate(sizeof(DestructorNode), alignof(DestructorNode)));
+            T* obj = new (this->allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+            node->object = obj;
+            node->destroy = [](void* ptr) { static_cast<T*>(ptr)->~T(); };
+            node->next = this->m_destructors;
+            this->m_destructors = node;
+            return obj;
+        }
+    }
+
+    /// @brief 析构记录的对象 切分位置退回第一个内存页 内存页全部保留
+    void reset();
+
+    /// @brief 析构记录的对象 所有内存页归还给页面缓存
+    void release();
+
+    /// @brief 已经切分出去的字节数 包括对齐和内存页尾部无法使用的部分
+    size_t getUsedBytes() const;
+
+    /// @brief 持有的内存页总字节数
+    size_t getReservedBytes() const { return this->m_reservedBytes; }
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        return this->allocate(bytes, alignment);
+    }
+
+    // 区域分配器不单独释放
+    void do_deallocate(void*, size_t, size_t) override {}
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+
+private:
+    /// @brief 内存页头部 位于每段内存页的起始位置
+    struct Span
+    {
+        Span* next;
+        size_t pageNums;
+    };
+
+    struct DestructorNode
+    {
+        DestructorNode* next;
+        void (*destroy)(void*);
+        void* object;
+    };
+
+    /// @brief 当前内存页放不下时 使用下一段已有的内存页或者申请新的内存页
+    void* allocateSlow(size_t size, size_t align);
+
+    /// @brief 把切分位置设置到内存页的起始位置
+    void useSpan(Span* span);
+
+    /// @brief 申请新的内存页 超大内存直接映射
+    Span* allocateSpan(size_t pageNums);
+
+    void deallocateSpan(Span* span);
+
+    /// @brief 按照创建的相反顺序析构记录的对象
+    void runDestructors();
+
+private:
+    size_t m_spanPageNums;
+    Span* m_firstSpan;      // 所有内存页组成的链表 reset后从头开始使用
+    Span* m_curSpan;        // 当前切分的内存页
+    char* m_cursor;         // 当前内存页中下一个可用的位置
+    char* m_limit;          // 当前内存页的结束位置
+    size_t m_usedBytes;     // 当前内存页之前的内存页已经使用的字节数
+    size_t m_reservedBytes;
+    DestructorNode* m_destructors;
+};
+
+}
+
+#endif // ARENA_H
@@ -2,22 +2,35 @@
 #define CENTRAL_CACHE_H
 
 #include "Common.h"
+#include "PoolStats.h"
+#include "PageCache.h"
+#include <pthread.h>
+#include <stdint.h>
 
 namespace memory_pool
 {
+class ThreadCache;
+class Heap;
+
 class CentralCache
 {
 public:
     static CentralCache* Instance()
     {
-        static CentralCache instance;
+        static CentralCache instance(PageCache::Instance());
         return &instance;
     }
 
+    ~CentralCache();
+
+    CentralCache(const CentralCache&) = delete;
+    CentralCache& operator=(const CentralCache&) = delete;
+
     /// @brief 从中心缓存向线程缓存分配内存块链表
     /// @param index 内存块大小对应的索引位置
+    /// @param isRefill 是否是线程缓存未命中时的批量申请 预热时为false 不计入批量申请次数
     /// @return pair<void*, size_t> 返回首地址以及内存块链表的大小
-    std::pair<void*, size_t> fetchRange(size_t index);
+    std::pair<void*, size_t> fetchRange(size_t index, bool isRefill = true);
 
 
     /// @brief 线程缓存归还内存给中心缓存
@@ -26,33 +39,105 @@ public:
     /// @param index 内存块对应的索引
     void returnRange(void* ptr, size_t blockNums, size_t index);
 
+    /// @brief 线程缓存创建时登记 用于统计时汇总各线程的计数
+    /// @param threadCache 线程缓存
+    void registerThreadCache(ThreadCache* threadCache);
+
+    /// @brief 线程退出时注销 线程的计数累加到中心缓存中
+    /// @param threadCache 线程缓存
+    void unregisterThreadCache(ThreadCache* threadCache);
+
+    /// @brief 汇总所有线程缓存以及中心缓存的计数
+    /// @return vector<SizeClassStats> 有过申请或者缓存有内存块的内存块大小的统计信息
+    std::vector<SizeClassStats> getSizeClassStats();
+
+    /// @brief 线程缓存的计数组使用的内存页 优先复用已经退出的线程留下的内存页
+    /// @return void* 一个内存页 内容不一定是0
+    void* allocateCounterPage();
+
+    /// @brief 中心缓存申请内存页使用的页面缓存
+    PageCache* getPageCache() const { return this->m_pageCache; }
 
-    void printListSize();
 private:
+    // 独立的堆持有自己的中心缓存 通过getThreadCache/reset管理其中的线程缓存
+    friend class Heap;
 
-    CentralCache()
-    {
-        for(auto& ptr : this->m_freeList)
-        {
-            ptr.store(nullptr, std::memory_order_relaxed);
-        }
+    /// @brief 构造函数
+    /// @param pageCache 申请内存页使用的页面缓存
+    /// @param ownsThreadCaches 线程缓存是否由中心缓存创建 独立的堆为true 线程退出时线程缓存归还到中心缓存并释放
+    explicit CentralCache(PageCache* pageCache, bool ownsThreadCaches = false);
 
-        for(auto& size : this->m_freeListSize)
+    /// @brief 线程在各个中心缓存上的线程缓存 所有中心缓存共用一个pthread_key 存活的堆的数量不受TSD数量(PTHREAD_KEYS_MAX)限制
+    /// 直接mmap 不经过malloc 线程通常只使用少数几个堆 按顺序查找
+    struct ThreadCacheTable
+    {
+        struct Slot
         {
-            size.store(0, std::memory_order_relaxed);
-        }
-
-        for(auto& lock : this->m_freeListLock)
+            uint64_t centralId;         // 中心缓存的编号 不会重复使用 堆析构之后留下的表项不会被误认
+            ThreadCache* threadCache;
+        };
+
+        size_t bytes;
+        size_t size;
+        size_t capacity;
+        Slot slots[1];
+    };
+
+    /// @brief 所有中心缓存共用的pthread_key 第一次调用时创建 创建失败时抛出std::system_error
+    static pthread_key_t sharedThreadCacheKey();
+
+    /// @brief 线程退出时pthread_key的析构回调 归还线程在每个仍然存活的中心缓存上的线程缓存
+    /// @param table 线程缓存表
+    static void onThreadExit(void* table);
+
+    /// @brief 在存活的中心缓存中查找编号对应的中心缓存 需要持有s_centralLock
+    /// @param id 中心缓存的编号
+    /// @return CentralCache* 已经析构时返回nullptr
+    static CentralCache* findCentral(uint64_t id);
+
+    /// @brief 线程退出时注销线程缓存 中心缓存创建的线程缓存同时归还空闲内存块并释放
+    /// @param threadCache 线程缓存
+    void releaseThreadCache(ThreadCache* threadCache);
+
+    /// @brief 在当前线程的线程缓存表中登记线程缓存 表满时先丢弃已经析构的中心缓存留下的表项 仍然不够再扩容
+    /// @param threadCache 线程缓存
+    void bindThreadCache(ThreadCache* threadCache);
+
+    /// @brief 获取当前线程在该中心缓存上的线程缓存 没有时创建 只用于ownsThreadCaches的中心缓存
+    /// @return ThreadCache*
+    ThreadCache* getThreadCache()
+    {
+        ThreadCacheTable* table = static_cast<ThreadCacheTable*>(pthread_getspecific(this->m_threadCacheKey));
+        if (__builtin_expect(table != nullptr, 1))
         {
-            lock.clear();
+            for (size_t i = 0; i < table->size; ++i)
+            {
+                if (table->slots[i].centralId == this->m_id)
+                    return table->slots[i].threadCache;
+            }
         }
+        return this->createThreadCache();
     }
 
+    /// @brief 直接mmap创建当前线程的线程缓存 不在页面缓存中 页面缓存整体释放之后仍然有效
+    /// 线程退出或者中心缓存析构时munmap
+    ThreadCache* createThreadCache();
+
+    /// @brief 丢弃所有空闲内存块 计数清零 调用时不能有其他线程在使用该中心缓存
+    /// 只清理使用过的内存块大小 线程缓存保留 其中的链表和计数组同样清空 内存块和计数组之后由页面缓存整体释放
+    void reset();
+
+    /// @brief 清空数组链表以及统计计数
+    void clearFreeLists();
+
+    /// @brief 清空一个内存块大小的链表以及统计计数
+    /// @param index 内存块大小对应的索引位置
+    void clearSizeClass(size_t index);
 
     /// @brief 中心缓存向页面缓存申请内存
-    /// @param size 申请的内存大小 内部会将size转为内存页数量
+    /// @param index 内存块大小对应的索引位置 按照编译期计算的表确定内存页数量
     /// @return pair<void*, size_t> 分配的首地址以及对应的内存页数量 
-    std::pair<void*, size_t> fetchFromPageCache(size_t size);
+    std::pair<void*, size_t> fetchFromPageCache(size_t index);
 
 
     /// @brief 根据索引获取对应的内存块批次大小
@@ -71,6 +156,44 @@ private:
     // 与上面的数组链表大小一致的自旋锁数组 分别对应每个链表
     std::array<std::atomic_flag, FREE_LIST_SIZE> m_freeListLock;
 
+    // 每个内存块大小的统计计数
+    struct ClassCounter
+    {
+        std::atomic<size_t> fetchNums;      // 线程缓存批量申请次数
+        std::atomic<size_t> fetchBlocks;    // 批量申请的内存块总数
+        std::atomic<size_t> returnNums;     // 线程缓存归还次数
+        std::atomic<size_t> returnBlocks;   // 归还的内存块总数
+        std::atomic<size_t> exitAllocNums;  // 已经退出的线程的申请次数
+        std::atomic<size_t> exitFreeNums;   // 已经退出的线程的释放次数
+        std::atomic<size_t> spanNums;       // 向页面缓存申请内存页的次数
+        std::atomic<size_t> spanWasteBytes; // 申请的内存页尾部无法使用的字节数
+    };
+    std::array<ClassCounter, FREE_LIST_SIZE> m_classCounter;
+
+    // 向页面缓存申请过内存页的内存块大小 按位记录 reset时只清理这些内存块大小
+    std::array<std::atomic<uint64_t>, FREE_LIST_SIZE / 64> m_usedClasses;
+
+    // 所有存活的线程缓存组成的双向链表 以及对应的自旋锁
+    ThreadCache* m_threadCacheHead;
+    std::atomic_flag m_threadCacheLock;
+
+    // 已经退出的线程留下的计数组内存页 通过首部指针连接 由m_threadCacheLock保护
+    void* m_freeCounterPages;
+
+    // 所有中心缓存共用的pthread_key 值是当前线程的线程缓存表
+    pthread_key_t m_threadCacheKey;
+
+    // 中心缓存的编号 以及存活的中心缓存组成的双向链表 线程退出时只处理仍然存活的中心缓存
+    uint64_t m_id;
+    CentralCache* m_prevCentral;
+    CentralCache* m_nextCentral;
+    static std::atomic<uint64_t> s_nextId;
+    static CentralCache* s_centralHead;
+    static std::atomic_flag s_centralLock;
+
+    PageCache* m_pageCache;
+    const bool m_ownsThreadCaches;
+
 
 };
 
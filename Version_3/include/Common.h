@@ -15,6 +15,7 @@
 #include <array>
 #include <assert.h>
 #include <atomic>
+#include <algorithm>
 
 namespace memory_pool
 {
@@ -25,12 +26,18 @@ constexpr size_t ALIGNMENT = 8;
 // 最大的内存块
 constexpr size_t MAX_BYTES = 256 * 1024;
 
+// 超过该大小的内存直接通过mmap映射 不经过页面缓存 扩容时使用mremap
+constexpr size_t HUGE_BYTES = 1024 * 1024;
+
 // 自由链表数组大小
 constexpr size_t FREE_LIST_SIZE = MAX_BYTES / ALIGNMENT;
 
-// 每次分配的内存页面数量
+// 中心缓存每次向页面缓存申请的最少内存页数量 默认值 运行时可以通过Config调整
 constexpr size_t SPAN_PAGE = 4;
 
+// 中心缓存每次申请的内存页数量上限 一个内存块需要更多内存页时按照内存块大小申请
+constexpr size_t MAX_SPAN_PAGE = 64;
+
 // 内存页大小
 constexpr size_t PAGE_SIZE = 4 * 1024;
 
@@ -38,16 +45,45 @@ constexpr size_t PAGE_SIZE = 4 * 1024;
 class SizeClass
 {
 public:
-    static size_t getIndex(size_t size)
+    static constexpr size_t getIndex(size_t size)
     {
         return (size - 1) / ALIGNMENT;
     }
 
-    static size_t getBlockSize(size_t index)
+    static constexpr size_t getBlockSize(size_t index)
     {
         return (index + 1) * ALIGNMENT;
     }
 
+    /// @brief 计算中心缓存为该内存块大小每次向页面缓存申请的内存页数量
+    /// 从minSpanPages以及容纳一个内存块所需的内存页数量开始 选择尾部浪费不超过1/8的最少内存页数量
+    /// 到MAX_SPAN_PAGE都达不到时 选择浪费比例最小的内存页数量
+    /// @param blockSize 内存块大小
+    /// @param minSpanPages 最少内存页数量
+    /// @return size_t 内存页数量
+    static constexpr size_t computeSpanPages(size_t blockSize, size_t minSpanPages = SPAN_PAGE)
+    {
+        size_t minPages = std::max(minSpanPages, (blockSize + PAGE_SIZE - 1) / PAGE_SIZE);
+        size_t maxPages = std::max(MAX_SPAN_PAGE, minPages);
+
+        size_t bestPages = minPages;
+        size_t bestWaste = minPages * PAGE_SIZE % blockSize;
+        for (size_t pages = minPages; pages <= maxPages; ++pages)
+        {
+            size_t spanBytes = pages * PAGE_SIZE;
+            size_t waste = spanBytes % blockSize;
+            if (waste * 8 <= spanBytes)
+                return pages;
+            // 比较浪费比例 waste / spanBytes < bestWaste / (bestPages * PAGE_SIZE)
+            if (waste * bestPages < bestWaste * pages)
+            {
+                bestPages = pages;
+                bestWaste = waste;
+            }
+        }
+        return bestPages;
+    }
+
 };
 
 }
@@ -0,0 +1,72 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include "Common.h"
+#include <new>
+
+namespace memory_pool
+{
+
+/**
+ * 运行时可调的参数
+ * 第一次使用时从环境变量读取一次 之后可以通过set接口调整 不需要重新编译
+ * 申请释放路径只做一次relaxed的原子读取 调整后对之后的申请释放生效
+ *   MEMPOOL_TC_MAX_BLOCKS   线程缓存单个链表超过多少个内存块时归还给中心缓存 默认64
+ *   MEMPOOL_TC_MAX_BYTES    每个线程缓存所有链表中空闲内存块的总字节数上限 超过时依次归还各个链表 默认0不限制 可以带K/M/G后缀
+ *   MEMPOOL_BATCH_BLOCKS    最小的内存块每次从中心缓存批量获取的数量 更大的内存块依次减半 默认64
+ *   MEMPOOL_SPAN_PAGES      中心缓存每次向页面缓存申请的最少内存页数量 默认SPAN_PAGE
+ *   MEMPOOL_RELEASE_RATE    线程缓存链表超过上限时归还给中心缓存的百分比 默认75
+ */
+class Config
+{
+public:
+    static Config* Instance()
+    {
+        // 作为malloc替换库时进程退出阶段仍然会读取 不析构
+        alignas(Config) static char storage[sizeof(Config)];
+        static Config *instance = new (storage) Config;
+        return instance;
+    }
+
+    static constexpr size_t DEFAULT_TC_MAX_BLOCKS = 64;
+    static constexpr size_t DEFAULT_BATCH_BLOCKS = 64;
+    static constexpr size_t DEFAULT_RELEASE_RATE = 75;
+
+    size_t getThreadCacheMaxBlocks() const { return this->m_threadCacheMaxBlocks.load(std::memory_order_relaxed); }
+    size_t getThreadCacheMaxBytes() const { return this->m_threadCacheMaxBytes.load(std::memory_order_relaxed); }
+    size_t getBatchBlocks() const { return this->m_batchBlocks.load(std::memory_order_relaxed); }
+    size_t getSpanPages() const { return this->m_spanPages.load(std::memory_order_relaxed); }
+    size_t getReleaseRate() const { return this->m_releaseRate.load(std::memory_order_relaxed); }
+
+    /// @brief 线程缓存单个链表的内存块数量上限 至少为1
+    void setThreadCacheMaxBlocks(size_t blockNums);
+
+    /// @brief 每个线程缓存中空闲内存块的总字节数上限 0表示不限制
+    void setThreadCacheMaxBytes(size_t bytes);
+
+    /// @brief 最小的内存块每次批量获取的数量 至少为1
+    void setBatchBlocks(size_t blockNums);
+
+    /// @brief 中心缓存每次申请的最少内存页数量 限制在[1, MAX_SPAN_PAGE]
+    void setSpanPages(size_t pageNums);
+
+    /// @brief 超过上限时归还的百分比 限制在[1, 100]
+    void setReleaseRate(size_t percent);
+
+    /// @brief 恢复默认值 不重新读取环境变量
+    void reset();
+
+private:
+    Config();
+
+private:
+    std::atomic<size_t> m_threadCacheMaxBlocks;
+    std::atomic<size_t> m_threadCacheMaxBytes;
+    std::atomic<size_t> m_batchBlocks;
+    std::atomic<size_t> m_spanPages;
+    std::atomic<size_t> m_releaseRate;
+};
+
+}
+
+#endif // CONFIG_H
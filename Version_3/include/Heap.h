@@ -0,0 +1,80 @@
+#ifndef HEAP_H
+#define HEAP_H
+
+#include "Common.h"
+#include "PageCache.h"
+#include "CentralCache.h"
+#include "ThreadCache.h"
+#include "PoolStats.h"
+
+namespace memory_pool
+{
+
+/**
+ * 独立的堆 持有自己的页面缓存、中心缓存以及每个线程的线程缓存 与默认的MemoryPool以及其他堆互不影响
+ * 适合把碎片化严重的子系统与延迟敏感的路径隔离开 或者一次性释放一个会话申请的所有内存
+ * 从一个堆申请的内存只能释放回同一个堆
+ * 线程第一次使用某个堆时为其mmap一个线程缓存 线程退出时空闲内存块归还给该堆的中心缓存
+ * destroy()把堆中的所有内存页(包括直接映射的超大内存)整体归还给系统 不需要逐个释放
+ *
+ * 内存开销: 堆对象本身只有页面缓存和一个指针 可以放在栈上
+ * 构造时另外申请约2.6MB的中心缓存(每个内存块大小的链表、锁和计数) 析构时释放
+ * 每个使用过该堆的线程还有一个约656KB的线程缓存 线程退出或者堆析构时释放 destroy()保留线程缓存
+ * 所有堆共用一个pthread_key 存活的堆的数量不受PTHREAD_KEYS_MAX限制 进程中第一次创建key失败时构造函数抛出std::system_error
+ */
+class Heap
+{
+public:
+    Heap();
+
+    // 析构时整体释放所有内存 包括中心缓存和各线程的线程缓存
+    ~Heap();
+
+    Heap(const Heap&) = delete;
+    Heap& operator=(const Heap&) = delete;
+
+    void* allocate(size_t size)
+    {
+        return this->m_centralCache->getThreadCache()->allocate(size);
+    }
+
+    void deallocate(void* ptr, size_t size)
+    {
+        this->m_centralCache->getThreadCache()->deallocate(ptr, size);
+    }
+
+    void* reallocate(void* ptr, size_t oldSize, size_t newSize)
+    {
+        return this->m_centralCache->getThreadCache()->reallocate(ptr, oldSize, newSize);
+    }
+
+    void* allocateAligned(size_t size, size_t align)
+    {
+        return this->m_centralCache->getThreadCache()->allocateAligned(size, align);
+    }
+
+    void deallocateAligned(void* ptr, size_t size, size_t align)
+    {
+        this->m_centralCache->getThreadCache()->deallocateAligned(ptr, size, align);
+    }
+
+    /// @brief 将堆中的所有内存页归还给系统 之前申请的内存全部失效 之后堆仍然可以继续使用
+    /// 只清空使用过的内存块大小 线程缓存保留 耗时与会话使用的内存页数量相关 与对象数量无关
+    /// 调用时不能有其他线程正在使用该堆
+    void destroy();
+
+    /// @brief 获取该堆的统计信息快照
+    /// @return PoolStats
+    PoolStats getStats();
+
+private:
+    // 页面缓存需要先于中心缓存构造
+    PageCache m_pageCache;
+
+    // 中心缓存有几MB 单独申请 堆对象可以放在栈上
+    CentralCache* m_centralCache;
+};
+
+}
+
+#endif // HEAP_H
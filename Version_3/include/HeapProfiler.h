@@ -0,0 +1,138 @@
+#ifndef HEAP_PROFILER_H
+#define HEAP_PROFILER_H
+
+#include "Common.h"
+#include <cstdint>
+#include <new>
+#include <string>
+#include <ostream>
+
+namespace memory_pool
+{
+
+/**
+ * 采样堆分析器
+ * 每个线程缓存维护一个距离下一次采样还剩多少字节的计数 计数服从几何分布(平均值为采样间隔)
+ * 申请时只需要做一次减法和一次判断 计数小于0时进入慢路径记录调用栈、大小、内存块大小以及时间戳
+ * 输出按照调用栈聚合的存活采样 格式与gperftools的heap profile相同 可以直接交给pprof分析
+ */
+class HeapProfiler
+{
+public:
+    static HeapProfiler* Instance()
+    {
+        // 释放路径会访问采样表 进程退出阶段其他静态对象析构时仍然可能释放内存 所以不析构
+        alignas(HeapProfiler) static char storage[sizeof(HeapProfiler)];
+        static HeapProfiler *instance = new (storage) HeapProfiler;
+        return instance;
+    }
+
+    // 记录的最大调用栈深度
+    static constexpr int MAX_STACK_DEPTH = 32;
+
+    /// @brief 一次采样的信息
+    struct Sample
+    {
+        void* ptr;
+        size_t size;            // 申请的大小
+        size_t blockSize;       // 实际分配的内存块大小 大内存为内存页大小的整数倍
+        uint64_t timestamp;     // 采样时间 steady_clock纳秒
+        int depth;
+        void* stack[MAX_STACK_DEPTH];
+    };
+
+    /// @brief 开始采样
+    /// @param sampleBytes 平均每申请多少字节采样一次
+    void start(size_t sampleBytes = 512 * 1024);
+
+    /// @brief 停止采样 已经记录的存活采样仍然保留 直到对应内存被释放
+    void stop();
+
+    bool isRunning() const { return this->m_sampleBytes.load(std::memory_order_relaxed) != 0; }
+
+    /// @brief 当前所有存活的采样
+    std::vector<Sample> getLiveSamples();
+
+    /// @brief 按照调用栈聚合存活采样 输出pprof可以解析的heap profile文本
+    /// @param os 输出流
+    void dump(std::ostream& os);
+
+    /// @brief 输出到文件
+    /// @param path 文件路径
+    /// @return bool 是否写入成功
+    bool dumpToFile(const std::string& path);
+
+    /// @brief 生成下一次采样前需要申请的字节数 停止采样时返回一个较大的复查间隔
+    /// @return ptrdiff_t
+    ptrdiff_t nextSampleBytes();
+
+    /// @brief 记录一次采样 由线程缓存在采样计数用完时调用
+    /// @param ptr 申请得到的地址
+    /// @param size 申请大小
+    /// @param blockSize 实际分配的内存块大小
+    void recordAllocation(void* ptr, size_t size, size_t blockSize);
+
+    /// @brief 释放内存时移除对应的采样
+    /// @param ptr 释放的地址
+    void recordDeallocation(void* ptr);
+
+    /// @brief 释放路径上的快速过滤 没有存活采样或者地址不可能被采样时返回false
+    /// 没有存活采样时只读取一个常量初始化的全局计数 不经过Instance()的初始化检查
+    /// @param ptr 释放的地址
+    /// @return bool
+    static bool mayBeSampled(void* ptr)
+    {
+        if (__builtin_expect(s_liveSampleNums.load(std::memory_order_relaxed) == 0, 1))
+            return false;
+        return Instance()->m_sampleFilter[filterIndex(ptr)].load(std::memory_order_relaxed) != 0;
+    }
+
+private:
+    HeapProfiler()
+    {
+        for (auto& count : this->m_sampleFilter)
+        {
+            count.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    static size_t filterIndex(void* ptr)
+    {
+        return (reinterpret_cast<size_t>(ptr) >> 3) * 0x9E3779B97F4A7C15ull >> (64 - FILTER_BITS);
+    }
+
+private:
+    // 采样停止时线程缓存每申请这么多字节检查一次是否开始了采样
+    static constexpr ptrdiff_t RECHECK_BYTES = 1024 * 1024;
+
+    static constexpr size_t FILTER_BITS = 14;
+
+    // 平均采样间隔 为0表示没有开始采样
+    std::atomic<size_t> m_sampleBytes{0};
+
+    // 最近一次开始采样时的采样间隔 停止之后输出时仍然需要
+    std::atomic<size_t> m_samplePeriod{0};
+
+    // 存活采样数量 为0时释放路径不需要查过滤表 常量初始化 读取时没有初始化检查
+    static inline std::atomic<size_t> s_liveSampleNums{0};
+
+    // 按照地址哈希的计数过滤表 释放的地址对应计数为0时一定没有被采样
+    std::array<std::atomic<uint32_t>, size_t(1) << FILTER_BITS> m_sampleFilter;
+
+    // 按照调用栈累计的采样 用于输出累计申请量
+    struct StackRecord
+    {
+        int depth;
+        void* stack[MAX_STACK_DEPTH];
+        size_t allocNums;
+        size_t allocBytes;
+    };
+
+    std::mutex m_sampleMutex;
+    std::unordered_map<void*, Sample> m_liveSamples;
+    std::unordered_map<uint64_t, StackRecord> m_stackRecords;
+};
+
+}
+
+#endif // HEAP_PROFILER_H
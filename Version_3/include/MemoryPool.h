@@ -3,6 +3,9 @@
 
 #include "Common.h"
 #include "ThreadCache.h"
+#include "PageCache.h"
+#include "PoolStats.h"
+#include "TraceRecorder.h"
 
 namespace memory_pool
 {
@@ -13,14 +16,72 @@ class MemoryPool
 public:
     static void* allocate(size_t size)
     {
-        return ThreadCache::Instance()->allocate(size);
+        void* ptr = ThreadCache::Instance()->allocate(size);
+        MEMORY_POOL_TRACE_RECORD(TRACE_ALLOCATE, ptr, size);
+        return ptr;
     }
 
+    // 释放的记录在释放之前 保证地址被重新申请时记录的先后顺序正确
     static void deallocate(void* ptr, size_t size)
     {
+        MEMORY_POOL_TRACE_RECORD(TRACE_DEALLOCATE, ptr, size);
         return ThreadCache::Instance()->deallocate(ptr, size);
     }
 
+    // 轨迹中记为一次释放加一次申请
+    static void* reallocate(void* ptr, size_t oldSize, size_t newSize)
+    {
+        MEMORY_POOL_TRACE_RECORD(TRACE_DEALLOCATE, ptr, oldSize);
+        void* newPtr = ThreadCache::Instance()->reallocate(ptr, oldSize, newSize);
+        MEMORY_POOL_TRACE_RECORD(TRACE_ALLOCATE, newPtr, newSize);
+        return newPtr;
+    }
+
+    static void* allocateAligned(size_t size, size_t align)
+    {
+        void* ptr = ThreadCache::Instance()->allocateAligned(size, align);
+        MEMORY_POOL_TRACE_RECORD(TRACE_ALLOCATE, ptr, size);
+        return ptr;
+    }
+
+    static void deallocateAligned(void* ptr, size_t size, size_t align)
+    {
+        MEMORY_POOL_TRACE_RECORD(TRACE_DEALLOCATE, ptr, size);
+        return ThreadCache::Instance()->deallocateAligned(ptr, size, align);
+    }
+
+    /// @brief 预先映射并完成缺页的内存页 之后小于HUGE_BYTES的申请从中分割 不再调用mmap
+    /// 超过HUGE_BYTES的超大内存总是直接映射 不使用预留的内存页
+    /// @param bytes 预留的字节数
+    /// @param lockMemory 是否通过mlock锁定在物理内存中 受RLIMIT_MEMLOCK限制
+    /// @return bool 是否成功 mlock失败时内存页仍然可以使用
+    static bool reserve(size_t bytes, bool lockMemory = false)
+    {
+        if (bytes == 0)
+            return true;
+        return PageCache::Instance()->reserveSpanPage((bytes + PAGE_SIZE - 1) / PAGE_SIZE, lockMemory);
+    }
+
+    /// @brief 开启后台线程保持预留的内存页 申请线程几乎不再需要同步mmap
+    /// 页面缓存空闲字节数低于lowBytes时后台线程补充到highBytes
+    /// @param lowBytes 低水位
+    /// @param highBytes 高水位 为0时停止后台线程
+    static void setReserveWatermark(size_t lowBytes, size_t highBytes)
+    {
+        PageCache::Instance()->setReserveWatermark(lowBytes, highBytes);
+    }
+
+    /// @brief 预热当前线程的线程缓存 例如prewarm({{64, 1000}, {256, 100}})
+    /// @param sizeCounts {申请大小, 内存块数量}
+    static void prewarm(std::initializer_list<std::pair<size_t, size_t>> sizeCounts)
+    {
+        ThreadCache::Instance()->prewarm(sizeCounts);
+    }
+
+    /// @brief 获取内存池统计信息快照 汇总所有线程缓存、中心缓存以及页面缓存的计数
+    /// @return PoolStats
+    static PoolStats getStats();
+
 };
 
 
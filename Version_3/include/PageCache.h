@@ -2,6 +2,8 @@
 #define PAGE_CACHE_H
 
 #include "Common.h"
+#include "PoolStats.h"
+#include <condition_variable>
 
 namespace memory_pool
 {
@@ -12,34 +14,133 @@ namespace memory_pool
     public:
         static PageCache *Instance()
         {
+#ifdef MEMORY_POOL_IMMORTAL
+            // 作为malloc替换库时 进程退出阶段仍然会有free调用 页面缓存不能析构(munmap掉所有内存页)
+            alignas(PageCache) static char storage[sizeof(PageCache)];
+            static PageCache *instance = new (storage) PageCache;
+            return instance;
+#else
             static PageCache instance;
             return &instance;
+#endif
         }
 
+        /// @brief 构造函数 默认页面缓存通过Instance获取 独立的堆各自持有一个页面缓存
+        /// @param trackHugePages 是否记录直接映射的超大内存 需要整体释放时才记录
+        explicit PageCache(bool trackHugePages = false) : m_trackHugePages(trackHugePages) {}
+
         ~PageCache()
         {
+            this->stopReserveThread();
             this->systemDealloc();
         }
 
+        PageCache(const PageCache &) = delete;
+        PageCache &operator=(const PageCache &) = delete;
+
         /// @brief 向页面缓存申请内存页
         /// @param pageNums 内存页数量
         /// @return void*
         void *allocateSpanPage(size_t pageNums);
 
+        /// @brief 预先映射内存页并放入空闲链表 映射时通过MAP_POPULATE完成缺页 之后的申请从这里分割
+        /// @param pageNums 内存页数量
+        /// @param lockMemory 是否通过mlock锁定在物理内存中 不会被换出
+        /// @return bool 映射失败或者mlock失败时返回false mlock失败时内存页仍然保留在空闲链表中
+        bool reserveSpanPage(size_t pageNums, bool lockMemory = false);
+
+        /// @brief 设置预留内存页的水位 空闲字节数低于lowBytes或者申请时需要同步mmap时
+        /// 唤醒后台线程预留内存页直到空闲字节数达到highBytes 映射和缺页都在后台线程中完成 不持有m_pageMutex
+        /// 空闲字节数包括分割剩余的小内存页 碎片较多时大的申请仍然可能需要同步mmap
+        /// @param lowBytes 低水位
+        /// @param highBytes 高水位 为0时停止后台线程
+        void setReserveWatermark(size_t lowBytes, size_t highBytes);
+
         /// @brief 将待释放的内存页归还给页面缓存
         /// @param ptr 待归还的内存页首地址
         void deallocateSpanPage(void *ptr);
 
+        /// @brief 申请首地址按照alignPages个内存页对齐的内存页 多申请的头尾部分归还到空闲链表
+        /// @param pageNums 内存页数量
+        /// @param alignPages 对齐的内存页数量 需要是2的幂
+        /// @return void* 释放时与普通内存页一样使用deallocateSpanPage
+        void *allocateAlignedSpanPage(size_t pageNums, size_t alignPages);
+
+        /// @brief 原地调整已分配内存页的数量 缩小总是成功 扩大需要右侧相邻内存页空闲且足够大
+        /// @param ptr 已分配的内存页首地址
+        /// @param pageNums 调整后的内存页数量
+        /// @return bool 是否原地调整成功
+        bool resizeSpanPage(void *ptr, size_t pageNums);
+
+        /// @brief 超大内存直接通过mmap申请 不经过页面缓存
+        /// @param pageNums 内存页数量
+        /// @return void*
+        void *allocateHugePage(size_t pageNums);
+
+        /// @brief 直接映射首地址按照alignPages个内存页对齐的超大内存 多映射的头尾部分直接munmap
+        /// @param pageNums 内存页数量
+        /// @param alignPages 对齐的内存页数量 需要是2的幂
+        /// @return void* 释放时与普通超大内存一样使用deallocateHugePage
+        void *allocateAlignedHugePage(size_t pageNums, size_t alignPages);
+
+        /// @brief 释放直接映射的超大内存
+        /// @param ptr 首地址
+        /// @param pageNums 内存页数量
+        void deallocateHugePage(void *ptr, size_t pageNums);
+
+        /// @brief 通过mremap调整直接映射的超大内存 不需要拷贝数据
+        /// @param ptr 原首地址
+        /// @param oldPageNums 原内存页数量
+        /// @param newPageNums 新内存页数量
+        /// @return void* 新首地址 失败返回nullptr且原内存不变
+        void *reallocateHugePage(void *ptr, size_t oldPageNums, size_t newPageNums);
+
+        /// @brief 获取页面缓存的统计信息
+        /// @return PageCacheStats
+        PageCacheStats getStats() const;
+
+        /// @brief 将所有内存页以及记录的超大内存归还给系统 调用时不能有其他线程在使用该页面缓存
+        void releaseAll();
+
     private:
         /// @brief 通过mmap进行内存页申请
         /// @param pageNums 申请的内存页数量 用于计算总大小
         /// @return
         void *systemAlloc(size_t pageNums);
 
-        /// @brief 系统通过munmap进行内存的释放
+        /// @brief 系统通过munmap进行内存的释放 地址相邻的内存页合并成一次munmap 需要持有m_pageMutex或者没有其他线程访问
         void systemDealloc();
 
+        /// @brief 空闲字节数低于低水位或者发生同步mmap时唤醒后台线程 需要持有m_pageMutex
+        /// @param systemAlloced 本次申请是否调用了systemAlloc
+        void checkReserve(bool systemAlloced)
+        {
+            size_t highBytes = this->m_reserveHighBytes.load(std::memory_order_relaxed);
+            if (highBytes == 0)
+                return;
+            if (systemAlloced || this->m_freeBytes.load(std::memory_order_relaxed) < this->m_reserveLowBytes.load(std::memory_order_relaxed))
+                this->wakeReserveThread();
+        }
+
+        void wakeReserveThread();
+
+        /// @brief 后台线程 被唤醒后预留内存页直到空闲字节数达到高水位
+        void reserveLoop();
+
+        void stopReserveThread();
+
     private:
+        struct SpanPage;
+
+        /// @brief 将空闲内存页从m_freePageMap的链表中摘除 需要持有m_pageMutex
+        /// @param spanPage 内存页
+        /// @return bool 内存页不在空闲链表中(正在使用)时返回false
+        bool removeFreeSpanPage(SpanPage *spanPage);
+
+        /// @brief 将内存页放入空闲链表 右侧相邻内存页空闲时进行合并 需要持有m_pageMutex
+        /// @param spanPage 内存页
+        void insertFreeSpanPage(SpanPage *spanPage);
+
         struct SpanPage
         {
             void *startAddr;
@@ -65,6 +166,34 @@ namespace memory_pool
 
         // 记录分配出去的以及保存在m_freePageMap中的内存页 第一个位置是内存页地址 第二个位置是内存页的地址(不是链表)
         std::unordered_map<void *, SpanPage *> m_recordPageMap;
+
+        // 直接映射的超大内存 第一个位置是首地址 第二个位置是内存页数量 只有m_trackHugePages时记录
+        std::unordered_map<void *, size_t> m_hugePageMap;
+        const bool m_trackHugePages;
+
+        // 统计计数 超大内存的申请释放不持有互斥锁 所以使用原子变量
+        std::atomic<size_t> m_mmapNums{0};
+        std::atomic<size_t> m_spanSplitNums{0};
+        std::atomic<size_t> m_spanMergeNums{0};
+        std::atomic<size_t> m_freeBytes{0};
+        std::atomic<size_t> m_committedBytes{0};
+        std::atomic<size_t> m_releasedBytes{0};
+        std::atomic<size_t> m_systemAllocNums{0};
+        std::atomic<size_t> m_reserveNums{0};
+
+        // 后台线程每次预留的内存页数量 小于HUGE_BYTES的申请都可以从中分割
+        static constexpr size_t RESERVE_SPAN_PAGE = HUGE_BYTES / PAGE_SIZE;
+
+        // 预留内存页的水位 高水位为0时不预留
+        std::atomic<size_t> m_reserveLowBytes{0};
+        std::atomic<size_t> m_reserveHighBytes{0};
+
+        // 后台预留线程 以及唤醒使用的互斥锁和条件变量 加锁顺序为m_pageMutex -> m_reserveMutex
+        std::thread m_reserveThread;
+        std::mutex m_reserveMutex;
+        std::condition_variable m_reserveCond;
+        std::atomic<bool> m_reserveWanted{false};
+        bool m_reserveStop = false;
     };
 
 }
@@ -0,0 +1,126 @@
+#ifndef POOL_ALLOCATOR_H
+#define POOL_ALLOCATOR_H
+
+#include "Common.h"
+#include "ThreadCache.h"
+#include "MemoryPool.h"
+#include <new>
+#include <limits>
+#include <type_traits>
+
+namespace memory_pool
+{
+
+/// @brief 基于内存池的STL分配器 无状态 所有实例之间可以互相释放
+/// @tparam T 分配的对象类型
+template<class T>
+class PoolAllocator
+{
+public:
+    using value_type = T;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+
+    // 无状态分配器 拷贝/移动/交换时跟随容器一起传播
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+    using is_always_equal = std::true_type;
+
+    template<class U>
+    struct rebind
+    {
+        using other = PoolAllocator<U>;
+    };
+
+    PoolAllocator() noexcept = default;
+
+    template<class U>
+    PoolAllocator(const PoolAllocator<U>&) noexcept {}
+
+    /// @brief 申请n个对象大小的内存
+    /// @param n 对象数量
+    /// @return T* 类型指针 n为0时与std::allocator一样返回不为空的唯一地址
+    T* allocate(size_t n)
+    {
+        // 内存池不接受大小为0的申请 getIndex(0)会下溢 按1字节申请最小的内存块
+        if (n == 0)
+        {
+            if constexpr (alignof(T) > ALIGNMENT)
+                return static_cast<T*>(MemoryPool::allocateAligned(1, alignof(T)));
+            else
+                return static_cast<T*>(MemoryPool::allocate(1));
+        }
+
+        // 节点类容器每次只申请一个对象 直接使用编译期计算好的索引访问线程缓存链表
+        if constexpr (sizeof(T) <= MAX_BYTES && alignof(T) <= PAGE_SIZE)
+        {
+            if (n == 1)
+            {
+                void* ptr = ThreadCache::Instance()->allocateByIndex(INDEX);
+                MEMORY_POOL_TRACE_RECORD(TRACE_ALLOCATE, ptr, sizeof(T));
+                return static_cast<T*>(ptr);
+            }
+        }
+
+        if (n > std::numeric_limits<size_t>::max() / sizeof(T))
+            throw std::bad_array_new_length();
+
+        if constexpr (alignof(T) > ALIGNMENT)
+            return static_cast<T*>(MemoryPool::allocateAligned(n * sizeof(T), alignof(T)));
+        else
+            return static_cast<T*>(MemoryPool::allocate(n * sizeof(T)));
+    }
+
+    /// @brief 归还n个对象大小的内存
+    /// @param ptr 待归还的地址
+    /// @param n 对象数量 需要与allocate时一致
+    void deallocate(T* ptr, size_t n) noexcept
+    {
+        if (n == 0)
+        {
+            if constexpr (alignof(T) > ALIGNMENT)
+                MemoryPool::deallocateAligned(ptr, 1, alignof(T));
+            else
+                MemoryPool::deallocate(ptr, 1);
+            return;
+        }
+
+        if constexpr (sizeof(T) <= MAX_BYTES && alignof(T) <= PAGE_SIZE)
+        {
+            if (n == 1)
+            {
+                MEMORY_POOL_TRACE_RECORD(TRACE_DEALLOCATE, ptr, sizeof(T));
+                ThreadCache::Instance()->deallocateByIndex(ptr, INDEX);
+                return;
+            }
+        }
+
+        if constexpr (alignof(T) > ALIGNMENT)
+            MemoryPool::deallocateAligned(ptr, n * sizeof(T), alignof(T));
+        else
+            MemoryPool::deallocate(ptr, n * sizeof(T));
+    }
+
+private:
+    // 内存块由页对齐的内存页按照块大小切分 sizeof(T)是alignof(T)的倍数 单个对象的内存块天然满足对齐
+    // 对齐超过PAGE_SIZE的类型以及多个对象的申请交给allocateAligned处理
+    // 单个对象对应的内存块索引 编译期确定
+    static constexpr size_t INDEX = SizeClass::getIndex(sizeof(T));
+};
+
+template<class T, class U>
+bool operator==(const PoolAllocator<T>&, const PoolAllocator<U>&) noexcept
+{
+    return true;
+}
+
+template<class T, class U>
+bool operator!=(const PoolAllocator<T>&, const PoolAllocator<U>&) noexcept
+{
+    return false;
+}
+
+}
+
+#endif // POOL_ALLOCATOR_H
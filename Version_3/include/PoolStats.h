@@ -0,0 +1,66 @@
+#ifndef POOL_STATS_H
+#define POOL_STATS_H
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+namespace memory_pool
+{
+
+/// @brief 单个内存块大小的统计信息
+struct SizeClassStats
+{
+    size_t index = 0;               // 内存块大小对应的索引位置
+    size_t blockSize = 0;           // 内存块大小
+    size_t allocNums = 0;           // 线程缓存申请次数
+    size_t freeNums = 0;            // 线程缓存释放次数
+    size_t cacheHits = 0;           // 线程缓存链表直接命中的次数
+    size_t refillNums = 0;          // 线程缓存向中心缓存批量申请的次数
+    size_t refillBlocks = 0;        // 批量申请得到的内存块总数
+    size_t returnNums = 0;          // 线程缓存向中心缓存归还的次数
+    size_t returnBlocks = 0;        // 归还的内存块总数
+    size_t threadCachedBytes = 0;   // 所有线程缓存中空闲的字节数
+    size_t centralCachedBytes = 0;  // 中心缓存中空闲的字节数
+    size_t spanPages = 0;           // 中心缓存每次向页面缓存申请的内存页数量
+    size_t spanNums = 0;            // 向页面缓存申请内存页的次数
+    size_t spanWasteBytes = 0;      // 所有内存页尾部不足一个内存块而无法使用的字节数
+
+    /// @brief 正在被使用的字节数
+    size_t inUseBytes() const
+    {
+        return allocNums > freeNums ? (allocNums - freeNums) * blockSize : 0;
+    }
+};
+
+/// @brief 页面缓存的统计信息
+struct PageCacheStats
+{
+    size_t mmapNums = 0;            // mmap调用次数
+    size_t spanSplitNums = 0;       // 内存页分割次数
+    size_t spanMergeNums = 0;       // 内存页合并次数
+    size_t freeBytes = 0;           // 空闲链表中的字节数
+    size_t committedBytes = 0;      // 当前向系统映射的字节数
+    size_t releasedBytes = 0;       // 累计归还给系统的字节数
+    size_t systemAllocNums = 0;     // 空闲链表中没有足够大的内存页 申请线程同步mmap的次数
+    size_t reserveNums = 0;         // 后台线程预留内存页的次数
+};
+
+/// @brief 内存池统计信息快照 多线程运行时各项计数之间不保证严格一致
+struct PoolStats
+{
+    // 只包含有过申请或者仍然缓存有内存块的内存块大小 按照索引排列
+    std::vector<SizeClassStats> sizeClasses;
+
+    PageCacheStats pageCache;
+
+    /// @brief 按照表格输出的文本
+    std::string toString() const;
+
+    /// @brief JSON格式输出
+    std::string toJson() const;
+};
+
+}
+
+#endif // POOL_STATS_H
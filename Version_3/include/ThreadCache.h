@@ -2,12 +2,17 @@
 #define THREAD_CACHE_H
 
 #include "Common.h"
+#include "HeapProfiler.h"
+#include "Config.h"
 #include <assert.h>
+#include <initializer_list>
 
 
 namespace memory_pool
 {
 
+class CentralCache;
+class PageCache;
 
 class ThreadCache
 {
@@ -28,12 +33,50 @@ public:
     /// @param size 释放的对象大小
     void deallocate(void* ptr, size_t size);
 
+    /// @brief 线程缓存调整内存大小 能原地调整时返回原地址 否则重新申请并拷贝
+    /// @param ptr 原内存首地址 为nullptr时等同于allocate
+    /// @param oldSize 原申请大小
+    /// @param newSize 新的大小
+    /// @return void* 调整后的内存首地址 失败返回nullptr且原内存不变
+    void* reallocate(void* ptr, size_t oldSize, size_t newSize);
+
+    /// @brief 线程缓存申请按照align对齐的内存 默认8字节对齐的申请请使用allocate
+    /// @param size 申请的内存大小
+    /// @param align 对齐字节数 需要是2的幂
+    /// @return void* 类型指针
+    void* allocateAligned(size_t size, size_t align);
+
+    /// @brief 线程缓存释放allocateAligned申请的内存
+    /// @param ptr 要释放的内存首地址
+    /// @param size 申请时的内存大小
+    /// @param align 申请时的对齐字节数
+    void deallocateAligned(void* ptr, size_t size, size_t align);
+
+    /// @brief 预先从中心缓存为当前线程填充链表 之后这些大小的申请直接命中线程缓存
+    /// 填充的数量会作为对应链表归还给中心缓存时至少保留的数量
+    /// @param sizeCounts {申请大小, 内存块数量} 超过MAX_BYTES的大小直接向页面缓存申请 不需要预热
+    void prewarm(std::initializer_list<std::pair<size_t, size_t>> sizeCounts);
+
+    /// @brief 按照内存块索引直接从对应链表申请内存 跳过getIndex计算 供编译期已知大小的调用方使用
+    /// @param index 内存块大小对应的索引位置
+    /// @return void* 类型指针
+    inline void* allocateByIndex(size_t index);
+
+    /// @brief 按照内存块索引直接将内存归还到对应链表
+    /// @param ptr 要释放的内存首地址
+    /// @param index 内存块大小对应的索引位置
+    inline void deallocateByIndex(void* ptr, size_t index);
+
 private:
-    ThreadCache()
-    {
-        this->m_freeList.fill(nullptr);
-        this->m_freeListSize.fill(0);
-    }
+    // 中心缓存汇总统计信息时需要读取线程的计数以及线程缓存链表指针 堆整体释放时清空链表和计数组
+    friend class CentralCache;
+
+    /// @brief 默认的线程缓存 使用默认的中心缓存和页面缓存
+    ThreadCache();
+
+    /// @brief 构造函数 构造时登记到中心缓存
+    /// @param centralCache 批量申请和归还内存块的中心缓存 大内存使用其对应的页面缓存
+    explicit ThreadCache(CentralCache* centralCache);
 
     /// @brief 从中心缓存中批量申请内存块
     /// @param index 申请的内存块在数组中的索引
@@ -54,6 +97,56 @@ private:
     /// @param index 
     void returnToCentralCache(size_t index);
 
+    /// @brief 保留链表头部的keepNums个内存块 其余归还给中心缓存
+    /// @param index 数组链表对应的索引位置
+    /// @param keepNums 保留的内存块数量 可以为0
+    void returnListTail(size_t index, size_t keepNums);
+
+    /// @brief 所有链表的空闲字节数超过上限时调用 依次归还各个链表 直到不超过上限的(100 - 归还比例)%
+    /// @param maxBytes 线程缓存的字节数上限
+    void returnToByteBudget(size_t maxBytes);
+
+    /// @brief 将所有链表中的内存块归还给中心缓存 线程退出时使用
+    void returnAllToCentralCache();
+
+    /// @brief 每组内存块大小的申请释放次数 只有本线程写入 统计时其他线程读取
+    /// 占一个内存页 线程第一次使用组中的某个内存块大小时才申请
+    static constexpr size_t COUNTER_GROUP_SIZE = PAGE_SIZE / (2 * sizeof(size_t));
+    static constexpr size_t COUNTER_GROUP_NUMS = FREE_LIST_SIZE / COUNTER_GROUP_SIZE;
+    struct CounterGroup
+    {
+        std::atomic<size_t> allocNums[COUNTER_GROUP_SIZE];
+        std::atomic<size_t> freeNums[COUNTER_GROUP_SIZE];
+    };
+    static_assert(sizeof(CounterGroup) == PAGE_SIZE, "a counter group fills one page");
+
+    /// @brief 获取index所在的计数组 没有时申请
+    /// @param index 内存块大小对应的索引位置
+    /// @return CounterGroup*
+    CounterGroup* getCounterGroup(size_t index)
+    {
+        CounterGroup* group = this->m_counterGroups[index / COUNTER_GROUP_SIZE].load(std::memory_order_relaxed);
+        if (__builtin_expect(group != nullptr, 1))
+            return group;
+        return this->createCounterGroup(index);
+    }
+
+    /// @brief 从中心缓存取一个内存页作为index所在的计数组 清零之后发布给统计线程
+    CounterGroup* createCounterGroup(size_t index);
+
+    /// @brief 线程退出之后仍然可能有申请释放(例如其他thread_local的析构) 计数写入这里 不会再被读取
+    static CounterGroup* discardCounterGroup()
+    {
+        static CounterGroup discardGroup;
+        return &discardGroup;
+    }
+
+    /// @brief 采样计数用完时调用 重置计数并记录本次申请
+    /// @param ptr 申请得到的地址
+    /// @param size 申请大小
+    /// @param blockSize 实际分配的内存块大小
+    void sampleAllocation(void* ptr, size_t size, size_t blockSize);
+
 
 private:    
 
@@ -63,14 +156,90 @@ private:
     // 通过数组记录对应链表中内存块的数量
     std::array<size_t, FREE_LIST_SIZE> m_freeListSize;
 
+    // 预热之后对应链表至少保留的内存块数量 没有预热时为0
+    std::array<uint32_t, FREE_LIST_SIZE> m_keepNums;
+
+    // 所有链表中空闲内存块的总字节数 以及可能非空的链表(按位记录 链表变为空时不立即清除)
+    // 超过字节数上限时只遍历这些链表
+    size_t m_cachedBytes;
+    std::array<uint64_t, FREE_LIST_SIZE / 64> m_cachedClasses;
+    size_t m_budgetCursor;
+
+    // 按组延迟申请的申请和释放次数 线程通常只使用少数几组 不需要为所有内存块大小预留计数
+    std::array<std::atomic<CounterGroup*>, COUNTER_GROUP_NUMS> m_counterGroups;
+
+    // 距离下一次采样还需要申请的字节数 小于0时进入采样慢路径
+    ptrdiff_t m_bytesUntilSample;
+
+    // 中心缓存中登记的线程缓存双向链表
+    ThreadCache* m_prevCache;
+    ThreadCache* m_nextCache;
+
+    // 所属的中心缓存以及页面缓存
+    CentralCache* m_centralCache;
+    PageCache* m_pageCache;
+    // 构造时取一次 释放路径上读取参数不再经过Config::Instance()的静态局部变量检查
+    const Config* m_config;
+
 };
 
+void* ThreadCache::allocateByIndex(size_t index)
+{
+    assert(index < FREE_LIST_SIZE);
+
+    // 只有本线程写入 不需要原子的读改写 普通的load/store即可
+    std::atomic<size_t>& allocNums = this->getCounterGroup(index)->allocNums[index % COUNTER_GROUP_SIZE];
+    allocNums.store(allocNums.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
 
+    size_t blockSize = SizeClass::getBlockSize(index);
+    void *headNode = this->m_freeList[index];
+    if (headNode)
+    {
+        void *nextNode = *reinterpret_cast<void **>(headNode);
+        *reinterpret_cast<void **>(headNode) = nullptr;
+        this->m_freeList[index] = nextNode;
+        this->m_freeListSize[index]--;
+        this->m_cachedBytes -= blockSize;
+    }
+    else
+    {
+        headNode = this->fetchFromCentralCache(index);
+    }
+
+    this->m_bytesUntilSample -= static_cast<ptrdiff_t>(blockSize);
+    if (__builtin_expect(this->m_bytesUntilSample < 0, 0))
+        this->sampleAllocation(headNode, blockSize, blockSize);
+
+    return headNode;
+}
+
+void ThreadCache::deallocateByIndex(void* ptr, size_t index)
+{
+    assert(ptr != nullptr && index < FREE_LIST_SIZE);
 
+    std::atomic<size_t>& freeNums = this->getCounterGroup(index)->freeNums[index % COUNTER_GROUP_SIZE];
+    freeNums.store(freeNums.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
 
+    if (__builtin_expect(HeapProfiler::mayBeSampled(ptr), 0))
+        HeapProfiler::Instance()->recordDeallocation(ptr);
 
+    void *oldHead = this->m_freeList[index];
+    *reinterpret_cast<void **>(ptr) = oldHead;
+    this->m_freeList[index] = ptr;
+    this->m_freeListSize[index]++;
+    this->m_cachedBytes += SizeClass::getBlockSize(index);
+    if (!oldHead)
+        this->m_cachedClasses[index / 64] |= uint64_t(1) << (index % 64);
 
+    if (this->shouldReturntoCentralCache(index))
+    {
+        this->returnToCentralCache(index);
+    }
 
+    size_t maxBytes = this->m_config->getThreadCacheMaxBytes();
+    if (__builtin_expect(maxBytes != 0 && this->m_cachedBytes > maxBytes, 0))
+        this->returnToByteBudget(maxBytes);
+}
 
 }
 
@@ -0,0 +1,50 @@
+#ifndef TRACE_FORMAT_H
+#define TRACE_FORMAT_H
+
+#include <stdint.h>
+
+/**
+ * 内存申请轨迹文件格式 由TraceRecorder写入 回放工具读取
+ * 文件头 TraceFileHeader
+ * 之后是若干数据块: TraceChunkHeader + recordNums个TraceRecord
+ * 每个数据块来自同一个线程的缓冲区 不同线程的数据块交错出现 回放时按照时间戳合并
+ */
+namespace memory_pool
+{
+
+constexpr char TRACE_MAGIC[8] = {'M', 'P', 'T', 'R', 'A', 'C', 'E', '1'};
+constexpr uint32_t TRACE_VERSION = 1;
+
+enum TraceOp : uint8_t
+{
+    TRACE_ALLOCATE = 0,
+    TRACE_DEALLOCATE = 1,
+};
+
+struct TraceFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;    // sizeof(TraceRecord) 用于校验
+};
+
+struct TraceChunkHeader
+{
+    uint32_t threadId;      // 记录线程的编号 从0开始按照第一次记录的顺序分配
+    uint32_t recordNums;
+};
+
+struct TraceRecord
+{
+    uint64_t timestamp;     // 相对于开始记录时刻的纳秒数
+    uint64_t ptr;           // 申请得到的地址 回放时只用于匹配申请和释放
+    uint32_t size;          // 申请大小 超过4GB的申请记为UINT32_MAX
+    uint8_t op;             // TraceOp
+    uint8_t reserved[3];
+};
+
+static_assert(sizeof(TraceRecord) == 24, "TraceRecord must stay 24 bytes");
+
+}
+
+#endif // TRACE_FORMAT_H
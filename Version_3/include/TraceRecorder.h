@@ -0,0 +1,104 @@
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+#include "Common.h"
+#include "TraceFormat.h"
+#include <new>
+#include <pthread.h>
+
+namespace memory_pool
+{
+
+/**
+ * 内存申请轨迹记录
+ * 定义MEMORY_POOL_TRACE编译时MemoryPool/PoolAllocator的每次申请释放都会调用record
+ * 没有定义时不会产生任何开销
+ * 每个线程写入自己的缓冲区 缓冲区满、线程退出、stop时整块写入文件
+ * 缓冲区通过mmap申请 记录过程不会调用malloc 可以在malloc替换库中使用
+ * 设置环境变量MEMPOOL_TRACE_FILE时第一次使用就开始记录 进程退出时自动写完
+ */
+class TraceRecorder
+{
+public:
+    static TraceRecorder* Instance()
+    {
+        // 进程退出阶段仍然会有释放 不析构
+        alignas(TraceRecorder) static char storage[sizeof(TraceRecorder)];
+        static TraceRecorder *instance = new (storage) TraceRecorder;
+        return instance;
+    }
+
+    /// @brief 开始记录 文件已经存在时覆盖
+    /// @param path 轨迹文件路径
+    /// @return bool 是否成功打开文件
+    bool start(const char* path);
+
+    /// @brief 停止记录 写入所有线程缓冲区中剩余的记录并关闭文件
+    void stop();
+
+    bool isRecording() const { return this->m_recording.load(std::memory_order_relaxed); }
+
+    /// @brief 记录一次申请或释放
+    /// @param op TRACE_ALLOCATE / TRACE_DEALLOCATE
+    /// @param ptr 地址
+    /// @param size 大小
+    void record(TraceOp op, void* ptr, size_t size)
+    {
+        if (this->isRecording() && ptr)
+            this->append(op, ptr, size);
+    }
+
+private:
+    TraceRecorder();
+
+    // 每个缓冲区保存的记录数量
+    static constexpr uint32_t BUFFER_RECORDS = 4096;
+
+    struct ThreadBuffer
+    {
+        std::atomic_flag lock;              // 线程写入和stop写文件之间互斥
+        bool inUse;                         // 线程退出后缓冲区交给新线程复用
+        uint32_t threadId;
+        uint32_t recordNums;
+        ThreadBuffer* next;
+        TraceRecord records[BUFFER_RECORDS];
+    };
+
+    void append(TraceOp op, void* ptr, size_t size);
+
+    /// @brief 获取当前线程的缓冲区 第一次调用时创建并登记
+    ThreadBuffer* threadBuffer();
+
+    /// @brief 将缓冲区中的记录写入文件 需要持有缓冲区的锁
+    void flushBuffer(ThreadBuffer* buffer);
+
+    /// @brief 线程退出时的回调 写入剩余记录
+    static void onThreadExit(void* buffer);
+
+private:
+    std::atomic<bool> m_recording{false};
+    int m_fd = -1;
+    uint64_t m_startNs = 0;
+
+    // 写文件的互斥锁
+    std::mutex m_fileMutex;
+
+    // 所有线程缓冲区组成的链表 缓冲区不会释放 线程退出后由新线程复用
+    std::atomic_flag m_bufferListLock = ATOMIC_FLAG_INIT;
+    ThreadBuffer* m_bufferList = nullptr;
+    uint32_t m_nextThreadId = 0;
+
+    pthread_key_t m_threadKey;
+};
+
+}
+
+// 申请释放的记录点 没有定义MEMORY_POOL_TRACE时为空
+#ifdef MEMORY_POOL_TRACE
+#define MEMORY_POOL_TRACE_RECORD(op, ptr, size) \
+    ::memory_pool::TraceRecorder::Instance()->record(::memory_pool::op, (ptr), (size))
+#else
+#define MEMORY_POOL_TRACE_RECORD(op, ptr, size) ((void)0)
+#endif
+
+#endif // TRACE_RECORDER_H
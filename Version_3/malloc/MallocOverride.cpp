@@ -0,0 +1,474 @@
+/**
+ * 将内存池包装成libc的malloc接口 编译成libmemorypool_malloc.so
+ * 使用方式: LD_PRELOAD=/path/to/libmemorypool_malloc.so ./your_program
+ *
+ * 内存池接口需要在释放时给出对象大小 而free只给出地址
+ * 因此每次申请都在用户地址前面放一个16字节的头部 记录向内存池申请的大小以及用户地址的偏移
+ *
+ * 自举问题:
+ * 1. 内存池内部(页面缓存的std::map/unordered_map以及SpanPage)本身通过operator new申请内存
+ *    这些调用会重新进入本文件的malloc 所以使用线程局部的标志位 在内存池内部时转交给libc原本的malloc
+ * 2. 通过dlsym查找libc原本的malloc时 dlsym自身也可能调用malloc/calloc
+ *    此时使用一块静态缓冲区应付 这部分内存不会被释放
+ * 3. 内存池的单例都是函数内静态变量 第一次使用时才构造 不依赖全局构造顺序
+ */
+
+#include "MemoryPool.h"
+#include <dlfcn.h>
+#include <errno.h>
+#include <malloc.h>
+#include <new>
+#include <algorithm>
+
+using namespace memory_pool;
+
+namespace
+{
+
+// 头部大小 同时也是malloc保证的最小对齐
+constexpr size_t HEADER_SIZE = 16;
+
+struct BlockHeader
+{
+    size_t size;    // 向内存池申请的总大小 释放时作为deallocate的参数
+    size_t offset;  // 用户地址相对于申请首地址的偏移
+};
+static_assert(sizeof(BlockHeader) == HEADER_SIZE, "BlockHeader must keep 16-byte alignment");
+
+// 当前线程是否正在内存池内部 内存池内部的申请/释放全部交给libc
+thread_local bool t_inPool = false;
+
+// libc原本的分配函数
+using MallocFunc = void *(*)(size_t);
+using FreeFunc = void (*)(void *);
+using CallocFunc = void *(*)(size_t, size_t);
+using ReallocFunc = void *(*)(void *, size_t);
+using MemalignFunc = void *(*)(size_t, size_t);
+using UsableSizeFunc = size_t (*)(void *);
+
+MallocFunc s_realMalloc = nullptr;
+FreeFunc s_realFree = nullptr;
+CallocFunc s_realCalloc = nullptr;
+ReallocFunc s_realRealloc = nullptr;
+MemalignFunc s_realMemalign = nullptr;
+UsableSizeFunc s_realUsableSize = nullptr;
+
+// dlsym期间使用的静态缓冲区
+alignas(HEADER_SIZE) char s_bootstrapBuffer[64 * 1024];
+std::atomic<size_t> s_bootstrapUsed{0};
+std::atomic<bool> s_resolving{false};
+std::atomic<bool> s_resolved{false};
+
+bool isBootstrapPtr(void *ptr)
+{
+    return ptr >= s_bootstrapBuffer && ptr < s_bootstrapBuffer + sizeof(s_bootstrapBuffer);
+}
+
+void *bootstrapAlloc(size_t size)
+{
+    size_t bytes = (size + HEADER_SIZE - 1) / HEADER_SIZE * HEADER_SIZE;
+    size_t offset = s_bootstrapUsed.fetch_add(bytes, std::memory_order_relaxed);
+    if (offset + bytes > sizeof(s_bootstrapBuffer))
+        return nullptr;
+    // 静态缓冲区本身就是零初始化的 calloc也可以直接使用
+    return s_bootstrapBuffer + offset;
+}
+
+void resolveRealFunctions()
+{
+    if (s_resolved.load(std::memory_order_acquire))
+        return;
+
+    s_resolving.store(true, std::memory_order_release);
+    s_realMalloc = reinterpret_cast<MallocFunc>(dlsym(RTLD_NEXT, "malloc"));
+    s_realCalloc = reinterpret_cast<CallocFunc>(dlsym(RTLD_NEXT, "calloc"));
+    s_realRealloc = reinterpret_cast<ReallocFunc>(dlsym(RTLD_NEXT, "realloc"));
+    s_realMemalign = reinterpret_cast<MemalignFunc>(dlsym(RTLD_NEXT, "memalign"));
+    s_realUsableSize = reinterpret_cast<UsableSizeFunc>(dlsym(RTLD_NEXT, "malloc_usable_size"));
+    s_realFree = reinterpret_cast<FreeFunc>(dlsym(RTLD_NEXT, "free"));
+    s_resolving.store(false, std::memory_order_release);
+    s_resolved.store(true, std::memory_order_release);
+}
+
+// 进程启动时就解析好libc的函数 避免之后在内存池的锁内调用dlsym
+__attribute__((constructor)) void initMallocOverride()
+{
+    resolveRealFunctions();
+}
+
+void *fallbackAlloc(size_t size, size_t align)
+{
+    if (s_resolving.load(std::memory_order_acquire))
+        return bootstrapAlloc(size);
+    resolveRealFunctions();
+    return align > HEADER_SIZE ? s_realMemalign(align, size) : s_realMalloc(size);
+}
+
+// 内存池内部标志位的RAII包装
+struct PoolScope
+{
+    PoolScope() { t_inPool = true; }
+    ~PoolScope() { t_inPool = false; }
+};
+
+/// @brief 从内存池申请内存并写入头部
+/// @param size 用户申请的大小
+/// @param align 用户地址的对齐要求 需要是2的幂
+/// @return void* 用户地址 失败返回nullptr
+void *poolAlloc(size_t size, size_t align)
+{
+    if (t_inPool)
+        return fallbackAlloc(size, align);
+
+    // 对齐要求超过头部大小时多申请align字节 在其中找到对齐的位置
+    size_t extra = align > HEADER_SIZE ? align : 0;
+    if (size > SIZE_MAX - HEADER_SIZE - extra - HEADER_SIZE)
+    {
+        errno = ENOMEM;
+        return nullptr;
+    }
+
+    // 总大小取16的倍数 这样块在页对齐的span中切分后首地址天然16字节对齐
+    size_t total = (size + HEADER_SIZE + extra + HEADER_SIZE - 1) / HEADER_SIZE * HEADER_SIZE;
+
+    char *base = nullptr;
+    {
+        PoolScope scope;
+        base = static_cast<char *>(MemoryPool::allocate(total));
+    }
+    if (!base)
+    {
+        errno = ENOMEM;
+        return nullptr;
+    }
+
+    size_t userAddr = reinterpret_cast<size_t>(base) + HEADER_SIZE;
+    if (extra)
+        userAddr = (userAddr + align - 1) & ~(align - 1);
+
+    BlockHeader *header = reinterpret_cast<BlockHeader *>(userAddr - HEADER_SIZE);
+    header->size = total;
+    header->offset = userAddr - reinterpret_cast<size_t>(base);
+    return reinterpret_cast<void *>(userAddr);
+}
+
+void poolFree(void *ptr)
+{
+    if (!ptr || isBootstrapPtr(ptr))
+        return;
+
+    if (t_inPool)
+    {
+        resolveRealFunctions();
+        s_realFree(ptr);
+        return;
+    }
+
+    BlockHeader *header = reinterpret_cast<BlockHeader *>(static_cast<char *>(ptr) - HEADER_SIZE);
+    void *base = static_cast<char *>(ptr) - header->offset;
+    size_t total = header->size;
+
+    PoolScope scope;
+    MemoryPool::deallocate(base, total);
+}
+
+size_t poolUsableSize(void *ptr)
+{
+    if (!ptr)
+        return 0;
+    if (isBootstrapPtr(ptr))
+        return 0;
+    if (t_inPool)
+    {
+        resolveRealFunctions();
+        return s_realUsableSize(ptr);
+    }
+
+    BlockHeader *header = reinterpret_cast<BlockHeader *>(static_cast<char *>(ptr) - HEADER_SIZE);
+    return header->size - header->offset;
+}
+
+void *poolRealloc(void *ptr, size_t size)
+{
+    if (!ptr)
+        return poolAlloc(size, HEADER_SIZE);
+    if (size == 0)
+    {
+        poolFree(ptr);
+        return nullptr;
+    }
+
+    if (t_inPool && !isBootstrapPtr(ptr))
+    {
+        resolveRealFunctions();
+        return s_realRealloc(ptr, size);
+    }
+
+    // 静态缓冲区中的内存不知道原大小 只能按照缓冲区剩余部分拷贝
+    size_t oldSize = isBootstrapPtr(ptr) ? static_cast<size_t>(s_bootstrapBuffer + sizeof(s_bootstrapBuffer) - static_cast<char *>(ptr))
+                                         : poolUsableSize(ptr);
+
+    // 新大小仍然落在原内存块中 并且不会浪费一半以上时直接复用
+    if (!isBootstrapPtr(ptr) && size <= oldSize && size >= oldSize / 2)
+        return ptr;
+
+    // 普通对齐的内存块交给内存池原地扩容(合并右侧空闲内存页或者mremap) 头部跟随数据一起移动
+    BlockHeader *header = reinterpret_cast<BlockHeader *>(static_cast<char *>(ptr) - HEADER_SIZE);
+    if (!isBootstrapPtr(ptr) && header->offset == HEADER_SIZE && size <= SIZE_MAX - 2 * HEADER_SIZE)
+    {
+        size_t total = (size + HEADER_SIZE + HEADER_SIZE - 1) / HEADER_SIZE * HEADER_SIZE;
+        char *base = nullptr;
+        {
+            PoolScope scope;
+            base = static_cast<char *>(MemoryPool::reallocate(header, header->size, total));
+        }
+        if (!base)
+        {
+            errno = ENOMEM;
+            return nullptr;
+        }
+        reinterpret_cast<BlockHeader *>(base)->size = total;
+        return base + HEADER_SIZE;
+    }
+
+    void *newPtr = poolAlloc(size, HEADER_SIZE);
+    if (!newPtr)
+        return nullptr;
+    memcpy(newPtr, ptr, std::min(oldSize, size));
+    poolFree(ptr);
+    return newPtr;
+}
+
+bool isPowerOfTwo(size_t align)
+{
+    return align != 0 && (align & (align - 1)) == 0;
+}
+
+void *newImpl(size_t size, size_t align, bool nothrow)
+{
+    while (true)
+    {
+        void *ptr = poolAlloc(size, align);
+        if (ptr)
+            return ptr;
+
+        std::new_handler handler = std::get_new_handler();
+        if (!handler)
+        {
+            if (nothrow)
+                return nullptr;
+            throw std::bad_alloc();
+        }
+
+        if (nothrow)
+        {
+            try
+            {
+                handler();
+            }
+            catch (...)
+            {
+                return nullptr;
+            }
+        }
+        else
+        {
+            handler();
+        }
+    }
+}
+
+}
+
+extern "C"
+{
+
+void *malloc(size_t size)
+{
+    return poolAlloc(size, HEADER_SIZE);
+}
+
+void free(void *ptr)
+{
+    poolFree(ptr);
+}
+
+void *calloc(size_t num, size_t size)
+{
+    if (size != 0 && num > SIZE_MAX / size)
+    {
+        errno = ENOMEM;
+        return nullptr;
+    }
+
+    size_t bytes = num * size;
+    if (t_inPool)
+    {
+        if (s_resolving.load(std::memory_order_acquire))
+            return bootstrapAlloc(bytes);
+        resolveRealFunctions();
+        return s_realCalloc(num, size);
+    }
+
+    // 内存池中的内存块会被复用 需要手动清零
+    void *ptr = poolAlloc(bytes, HEADER_SIZE);
+    if (ptr)
+        memset(ptr, 0, bytes);
+    return ptr;
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    return poolRealloc(ptr, size);
+}
+
+int posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+    if (!isPowerOfTwo(alignment) || alignment % sizeof(void *) != 0)
+        return EINVAL;
+
+    void *ptr = poolAlloc(size, alignment);
+    if (!ptr)
+        return ENOMEM;
+    *memptr = ptr;
+    return 0;
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    if (!isPowerOfTwo(alignment))
+    {
+        errno = EINVAL;
+        return nullptr;
+    }
+    return poolAlloc(size, alignment);
+}
+
+void *memalign(size_t alignment, size_t size)
+{
+    if (!isPowerOfTwo(alignment))
+    {
+        errno = EINVAL;
+        return nullptr;
+    }
+    return poolAlloc(size, alignment);
+}
+
+void *valloc(size_t size)
+{
+    return poolAlloc(size, PAGE_SIZE);
+}
+
+void *pvalloc(size_t size)
+{
+    return poolAlloc((size + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE, PAGE_SIZE);
+}
+
+size_t malloc_usable_size(void *ptr)
+{
+    return poolUsableSize(ptr);
+}
+
+}
+
+/* 可替换的全局operator new/delete */
+
+void *operator new(size_t size)
+{
+    return newImpl(size, HEADER_SIZE, false);
+}
+
+void *operator new[](size_t size)
+{
+    return newImpl(size, HEADER_SIZE, false);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    return newImpl(size, HEADER_SIZE, true);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+    return newImpl(size, HEADER_SIZE, true);
+}
+
+void *operator new(size_t size, std::align_val_t align)
+{
+    return newImpl(size, static_cast<size_t>(align), false);
+}
+
+void *operator new[](size_t size, std::align_val_t align)
+{
+    return newImpl(size, static_cast<size_t>(align), false);
+}
+
+void *operator new(size_t size, std::align_val_t align, const std::nothrow_t &) noexcept
+{
+    return newImpl(size, static_cast<size_t>(align), true);
+}
+
+void *operator new[](size_t size, std::align_val_t align, const std::nothrow_t &) noexcept
+{
+    return newImpl(size, static_cast<size_t>(align), true);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    poolFree(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    poolFree(ptr);
+}
+
+void operator delete(void *ptr, const std::nothrow_t &) noexcept
+{
+    poolFree(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept
+{
+    poolFree(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    poolFree(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept
+{
+    poolFree(ptr);
+}
+
+void operator delete(void *ptr, std::align_val_t) noexcept
+{
+    poolFree(ptr);
+}
+
+void operator delete[](void *ptr, std::align_val_t) noexcept
+{
+    poolFree(ptr);
+}
+
+void operator delete(void *ptr, std::align_val_t, const std::nothrow_t &) noexcept
+{
+    poolFree(ptr);
+}
+
+void operator delete[](void *ptr, std::align_val_t, const std::nothrow_t &) noexcept
+{
+    poolFree(ptr);
+}
+
+void operator delete(void *ptr, size_t, std::align_val_t) noexcept
+{
+    poolFree(ptr);
+}
+
+void operator delete[](void *ptr, size_t, std::align_val_t) noexcept
+{
+    poolFree(ptr);
+}
@@ -0,0 +1,141 @@
+#include "Arena.h"
+#include "PageCache.h"
+#include <algorithm>
+
+
+namespace memory_pool
+{
+
+    Arena::Arena(size_t spanPageNums)
+        : m_spanPageNums(spanPageNums > 0 ? spanPageNums : 1),
+          m_firstSpan(nullptr),
+          m_curSpan(nullptr),
+          m_cursor(nullptr),
+          m_limit(nullptr),
+          m_usedBytes(0),
+          m_reservedBytes(0),
+          m_destructors(nullptr)
+    {
+    }
+
+    Arena::~Arena()
+    {
+        this->release();
+    }
+
+    void Arena::reset()
+    {
+        this->runDestructors();
+        this->m_usedBytes = 0;
+        if (this->m_firstSpan)
+            this->useSpan(this->m_firstSpan);
+    }
+
+    void Arena::release()
+    {
+        this->runDestructors();
+        Span* span = this->m_firstSpan;
+        while (span)
+        {
+            Span* next = span->next;
+            this->deallocateSpan(span);
+            span = next;
+        }
+        this->m_firstSpan = nullptr;
+        this->m_curSpan = nullptr;
+        this->m_cursor = nullptr;
+        this->m_limit = nullptr;
+        this->m_usedBytes = 0;
+        this->m_reservedBytes = 0;
+    }
+
+    size_t Arena::getUsedBytes() const
+    {
+        if (!this->m_curSpan)
+            return this->m_usedBytes;
+        return this->m_usedBytes + (this->m_cursor - reinterpret_cast<char*>(this->m_curSpan));
+    }
+
+    void* Arena::allocateSlow(size_t size, size_t align)
+    {
+        /**
+         * 当前内存页放不下
+         * 整体流程:
+         * reset之后当前内存页后面还有保留的内存页 放得下时直接使用;
+         * 否则申请新的内存页 至少DEFAULT_SPAN_PAGE个 超过时按照实际大小申请 插入到当前内存页之后;
+         * 放不下的保留内存页留在新内存页之后 之后仍然可以使用;
+         */
+        size_t needBytes = sizeof(Span) + size + align;
+
+        Span* next = this->m_curSpan ? this->m_curSpan->next : this->m_firstSpan;
+        if (!next || next->pageNums * PAGE_SIZE < needBytes)
+        {
+            size_t pageNums = std::max(this->m_spanPageNums, (needBytes + PAGE_SIZE - 1) / PAGE_SIZE);
+            Span* span = this->allocateSpan(pageNums);
+            if (this->m_curSpan)
+            {
+                span->next = this->m_curSpan->next;
+                this->m_curSpan->next = span;
+            }
+            else
+            {
+                span->next = this->m_firstSpan;
+                this->m_firstSpan = span;
+            }
+            next = span;
+        }
+
+        if (this->m_curSpan)
+            this->m_usedBytes += this->m_curSpan->pageNums * PAGE_SIZE;
+        this->useSpan(next);
+
+        size_t addr = (reinterpret_cast<size_t>(this->m_cursor) + align - 1) & ~(align - 1);
+        assert(addr + size <= reinterpret_cast<size_t>(this->m_limit));
+        this->m_cursor = reinterpret_cast<char*>(addr + size);
+        return reinterpret_cast<void*>(addr);
+    }
+
+    void Arena::useSpan(Span* span)
+    {
+        this->m_curSpan = span;
+        this->m_cursor = reinterpret_cast<char*>(span) + sizeof(Span);
+        this->m_limit = reinterpret_cast<char*>(span) + span->pageNums * PAGE_SIZE;
+    }
+
+    Arena::Span* Arena::allocateSpan(size_t pageNums)
+    {
+        void* addr = pageNums * PAGE_SIZE >= HUGE_BYTES ? PageCache::Instance()->allocateHugePage(pageNums)
+                                                        : PageCache::Instance()->allocateSpanPage(pageNums);
+        if (!addr)
+            throw std::bad_alloc();
+
+        Span* span = static_cast<Span*>(addr);
+        span->next = nullptr;
+        span->pageNums = pageNums;
+        this->m_reservedBytes += pageNums * PAGE_SIZE;
+        return span;
+    }
+
+    void Arena::deallocateSpan(Span* span)
+    {
+        size_t pageNums = span->pageNums;
+        if (pageNums * PAGE_SIZE >= HUGE_BYTES)
+            PageCache::Instance()->deallocateHugePage(span, pageNums);
+        else
+            PageCache::Instance()->deallocateSpanPage(span);
+    }
+
+    void Arena::runDestructors()
+    {
+        DestructorNode* node = this->m_destructors;
+        this->m_destructors = nullptr;
+        while (node)
+        {
+            // 析构函数可能使用区域中的其他对象 节点本身在reset之前一直有效
+            DestructorNode* next = node->next;
+            node->destroy(node->object);
+            node = next;
+        }
+    }
+
+}
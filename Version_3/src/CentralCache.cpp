@@ -1,39 +1,327 @@
 #include "CentralCache.h"
 #include "PageCache.h"
+#include "ThreadCache.h"
+#include "Config.h"
+#include <stdint.h>
+#include <system_error>
 
 namespace memory_pool
 {
 
-    void CentralCache::printListSize()
+    namespace
     {
-        std::cout << "m_freeListSize nums: " << std::endl;
-        for (int i = 0; i < 8; i++)
+        /// @brief 编译期生成每个内存块大小对应的内存页数量
+        constexpr std::array<uint8_t, FREE_LIST_SIZE> makeSpanPageTable()
         {
-            std::cout << std::setw(5) << std::left << m_freeListSize[i] << " ";
+            std::array<uint8_t, FREE_LIST_SIZE> table{};
+            for (size_t i = 0; i < FREE_LIST_SIZE; ++i)
+                table[i] = static_cast<uint8_t>(SizeClass::computeSpanPages(SizeClass::getBlockSize(i)));
+            return table;
         }
-        std::cout << std::endl;
 
-        std::cout << "while get list nums: " << std::endl;
-        std::array<size_t, 8> arr;
-        for (int i = 0; i < 8; ++i)
+        // 最大的内存块也只需要MAX_BYTES / PAGE_SIZE个内存页
+        static_assert(MAX_SPAN_PAGE <= UINT8_MAX && MAX_BYTES / PAGE_SIZE <= UINT8_MAX, "span page table entries are uint8_t");
+
+        // 只在中心缓存中使用 放在这里避免每个包含Common.h的编译单元都计算一遍
+        constexpr std::array<uint8_t, FREE_LIST_SIZE> SPAN_PAGE_TABLE = makeSpanPageTable();
+
+        static_assert(SPAN_PAGE_TABLE[SizeClass::getIndex(8)] == SPAN_PAGE, "small blocks keep the minimum span");
+        static_assert(SPAN_PAGE_TABLE[SizeClass::getIndex(MAX_BYTES)] == MAX_BYTES / PAGE_SIZE, "the largest block fills its span");
+
+        /// @brief 内存块大小对应的内存页数量 最少内存页数量为默认值时查表 调整之后在申请内存页时计算
+        size_t getSpanPages(size_t index)
+        {
+            size_t minSpanPages = Config::Instance()->getSpanPages();
+            if (minSpanPages == SPAN_PAGE)
+                return SPAN_PAGE_TABLE[index];
+            return SizeClass::computeSpanPages(SizeClass::getBlockSize(index), minSpanPages);
+        }
+
+        // 中心缓存创建的线程缓存占用的字节数 按内存页取整
+        constexpr size_t THREAD_CACHE_BYTES = (sizeof(ThreadCache) + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+
+        /// @brief 存活的中心缓存链表的自旋锁加锁
+        void lockCentralList(std::atomic_flag &lock)
+        {
+            while (lock.test_and_set(std::memory_order_acquire))
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    std::atomic<uint64_t> CentralCache::s_nextId{1};
+    CentralCache *CentralCache::s_centralHead = nullptr;
+    std::atomic_flag CentralCache::s_centralLock = ATOMIC_FLAG_INIT;
+
+    CentralCache::CentralCache(PageCache *pageCache, bool ownsThreadCaches)
+        : m_pageCache(pageCache), m_ownsThreadCaches(ownsThreadCaches)
+    {
+        // 线程退出时通过pthread_key的析构回调注销线程缓存
+        // 不给线程缓存加析构函数: thread_local的析构登记(__cxa_thread_atexit)内部会调用calloc 作为malloc替换库时会出现混用
+        this->m_threadCacheKey = CentralCache::sharedThreadCacheKey();
+        this->m_id = s_nextId.fetch_add(1, std::memory_order_relaxed);
+
+        this->clearFreeLists();
+
+        this->m_threadCacheHead = nullptr;
+        this->m_freeCounterPages = nullptr;
+        this->m_threadCacheLock.clear();
+
+        lockCentralList(s_centralLock);
+        this->m_prevCentral = nullptr;
+        this->m_nextCentral = s_centralHead;
+        if (s_centralHead)
+            s_centralHead->m_prevCentral = this;
+        s_centralHead = this;
+        s_centralLock.clear(std::memory_order_release);
+    }
+
+    CentralCache::~CentralCache()
+    {
+        // 默认的中心缓存在进程退出阶段仍然可能被使用 不做任何处理
+        if (!this->m_ownsThreadCaches)
+            return;
+
+        // 从存活的中心缓存中摘除之后 线程退出时不会再访问该中心缓存 仍然存活的线程的线程缓存在这里释放
+        lockCentralList(s_centralLock);
+        if (this->m_prevCentral)
+            this->m_prevCentral->m_nextCentral = this->m_nextCentral;
+        else
+            s_centralHead = this->m_nextCentral;
+        if (this->m_nextCentral)
+            this->m_nextCentral->m_prevCentral = this->m_prevCentral;
+        s_centralLock.clear(std::memory_order_release);
+
+        // 析构堆的线程通常也使用过该堆 直接从自己的表中删除 不留下需要跳过的表项
+        ThreadCacheTable *table = static_cast<ThreadCacheTable *>(pthread_getspecific(this->m_threadCacheKey));
+        if (table)
+        {
+            size_t size = 0;
+            for (size_t i = 0; i < table->size; ++i)
+            {
+                if (table->slots[i].centralId != this->m_id)
+                    table->slots[size++] = table->slots[i];
+            }
+            table->size = size;
+        }
+
+        ThreadCache *threadCache = this->m_threadCacheHead;
+        while (threadCache)
+        {
+            ThreadCache *next = threadCache->m_nextCache;
+            munmap(threadCache, THREAD_CACHE_BYTES);
+            threadCache = next;
+        }
+    }
+
+    pthread_key_t CentralCache::sharedThreadCacheKey()
+    {
+        // 进程只有PTHREAD_KEYS_MAX个key 与其他库共用 每个堆各自创建key时数量会受限
+        struct SharedKey
+        {
+            pthread_key_t key;
+            int error;
+        };
+        static const SharedKey sharedKey = []() {
+            SharedKey result;
+            result.error = pthread_key_create(&result.key, CentralCache::onThreadExit);
+            return result;
+        }();
+
+        if (sharedKey.error != 0)
+            throw std::system_error(sharedKey.error, std::generic_category(), "pthread_key_create");
+        return sharedKey.key;
+    }
+
+    CentralCache *CentralCache::findCentral(uint64_t id)
+    {
+        for (CentralCache *centralCache = s_centralHead; centralCache; centralCache = centralCache->m_nextCentral)
+        {
+            if (centralCache->m_id == id)
+                return centralCache;
+        }
+        return nullptr;
+    }
+
+    void CentralCache::onThreadExit(void *ptr)
+    {
+        /**
+         * 线程退出时归还线程缓存
+         * 整体流程:
+         * 持有中心缓存链表的锁 期间中心缓存不会析构;
+         * 表项对应的中心缓存仍然存活时注销线程缓存 已经析构的中心缓存已经释放了线程缓存 直接跳过;
+         * 释放线程缓存表;
+         */
+        ThreadCacheTable *table = static_cast<ThreadCacheTable *>(ptr);
+
+        lockCentralList(s_centralLock);
+        for (size_t i = 0; i < table->size; ++i)
+        {
+            CentralCache *centralCache = CentralCache::findCentral(table->slots[i].centralId);
+            if (centralCache)
+                centralCache->releaseThreadCache(table->slots[i].threadCache);
+        }
+        s_centralLock.clear(std::memory_order_release);
+
+        munmap(table, table->bytes);
+    }
+
+    void CentralCache::releaseThreadCache(ThreadCache *threadCache)
+    {
+        this->unregisterThreadCache(threadCache);
+
+        // 由中心缓存创建的线程缓存 空闲内存块归还之后释放线程缓存本身所在的内存页
+        if (this->m_ownsThreadCaches)
+        {
+            threadCache->returnAllToCentralCache();
+            munmap(threadCache, THREAD_CACHE_BYTES);
+        }
+    }
+
+    void CentralCache::bindThreadCache(ThreadCache *threadCache)
+    {
+        ThreadCacheTable *table = static_cast<ThreadCacheTable *>(pthread_getspecific(this->m_threadCacheKey));
+        if (table && table->size == table->capacity)
+        {
+            // 已经析构的中心缓存留下的表项不会再被查找 先回收这些位置
+            size_t size = 0;
+            lockCentralList(s_centralLock);
+            for (size_t i = 0; i < table->size; ++i)
+            {
+                if (CentralCache::findCentral(table->slots[i].centralId))
+                    table->slots[size++] = table->slots[i];
+            }
+            s_centralLock.clear(std::memory_order_release);
+            table->size = size;
+        }
+
+        if (!table || table->size == table->capacity)
+        {
+            // 第一次使用一个内存页 之后每次扩容一倍
+            size_t bytes = table ? table->bytes * 2 : PAGE_SIZE;
+            void *addr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (addr == MAP_FAILED)
+                throw std::bad_alloc();
+
+            ThreadCacheTable *newTable = static_cast<ThreadCacheTable *>(addr);
+            newTable->bytes = bytes;
+            newTable->size = 0;
+            newTable->capacity = (bytes - offsetof(ThreadCacheTable, slots)) / sizeof(ThreadCacheTable::Slot);
+            if (table)
+            {
+                std::copy(table->slots, table->slots + table->size, newTable->slots);
+                newTable->size = table->size;
+                munmap(table, table->bytes);
+            }
+            table = newTable;
+            pthread_setspecific(this->m_threadCacheKey, table);
+        }
+
+        table->slots[table->size++] = {this->m_id, threadCache};
+    }
+
+    ThreadCache *CentralCache::createThreadCache()
+    {
+        assert(this->m_ownsThreadCaches);
+
+        // 线程缓存不放在页面缓存中 堆整体释放之后继续使用 不需要每次重新创建和清零
+        void *addr = mmap(nullptr, THREAD_CACHE_BYTES, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (addr == MAP_FAILED)
+            throw std::bad_alloc();
+
+        // 构造时登记到中心缓存 同时写入当前线程的线程缓存表
+        return new (addr) ThreadCache(this);
+    }
+
+    void *CentralCache::allocateCounterPage()
+    {
+        while (this->m_threadCacheLock.test_and_set(std::memory_order_acquire))
+        {
+            std::this_thread::yield();
+        }
+        void *page = this->m_freeCounterPages;
+        if (page)
+            this->m_freeCounterPages = *reinterpret_cast<void **>(page);
+        this->m_threadCacheLock.clear(std::memory_order_release);
+
+        if (!page)
+            page = this->m_pageCache->allocateSpanPage(1);
+        if (!page)
+            throw std::bad_alloc();
+        return page;
+    }
+
+    void CentralCache::reset()
+    {
+        /**
+         * 丢弃所有空闲内存块
+         * 整体流程:
+         * 按照位图找到使用过的内存块大小 清空中心缓存以及每个线程缓存中对应的链表和统计计数;
+         * 线程缓存的计数组和已经退出的线程留下的计数组内存页都在页面缓存中 丢弃之后重新申请;
+         * 线程缓存和pthread_key保留 之后各线程直接继续使用;
+         */
+        assert(this->m_ownsThreadCaches);
+
+        for (size_t w = 0; w < this->m_usedClasses.size(); ++w)
         {
-            void *curNode = this->m_freeList[i];
-            size_t count = 0;
-            while (curNode)
+            uint64_t bits = this->m_usedClasses[w].exchange(0, std::memory_order_relaxed);
+            while (bits)
             {
-                curNode = *reinterpret_cast<void **>(curNode);
-                ++count;
+                size_t index = w * 64 + __builtin_ctzll(bits);
+                bits &= bits - 1;
+
+                this->clearSizeClass(index);
+                for (ThreadCache *threadCache = this->m_threadCacheHead; threadCache; threadCache = threadCache->m_nextCache)
+                {
+                    threadCache->m_freeList[index] = nullptr;
+                    threadCache->m_freeListSize[index] = 0;
+                    threadCache->m_keepNums[index] = 0;
+                }
             }
-            arr[i] = count;
         }
-        for (int i = 0; i < 8; i++)
+
+        for (ThreadCache *threadCache = this->m_threadCacheHead; threadCache; threadCache = threadCache->m_nextCache)
         {
-            std::cout << std::setw(5) << std::left << arr[i] << " ";
+            for (auto &group : threadCache->m_counterGroups)
+                group.store(nullptr, std::memory_order_relaxed);
+            threadCache->m_cachedBytes = 0;
+            threadCache->m_cachedClasses.fill(0);
         }
-        std::cout << std::endl;
+        this->m_freeCounterPages = nullptr;
     }
 
-    std::pair<void *, size_t> CentralCache::fetchRange(size_t index)
+    void CentralCache::clearFreeLists()
+    {
+        for (size_t i = 0; i < FREE_LIST_SIZE; ++i)
+        {
+            this->clearSizeClass(i);
+            this->m_freeListLock[i].clear();
+        }
+
+        for (auto &used : this->m_usedClasses)
+        {
+            used.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void CentralCache::clearSizeClass(size_t index)
+    {
+        this->m_freeList[index].store(nullptr, std::memory_order_relaxed);
+        this->m_freeListSize[index].store(0, std::memory_order_relaxed);
+
+        ClassCounter &counter = this->m_classCounter[index];
+        counter.fetchNums.store(0, std::memory_order_relaxed);
+        counter.fetchBlocks.store(0, std::memory_order_relaxed);
+        counter.returnNums.store(0, std::memory_order_relaxed);
+        counter.returnBlocks.store(0, std::memory_order_relaxed);
+        counter.exitAllocNums.store(0, std::memory_order_relaxed);
+        counter.exitFreeNums.store(0, std::memory_order_relaxed);
+        counter.spanNums.store(0, std::memory_order_relaxed);
+        counter.spanWasteBytes.store(0, std::memory_order_relaxed);
+    }
+
+    std::pair<void *, size_t> CentralCache::fetchRange(size_t index, bool isRefill)
     {
         /**
          * 从中心缓存申请内存块
@@ -53,8 +341,9 @@ namespace memory_pool
 
         void *headNode = this->m_freeList[index].load(std::memory_order_acquire);
         size_t fetchNums = this->getBatchNum(index);
-
-        // this->printListSize();
+        ClassCounter &counter = this->m_classCounter[index];
+        if (isRefill)
+            counter.fetchNums.fetch_add(1, std::memory_order_relaxed);
 
         // 中心缓存中存在空闲内存块
         if (headNode)
@@ -67,6 +356,7 @@ namespace memory_pool
                 void *returnNode = this->m_freeList[index].load(std::memory_order_release);
                 this->m_freeList[index].store(nullptr, std::memory_order_relaxed);
                 this->m_freeListSize[index].store(0, std::memory_order_relaxed);
+                counter.fetchBlocks.fetch_add(returnNums, std::memory_order_relaxed);
 
                 this->m_freeListLock[index].clear();
                 return std::make_pair(returnNode, returnNums);
@@ -79,7 +369,7 @@ namespace memory_pool
                 void *curNode = this->m_freeList[index].load(std::memory_order_acquire);
 
 
-                for(size_t i = 0; i<=returnNums -2; ++i)
+                for(size_t i = 0; i + 1 < returnNums; ++i)
                 {
                     curNode = *reinterpret_cast<void**>(curNode);
                 }
@@ -87,6 +377,7 @@ namespace memory_pool
                 *reinterpret_cast<void **>(curNode) = nullptr;
                 this->m_freeList[index].store(splitNode, std::memory_order_release);
                 this->m_freeListSize[index].fetch_sub(fetchNums, std::memory_order_release);
+                counter.fetchBlocks.fetch_add(returnNums, std::memory_order_relaxed);
 
                 this->m_freeListLock[index].clear();
                 return std::make_pair(returnNode, returnNums);
@@ -96,7 +387,7 @@ namespace memory_pool
         // 如果中心缓存中没有内存块 则需要从页面缓存中申请内存页
         // 这里申请的内存页是一大块内存页 还没有进行分割
         size_t blockSize = SizeClass::getBlockSize(index);
-        std::pair<void *, size_t> retPair = this->fetchFromPageCache(blockSize);
+        std::pair<void *, size_t> retPair = this->fetchFromPageCache(index);
         void *addr = retPair.first;       // 申请的内存页首地址
         size_t pageNums = retPair.second; // 申请的内存页数量
 
@@ -106,6 +397,9 @@ namespace memory_pool
         if (blockNums <= 1)
         {
             // 只有一个构不成链表 直接返回即可
+            // 内存页可能是页面缓存回收后复用的 需要把next指针清空
+            *reinterpret_cast<void **>(addr) = nullptr;
+            counter.fetchBlocks.fetch_add(blockNums, std::memory_order_relaxed);
             this->m_freeListLock[index].clear();
             return std::make_pair(addr, blockNums);
         }
@@ -122,6 +416,7 @@ namespace memory_pool
                 curNode = nextNode;
             }
             *reinterpret_cast<void **>(curNode) = nullptr;
+            counter.fetchBlocks.fetch_add(blockNums, std::memory_order_relaxed);
 
             this->m_freeListLock[index].clear();
             return std::make_pair(returnNode, blockNums);
@@ -133,7 +428,7 @@ namespace memory_pool
             // 先分割需要返回的这一段链表
             void *returnNode = addr;
             void *curNode = addr;
-            for (size_t i = 0; i <= fetchNums - 2; ++i)
+            for (size_t i = 0; i + 1 < fetchNums; ++i)
             {
                 void *nextNode = reinterpret_cast<void *>(reinterpret_cast<size_t>(curNode) + blockSize);
                 *reinterpret_cast<void **>(curNode) = nextNode;
@@ -153,10 +448,7 @@ namespace memory_pool
             *reinterpret_cast<void **>(curNode) = nullptr;
             this->m_freeList[index].store(splitNode, std::memory_order_release);
             this->m_freeListSize[index].fetch_add((blockNums - fetchNums), std::memory_order_release);
-
-            
-            // std::cout << std::endl << "fetch from PageCache: " << std::endl;
-            // this->printListSize();
+            counter.fetchBlocks.fetch_add(fetchNums, std::memory_order_relaxed);
 
             this->m_freeListLock[index].clear();
             return std::make_pair(returnNode, fetchNums);
@@ -185,7 +477,8 @@ namespace memory_pool
 
         void *curNode = ptr;
         // 找了很久的bug 最后发现是在for循环中(i <= blockNums - 2)没有加上等号
-        for (size_t i = 0; i <= blockNums - 2; ++i)
+        // 写成i + 1 < blockNums 只归还一个内存块时blockNums - 2不会下溢
+        for (size_t i = 0; i + 1 < blockNums; ++i)
         {
             curNode = *(reinterpret_cast<void **>(curNode));
         }
@@ -193,22 +486,166 @@ namespace memory_pool
         *reinterpret_cast<void **>(curNode) = oldHead;
         this->m_freeList[index].store(ptr, std::memory_order_release);
         this->m_freeListSize[index].fetch_add(blockNums, std::memory_order_release);
+        this->m_classCounter[index].returnNums.fetch_add(1, std::memory_order_relaxed);
+        this->m_classCounter[index].returnBlocks.fetch_add(blockNums, std::memory_order_relaxed);
 
         this->m_freeListLock[index].clear();
     }
 
-    std::pair<void *, size_t> CentralCache::fetchFromPageCache(size_t size)
+    void CentralCache::registerThreadCache(ThreadCache *threadCache)
     {
-        assert(size > 0);
+        assert(threadCache != nullptr);
+
+        while (this->m_threadCacheLock.test_and_set(std::memory_order_acquire))
+        {
+            std::this_thread::yield();
+        }
+
+        threadCache->m_prevCache = nullptr;
+        threadCache->m_nextCache = this->m_threadCacheHead;
+        if (this->m_threadCacheHead)
+            this->m_threadCacheHead->m_prevCache = threadCache;
+        this->m_threadCacheHead = threadCache;
 
-        size_t pageNums = (size - 1 + PAGE_SIZE) / PAGE_SIZE;
-        // 如果申请的大小小于固定的4页内存 则申请固定的内存页
-        if (pageNums <= SPAN_PAGE)
-            return std::make_pair(PageCache::Instance()->allocateSpanPage(SPAN_PAGE), SPAN_PAGE);
+        this->m_threadCacheLock.clear(std::memory_order_release);
+
+        this->bindThreadCache(threadCache);
+    }
 
-        // 如果申请的内存页数量大于4页 则申请对应的内存页数量
+    void CentralCache::unregisterThreadCache(ThreadCache *threadCache)
+    {
+        /**
+         * 注销线程缓存
+         * 整体流程:
+         * 将线程的申请释放计数累加到中心缓存 保证线程退出之后统计信息不丢失;
+         * 计数组所在的内存页放入空闲链表 线程之后的计数写入丢弃的计数组;
+         * 从线程缓存链表中摘除;
+         */
+        assert(threadCache != nullptr);
+
+        while (this->m_threadCacheLock.test_and_set(std::memory_order_acquire))
+        {
+            std::this_thread::yield();
+        }
+
+        for (size_t g = 0; g < ThreadCache::COUNTER_GROUP_NUMS; ++g)
+        {
+            ThreadCache::CounterGroup *group = threadCache->m_counterGroups[g].exchange(ThreadCache::discardCounterGroup(), std::memory_order_relaxed);
+            if (!group || group == ThreadCache::discardCounterGroup())
+                continue;
+            for (size_t j = 0; j < ThreadCache::COUNTER_GROUP_SIZE; ++j)
+            {
+                size_t i = g * ThreadCache::COUNTER_GROUP_SIZE + j;
+                size_t allocNums = group->allocNums[j].load(std::memory_order_relaxed);
+                size_t freeNums = group->freeNums[j].load(std::memory_order_relaxed);
+                if (allocNums)
+                    this->m_classCounter[i].exitAllocNums.fetch_add(allocNums, std::memory_order_relaxed);
+                if (freeNums)
+                    this->m_classCounter[i].exitFreeNums.fetch_add(freeNums, std::memory_order_relaxed);
+            }
+
+            // 计数组所在的内存页留给之后创建的线程缓存 线程退出时不调用页面缓存
+            *reinterpret_cast<void **>(group) = this->m_freeCounterPages;
+            this->m_freeCounterPages = group;
+        }
+
+        if (threadCache->m_prevCache)
+            threadCache->m_prevCache->m_nextCache = threadCache->m_nextCache;
         else
-            return std::make_pair(PageCache::Instance()->allocateSpanPage(pageNums), pageNums);
+            this->m_threadCacheHead = threadCache->m_nextCache;
+        if (threadCache->m_nextCache)
+            threadCache->m_nextCache->m_prevCache = threadCache->m_prevCache;
+        threadCache->m_prevCache = threadCache->m_nextCache = nullptr;
+
+        this->m_threadCacheLock.clear(std::memory_order_release);
+    }
+
+    std::vector<SizeClassStats> CentralCache::getSizeClassStats()
+    {
+        /**
+         * 汇总统计信息
+         * 整体流程:
+         * 累加所有存活线程缓存以及已经退出线程的申请释放次数;
+         * 线程缓存中空闲的内存块 = 批量申请得到的 - 归还的 - 正在使用的;
+         * 只保留有过申请或者缓存有内存块的内存块大小;
+         */
+        std::vector<size_t> allocNums(FREE_LIST_SIZE, 0);
+        std::vector<size_t> freeNums(FREE_LIST_SIZE, 0);
+
+        while (this->m_threadCacheLock.test_and_set(std::memory_order_acquire))
+        {
+            std::this_thread::yield();
+        }
+        for (ThreadCache *cache = this->m_threadCacheHead; cache; cache = cache->m_nextCache)
+        {
+            // 只有线程使用过的组才有计数
+            for (size_t g = 0; g < ThreadCache::COUNTER_GROUP_NUMS; ++g)
+            {
+                ThreadCache::CounterGroup *group = cache->m_counterGroups[g].load(std::memory_order_acquire);
+                if (!group)
+                    continue;
+                for (size_t j = 0; j < ThreadCache::COUNTER_GROUP_SIZE; ++j)
+                {
+                    allocNums[g * ThreadCache::COUNTER_GROUP_SIZE + j] += group->allocNums[j].load(std::memory_order_relaxed);
+                    freeNums[g * ThreadCache::COUNTER_GROUP_SIZE + j] += group->freeNums[j].load(std::memory_order_relaxed);
+                }
+            }
+        }
+        for (size_t i = 0; i < FREE_LIST_SIZE; ++i)
+        {
+            allocNums[i] += this->m_classCounter[i].exitAllocNums.load(std::memory_order_relaxed);
+            freeNums[i] += this->m_classCounter[i].exitFreeNums.load(std::memory_order_relaxed);
+        }
+        this->m_threadCacheLock.clear(std::memory_order_release);
+
+        std::vector<SizeClassStats> result;
+        for (size_t i = 0; i < FREE_LIST_SIZE; ++i)
+        {
+            const ClassCounter &counter = this->m_classCounter[i];
+            SizeClassStats stats;
+            stats.index = i;
+            stats.blockSize = SizeClass::getBlockSize(i);
+            stats.allocNums = allocNums[i];
+            stats.freeNums = freeNums[i];
+            stats.refillNums = counter.fetchNums.load(std::memory_order_relaxed);
+            stats.refillBlocks = counter.fetchBlocks.load(std::memory_order_relaxed);
+            stats.returnNums = counter.returnNums.load(std::memory_order_relaxed);
+            stats.returnBlocks = counter.returnBlocks.load(std::memory_order_relaxed);
+            stats.centralCachedBytes = this->m_freeListSize[i].load(std::memory_order_relaxed) * stats.blockSize;
+            stats.spanPages = getSpanPages(i);
+            stats.spanNums = counter.spanNums.load(std::memory_order_relaxed);
+            stats.spanWasteBytes = counter.spanWasteBytes.load(std::memory_order_relaxed);
+
+            if (stats.allocNums == 0 && stats.refillBlocks == 0)
+                continue;
+
+            // 各项计数不是同时读取的 运行中可能出现短暂的不一致 这里避免出现负数
+            stats.cacheHits = stats.allocNums > stats.refillNums ? stats.allocNums - stats.refillNums : 0;
+            size_t ownedBlocks = stats.refillBlocks > stats.returnBlocks ? stats.refillBlocks - stats.returnBlocks : 0;
+            size_t usedBlocks = stats.allocNums > stats.freeNums ? stats.allocNums - stats.freeNums : 0;
+            stats.threadCachedBytes = ownedBlocks > usedBlocks ? (ownedBlocks - usedBlocks) * stats.blockSize : 0;
+
+            result.push_back(stats);
+        }
+        return result;
+    }
+
+    std::pair<void *, size_t> CentralCache::fetchFromPageCache(size_t index)
+    {
+        assert(index < FREE_LIST_SIZE);
+
+        // 内存页数量按照内存块大小预先计算 尾部无法切分的部分不超过1/8
+        size_t pageNums = getSpanPages(index);
+        ClassCounter &counter = this->m_classCounter[index];
+        counter.spanNums.fetch_add(1, std::memory_order_relaxed);
+
+        // 已经记录过时只读 不争用同一个缓存行
+        uint64_t mask = uint64_t(1) << (index % 64);
+        std::atomic<uint64_t> &used = this->m_usedClasses[index / 64];
+        if (!(used.load(std::memory_order_relaxed) & mask))
+            used.fetch_or(mask, std::memory_order_relaxed);
+        counter.spanWasteBytes.fetch_add(pageNums * PAGE_SIZE % SizeClass::getBlockSize(index), std::memory_order_relaxed);
+        return std::make_pair(this->m_pageCache->allocateSpanPage(pageNums), pageNums);
     }
 
     size_t CentralCache::getBatchNum(size_t index)
@@ -218,23 +655,24 @@ namespace memory_pool
          */
         assert(index >= 0 && index < FREE_LIST_SIZE);
 
-        size_t batchNums = 0;
+        // 最小的内存块批量获取MEMPOOL_BATCH_BLOCKS个 默认64 内存块大小每翻一倍批量减半 至少为1
+        size_t shift = 0;
         if (index <= 3)
-            batchNums = 64;
+            shift = 0;
         else if (index <= 7)
-            batchNums = 32;
+            shift = 1;
         else if (index <= 15)
-            batchNums = 16;
+            shift = 2;
         else if (index <= 31)
-            batchNums = 8;
+            shift = 3;
         else if (index <= 63)
-            batchNums = 4;
+            shift = 4;
         else if (index <= 127)
-            batchNums = 2;
+            shift = 5;
         else
-            batchNums = 1;
+            shift = 6;
 
-        return batchNums;
+        return std::max(Config::Instance()->getBatchBlocks() >> shift, size_t(1));
     }
 
 }
@@ -0,0 +1,79 @@
+#include "Config.h"
+#include <cstdlib>
+
+namespace memory_pool
+{
+
+    namespace
+    {
+        /// @brief 读取环境变量中的数值 支持K/M/G后缀 没有设置或者格式错误时返回默认值
+        /// 不使用std::string 作为malloc替换库时在第一次申请内存时调用
+        size_t readEnv(const char *name, size_t defaultValue)
+        {
+            const char *value = getenv(name);
+            if (!value || !*value)
+                return defaultValue;
+
+            char *end = nullptr;
+            unsigned long long number = strtoull(value, &end, 10);
+            if (end == value)
+                return defaultValue;
+
+            switch (*end)
+            {
+            case 'k': case 'K': number <<= 10; ++end; break;
+            case 'm': case 'M': number <<= 20; ++end; break;
+            case 'g': case 'G': number <<= 30; ++end; break;
+            default: break;
+            }
+            if (*end != '\0')
+                return defaultValue;
+            return static_cast<size_t>(number);
+        }
+    }
+
+    Config::Config()
+    {
+        this->reset();
+        this->setThreadCacheMaxBlocks(readEnv("MEMPOOL_TC_MAX_BLOCKS", DEFAULT_TC_MAX_BLOCKS));
+        this->setThreadCacheMaxBytes(readEnv("MEMPOOL_TC_MAX_BYTES", 0));
+        this->setBatchBlocks(readEnv("MEMPOOL_BATCH_BLOCKS", DEFAULT_BATCH_BLOCKS));
+        this->setSpanPages(readEnv("MEMPOOL_SPAN_PAGES", SPAN_PAGE));
+        this->setReleaseRate(readEnv("MEMPOOL_RELEASE_RATE", DEFAULT_RELEASE_RATE));
+    }
+
+    void Config::setThreadCacheMaxBlocks(size_t blockNums)
+    {
+        this->m_threadCacheMaxBlocks.store(std::max(blockNums, size_t(1)), std::memory_order_relaxed);
+    }
+
+    void Config::setThreadCacheMaxBytes(size_t bytes)
+    {
+        this->m_threadCacheMaxBytes.store(bytes, std::memory_order_relaxed);
+    }
+
+    void Config::setBatchBlocks(size_t blockNums)
+    {
+        this->m_batchBlocks.store(std::max(blockNums, size_t(1)), std::memory_order_relaxed);
+    }
+
+    void Config::setSpanPages(size_t pageNums)
+    {
+        this->m_spanPages.store(std::min(std::max(pageNums, size_t(1)), MAX_SPAN_PAGE), std::memory_order_relaxed);
+    }
+
+    void Config::setReleaseRate(size_t percent)
+    {
+        this->m_releaseRate.store(std::min(std::max(percent, size_t(1)), size_t(100)), std::memory_order_relaxed);
+    }
+
+    void Config::reset()
+    {
+        this->m_threadCacheMaxBlocks.store(DEFAULT_TC_MAX_BLOCKS, std::memory_order_relaxed);
+        this->m_threadCacheMaxBytes.store(0, std::memory_order_relaxed);
+        this->m_batchBlocks.store(DEFAULT_BATCH_BLOCKS, std::memory_order_relaxed);
+        this->m_spanPages.store(SPAN_PAGE, std::memory_order_relaxed);
+        this->m_releaseRate.store(DEFAULT_RELEASE_RATE, std::memory_order_relaxed);
+    }
+
+}
@@ -0,0 +1,36 @@
+#include "Heap.h"
+
+namespace memory_pool
+{
+
+    Heap::Heap() : m_pageCache(true), m_centralCache(new CentralCache(&m_pageCache, true))
+    {
+    }
+
+    Heap::~Heap()
+    {
+        // 中心缓存析构时释放线程缓存 需要在页面缓存之前
+        delete this->m_centralCache;
+    }
+
+    void Heap::destroy()
+    {
+        /**
+         * 整体释放堆中的内存
+         * 整体流程:
+         * 中心缓存清空使用过的内存块大小的链表 包括各线程缓存中的链表 线程缓存本身保留;
+         * 页面缓存munmap所有内存页以及直接映射的超大内存 地址相邻的合并成一次munmap;
+         */
+        this->m_centralCache->reset();
+        this->m_pageCache.releaseAll();
+    }
+
+    PoolStats Heap::getStats()
+    {
+        PoolStats stats;
+        stats.sizeClasses = this->m_centralCache->getSizeClassStats();
+        stats.pageCache = this->m_pageCache.getStats();
+        return stats;
+    }
+
+}
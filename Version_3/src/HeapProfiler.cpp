@@ -0,0 +1,221 @@
+#include "HeapProfiler.h"
+#include <execinfo.h>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+
+namespace memory_pool
+{
+
+    namespace
+    {
+        // 每个线程独立的随机数状态 只在采样慢路径上使用
+        thread_local uint64_t t_randomState = 0;
+
+        uint64_t nextRandom()
+        {
+            if (t_randomState == 0)
+            {
+                t_randomState = reinterpret_cast<uint64_t>(&t_randomState) ^
+                                static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count()) ^
+                                0x2545F4914F6CDD1Dull;
+            }
+            // xorshift64*
+            t_randomState ^= t_randomState >> 12;
+            t_randomState ^= t_randomState << 25;
+            t_randomState ^= t_randomState >> 27;
+            return t_randomState * 0x2545F4914F6CDD1Dull;
+        }
+
+        uint64_t hashStack(void *const *stack, int depth)
+        {
+            uint64_t hash = 14695981039346656037ull;
+            for (int i = 0; i < depth; ++i)
+            {
+                hash ^= reinterpret_cast<uint64_t>(stack[i]);
+                hash *= 1099511628211ull;
+            }
+            return hash;
+        }
+    }
+
+    void HeapProfiler::start(size_t sampleBytes)
+    {
+        assert(sampleBytes > 0);
+
+        // backtrace第一次调用时会加载libgcc_s 提前在内存池外部完成
+        void *stack[1];
+        backtrace(stack, 1);
+
+        this->m_samplePeriod.store(sampleBytes, std::memory_order_relaxed);
+        this->m_sampleBytes.store(sampleBytes, std::memory_order_relaxed);
+    }
+
+    void HeapProfiler::stop()
+    {
+        this->m_sampleBytes.store(0, std::memory_order_relaxed);
+    }
+
+    ptrdiff_t HeapProfiler::nextSampleBytes()
+    {
+        /**
+         * 计算下一次采样间隔
+         * 采样点服从平均间隔为sampleBytes的泊松过程 相邻两次采样之间的字节数服从指数分布
+         * 这样每个字节被采样的概率相同 大的申请更容易被采样 不会和固定的申请模式产生共振
+         */
+        size_t sampleBytes = this->m_sampleBytes.load(std::memory_order_relaxed);
+        if (sampleBytes == 0)
+            return RECHECK_BYTES;
+
+        // 取53位得到(0, 1)之间的均匀分布
+        double u = (static_cast<double>(nextRandom() >> 11) + 1.0) / 9007199254740993.0;
+        double interval = -std::log(u) * static_cast<double>(sampleBytes);
+        if (interval > static_cast<double>(PTRDIFF_MAX / 2))
+            interval = static_cast<double>(PTRDIFF_MAX / 2);
+        return static_cast<ptrdiff_t>(interval) + 1;
+    }
+
+    void HeapProfiler::recordAllocation(void *ptr, size_t size, size_t blockSize)
+    {
+        /**
+         * 记录一次采样
+         * 整体流程:
+         * 采样停止之后不再记录;
+         * 获取调用栈 跳过采样自身的两层;
+         * 放入存活采样表以及按照调用栈累计的表 更新释放路径使用的过滤表;
+         */
+        if (!ptr || !this->isRunning())
+            return;
+
+        Sample sample;
+        sample.ptr = ptr;
+        sample.size = size;
+        sample.blockSize = blockSize;
+        sample.timestamp = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                               std::chrono::steady_clock::now().time_since_epoch()).count());
+
+        void *stack[MAX_STACK_DEPTH + 2];
+        int depth = backtrace(stack, MAX_STACK_DEPTH + 2);
+        int skip = depth > 2 ? 2 : 0;
+        sample.depth = depth - skip;
+        std::copy(stack + skip, stack + depth, sample.stack);
+
+        uint64_t stackHash = hashStack(sample.stack, sample.depth);
+
+        std::lock_guard<std::mutex> lock(this->m_sampleMutex);
+
+        auto [it, inserted] = this->m_stackRecords.try_emplace(stackHash);
+        StackRecord &record = it->second;
+        if (inserted)
+        {
+            record.depth = sample.depth;
+            std::copy(sample.stack, sample.stack + sample.depth, record.stack);
+            record.allocNums = 0;
+            record.allocBytes = 0;
+        }
+        record.allocNums++;
+        record.allocBytes += size;
+
+        this->m_liveSamples[ptr] = sample;
+        this->m_sampleFilter[filterIndex(ptr)].fetch_add(1, std::memory_order_relaxed);
+        s_liveSampleNums.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void HeapProfiler::recordDeallocation(void *ptr)
+    {
+        std::lock_guard<std::mutex> lock(this->m_sampleMutex);
+
+        auto it = this->m_liveSamples.find(ptr);
+        if (it == this->m_liveSamples.end())
+            return;
+
+        this->m_liveSamples.erase(it);
+        this->m_sampleFilter[filterIndex(ptr)].fetch_sub(1, std::memory_order_relaxed);
+        s_liveSampleNums.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    std::vector<HeapProfiler::Sample> HeapProfiler::getLiveSamples()
+    {
+        std::lock_guard<std::mutex> lock(this->m_sampleMutex);
+
+        std::vector<Sample> samples;
+        samples.reserve(this->m_liveSamples.size());
+        for (auto &[ptr, sample] : this->m_liveSamples)
+            samples.push_back(sample);
+        return samples;
+    }
+
+    void HeapProfiler::dump(std::ostream &os)
+    {
+        /**
+         * 输出heap profile
+         * 第一行为总量 之后每行一个调用栈: 存活数量: 存活字节 [累计数量: 累计字节] @ 调用栈地址
+         * heap_v2/采样间隔 让pprof按照采样概率还原真实的数量
+         * 最后附上/proc/self/maps 供pprof符号化
+         */
+        struct StackTotal
+        {
+            size_t liveNums = 0;
+            size_t liveBytes = 0;
+        };
+
+        std::unordered_map<uint64_t, StackTotal> liveTotals;
+        std::vector<std::pair<uint64_t, StackRecord>> records;
+        size_t samplePeriod = this->m_samplePeriod.load(std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(this->m_sampleMutex);
+            for (auto &[ptr, sample] : this->m_liveSamples)
+            {
+                StackTotal &total = liveTotals[hashStack(sample.stack, sample.depth)];
+                total.liveNums++;
+                total.liveBytes += sample.size;
+            }
+            records.assign(this->m_stackRecords.begin(), this->m_stackRecords.end());
+        }
+
+        StackTotal liveSum;
+        size_t allocNums = 0;
+        size_t allocBytes = 0;
+        for (auto &[hash, total] : liveTotals)
+        {
+            liveSum.liveNums += total.liveNums;
+            liveSum.liveBytes += total.liveBytes;
+        }
+        for (auto &[hash, record] : records)
+        {
+            allocNums += record.allocNums;
+            allocBytes += record.allocBytes;
+        }
+
+        os << "heap profile: " << liveSum.liveNums << ": " << liveSum.liveBytes
+           << " [" << allocNums << ": " << allocBytes << "] @ heap_v2/" << (samplePeriod ? samplePeriod : 1) << "\n";
+
+        for (auto &[hash, record] : records)
+        {
+            StackTotal total;
+            auto it = liveTotals.find(hash);
+            if (it != liveTotals.end())
+                total = it->second;
+
+            os << total.liveNums << ": " << total.liveBytes
+               << " [" << record.allocNums << ": " << record.allocBytes << "] @";
+            for (int i = 0; i < record.depth; ++i)
+                os << " " << record.stack[i];
+            os << "\n";
+        }
+
+        os << "\nMAPPED_LIBRARIES:\n";
+        std::ifstream maps("/proc/self/maps");
+        os << maps.rdbuf();
+    }
+
+    bool HeapProfiler::dumpToFile(const std::string &path)
+    {
+        std::ofstream file(path);
+        if (!file)
+            return false;
+        this->dump(file);
+        return static_cast<bool>(file);
+    }
+
+}
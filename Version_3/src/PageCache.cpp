@@ -39,19 +39,28 @@ namespace memory_pool
                 
                 // 放入到记录的unordered_map当中
                 this->m_recordPageMap[newSpanPage->startAddr] = newSpanPage;    
+                this->m_spanSplitNums.fetch_add(1, std::memory_order_relaxed);
             }
             
             // 将原来的spanPage从链表中移除 只需要将头节点移除即可 因为spanPage本身就是头节点
             SpanPage* nextPage = spanPage->next;
             spanPage->next = nullptr;
-            this->m_freePageMap[_pageNums] = nextPage;
+            if(nextPage)
+                this->m_freePageMap[_pageNums] = nextPage;
+            else
+                this->m_freePageMap.erase(_pageNums);
 
+            // 分割剩余的部分仍然留在空闲链表中 空闲字节数只减少分配出去的部分
+            this->m_freeBytes.fetch_sub(pageNums * PAGE_SIZE, std::memory_order_relaxed);
             this->m_recordPageMap[spanPage->startAddr] = spanPage;
+            this->checkReserve(false);
             return spanPage->startAddr;
         }
 
         // 如果页面缓存中没有这么大小的内存页 则向系统申请
         void* retAddr = this->systemAlloc(pageNums);
+        this->m_systemAllocNums.fetch_add(1, std::memory_order_relaxed);
+        this->checkReserve(true);
         if(!retAddr)
             return nullptr;
         SpanPage* spanPage = new SpanPage;
@@ -63,6 +72,115 @@ namespace memory_pool
         return spanPage->startAddr;
     }
 
+    bool PageCache::reserveSpanPage(size_t pageNums, bool lockMemory)
+    {
+        /**
+         * 预留内存页
+         * 整体流程:
+         * 参数有效性判断;
+         * 通过MAP_POPULATE映射 映射时完成缺页 之后使用时不会再发生缺页;
+         * 需要时通过mlock锁定;
+         * 作为一整段空闲内存页放入空闲链表 之后的申请从中分割 不再调用systemAlloc;
+         */
+        assert(pageNums > 0);
+
+        void *addr = mmap(nullptr, pageNums * PAGE_SIZE, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+        if(addr == MAP_FAILED)
+            return false;
+        this->m_mmapNums.fetch_add(1, std::memory_order_relaxed);
+        this->m_committedBytes.fetch_add(pageNums * PAGE_SIZE, std::memory_order_relaxed);
+
+        bool locked = !lockMemory || mlock(addr, pageNums * PAGE_SIZE) == 0;
+
+        std::lock_guard<std::mutex> lock(this->m_pageMutex);
+        SpanPage* spanPage = new SpanPage(addr, pageNums);
+        this->m_recordPageMap[addr] = spanPage;
+        this->insertFreeSpanPage(spanPage);
+        return locked;
+    }
+
+    void PageCache::setReserveWatermark(size_t lowBytes, size_t highBytes)
+    {
+        assert(lowBytes <= highBytes);
+
+        this->m_reserveLowBytes.store(lowBytes, std::memory_order_relaxed);
+        this->m_reserveHighBytes.store(highBytes, std::memory_order_relaxed);
+        if(highBytes == 0)
+        {
+            this->stopReserveThread();
+            return;
+        }
+
+        // 设置之后立即补充到高水位
+        // 在创建线程之前设置 作为malloc替换库时创建线程内部的申请不会再次加锁唤醒
+        this->m_reserveWanted.store(true, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(this->m_reserveMutex);
+            if(!this->m_reserveThread.joinable())
+            {
+                this->m_reserveStop = false;
+                this->m_reserveThread = std::thread(&PageCache::reserveLoop, this);
+            }
+        }
+        this->m_reserveCond.notify_one();
+    }
+
+    void PageCache::wakeReserveThread()
+    {
+        // 后台线程补充完成之前只需要唤醒一次
+        if(this->m_reserveWanted.exchange(true, std::memory_order_relaxed))
+            return;
+        {
+            // 加锁保证后台线程检查条件和进入等待之间不会错过唤醒
+            std::lock_guard<std::mutex> lock(this->m_reserveMutex);
+        }
+        this->m_reserveCond.notify_one();
+    }
+
+    void PageCache::reserveLoop()
+    {
+        /**
+         * 后台预留内存页
+         * 整体流程:
+         * 等待唤醒或者停止;
+         * 不持有任何锁 通过reserveSpanPage映射并完成缺页 直到空闲字节数达到高水位;
+         * 映射失败时等待下一次唤醒;
+         */
+        std::unique_lock<std::mutex> lock(this->m_reserveMutex);
+        while(true)
+        {
+            this->m_reserveCond.wait(lock, [this]() {
+                return this->m_reserveStop || this->m_reserveWanted.load(std::memory_order_relaxed);
+            });
+            if(this->m_reserveStop)
+                break;
+            this->m_reserveWanted.store(false, std::memory_order_relaxed);
+            lock.unlock();
+
+            while(this->m_freeBytes.load(std::memory_order_relaxed) < this->m_reserveHighBytes.load(std::memory_order_relaxed))
+            {
+                if(!this->reserveSpanPage(RESERVE_SPAN_PAGE))
+                    break;
+                this->m_reserveNums.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            lock.lock();
+        }
+    }
+
+    void PageCache::stopReserveThread()
+    {
+        {
+            std::lock_guard<std::mutex> lock(this->m_reserveMutex);
+            if(!this->m_reserveThread.joinable())
+                return;
+            this->m_reserveStop = true;
+        }
+        this->m_reserveCond.notify_one();
+        this->m_reserveThread.join();
+    }
+
     void PageCache::deallocateSpanPage(void *ptr)
     {
         /**
@@ -78,58 +196,272 @@ namespace memory_pool
         std::lock_guard<std::mutex> lock(this->m_pageMutex);
 
         auto it = this->m_recordPageMap.find(ptr);
-        if(!it->first)
+        if(it == this->m_recordPageMap.end())
             return;
-        
-        void* addr = it->first;
+
+        this->insertFreeSpanPage(it->second);
+    }
+
+    void *PageCache::allocateAlignedSpanPage(size_t pageNums, size_t alignPages)
+    {
+        /**
+         * 申请对齐的内存页
+         * 整体流程:
+         * 参数有效性判断;
+         * 多申请alignPages-1个内存页 保证其中一定存在对齐的首地址;
+         * 对齐首地址前面的内存页和后面多余的内存页分割出来归还到空闲链表;
+         */
+        assert(pageNums > 0 && alignPages > 0 && (alignPages & (alignPages - 1)) == 0);
+
+        void *addr = this->allocateSpanPage(pageNums + alignPages - 1);
+        if(!addr)
+            return nullptr;
+
+        size_t alignBytes = alignPages * PAGE_SIZE;
+        size_t alignAddr = (reinterpret_cast<size_t>(addr) + alignBytes - 1) & ~(alignBytes - 1);
+        size_t headPages = (alignAddr - reinterpret_cast<size_t>(addr)) / PAGE_SIZE;
+
+        std::lock_guard<std::mutex> lock(this->m_pageMutex);
+
+        SpanPage* headSpanPage = this->m_recordPageMap[addr];
+        if(headPages == 0)
+        {
+            // 本身就已经对齐 只需要归还尾部
+            if(headSpanPage->pageNums > pageNums)
+            {
+                SpanPage* tailSpanPage = new SpanPage(reinterpret_cast<void*>(alignAddr + pageNums * PAGE_SIZE),
+                                                      headSpanPage->pageNums - pageNums);
+                headSpanPage->pageNums = pageNums;
+                this->m_recordPageMap[tailSpanPage->startAddr] = tailSpanPage;
+                this->m_spanSplitNums.fetch_add(1, std::memory_order_relaxed);
+                this->insertFreeSpanPage(tailSpanPage);
+            }
+            return addr;
+        }
+
+        // 对齐位置之后的部分作为新的内存页分配出去
+        SpanPage* alignSpanPage = new SpanPage(reinterpret_cast<void*>(alignAddr), headSpanPage->pageNums - headPages);
+        headSpanPage->pageNums = headPages;
+        this->m_recordPageMap[alignSpanPage->startAddr] = alignSpanPage;
+        this->m_spanSplitNums.fetch_add(1, std::memory_order_relaxed);
+
+        if(alignSpanPage->pageNums > pageNums)
+        {
+            SpanPage* tailSpanPage = new SpanPage(reinterpret_cast<void*>(alignAddr + pageNums * PAGE_SIZE),
+                                                  alignSpanPage->pageNums - pageNums);
+            alignSpanPage->pageNums = pageNums;
+            this->m_recordPageMap[tailSpanPage->startAddr] = tailSpanPage;
+            this->m_spanSplitNums.fetch_add(1, std::memory_order_relaxed);
+            this->insertFreeSpanPage(tailSpanPage);
+        }
+
+        // 头部放回空闲链表 右侧是正在使用的对齐内存页 不会发生合并
+        this->insertFreeSpanPage(headSpanPage);
+        return alignSpanPage->startAddr;
+    }
+
+    bool PageCache::resizeSpanPage(void *ptr, size_t pageNums)
+    {
+        /**
+         * 原地调整已经分配出去的内存页大小
+         * 整体流程:
+         * 参数有效性判断;
+         * 缩小: 将尾部多出来的内存页分割出来归还到空闲链表;
+         * 扩大: 右侧相邻的内存页空闲并且足够大时 从其头部截取需要的内存页合并进来;
+         * 右侧相邻内存页正在使用或者不够大时 返回false 由调用方重新申请并拷贝;
+         */
+        assert(ptr != nullptr && pageNums > 0);
+
+        std::lock_guard<std::mutex> lock(this->m_pageMutex);
+
+        auto it = this->m_recordPageMap.find(ptr);
+        if(it == this->m_recordPageMap.end())
+            return false;
+
         SpanPage* spanPage = it->second;
-        void* nextAddr = reinterpret_cast<void*>(reinterpret_cast<size_t>(addr) + spanPage->pageNums * PAGE_SIZE);
+        if(pageNums == spanPage->pageNums)
+            return true;
+
+        if(pageNums < spanPage->pageNums)
+        {
+            SpanPage* tailSpanPage = new SpanPage(reinterpret_cast<void*>(reinterpret_cast<size_t>(spanPage->startAddr) + pageNums * PAGE_SIZE),
+                                                  spanPage->pageNums - pageNums);
+            spanPage->pageNums = pageNums;
+            this->m_recordPageMap[tailSpanPage->startAddr] = tailSpanPage;
+            this->m_spanSplitNums.fetch_add(1, std::memory_order_relaxed);
+            this->insertFreeSpanPage(tailSpanPage);
+            return true;
+        }
 
+        void* nextAddr = reinterpret_cast<void*>(reinterpret_cast<size_t>(spanPage->startAddr) + spanPage->pageNums * PAGE_SIZE);
         auto nextIt = this->m_recordPageMap.find(nextAddr);
-        if(nextIt->first)
+        if(nextIt == this->m_recordPageMap.end())
+            return false;
+
+        SpanPage* nextSpanPage = nextIt->second;
+        size_t needPages = pageNums - spanPage->pageNums;
+        if(nextSpanPage->pageNums < needPages || !this->removeFreeSpanPage(nextSpanPage))
+            return false;
+
+        this->m_recordPageMap.erase(nextIt);
+        if(nextSpanPage->pageNums > needPages)
         {
-            // 如果找到了右侧相邻的内存页 需要查看其是否在链表上
-            SpanPage* nextSpanPage = nextIt->second;
+            // 右侧内存页剩余的部分继续留在空闲链表中
+            nextSpanPage->startAddr = reinterpret_cast<void*>(reinterpret_cast<size_t>(nextSpanPage->startAddr) + needPages * PAGE_SIZE);
+            nextSpanPage->pageNums -= needPages;
+            this->m_recordPageMap[nextSpanPage->startAddr] = nextSpanPage;
+            nextSpanPage->next = this->m_freePageMap[nextSpanPage->pageNums];
+            this->m_freePageMap[nextSpanPage->pageNums] = nextSpanPage;
+            this->m_freeBytes.fetch_add(nextSpanPage->pageNums * PAGE_SIZE, std::memory_order_relaxed);
+        }
+        else
+        {
+            delete nextSpanPage;
+        }
+
+        spanPage->pageNums = pageNums;
+        this->m_spanMergeNums.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    void *PageCache::allocateHugePage(size_t pageNums)
+    {
+        // 超大内存不经过页面缓存 直接向系统申请 mmap得到的内存本身就是0 不需要memset
+        assert(pageNums > 0);
+
+        void *addr = mmap(nullptr, pageNums * PAGE_SIZE, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(addr == MAP_FAILED)
+            return nullptr;
+        this->m_mmapNums.fetch_add(1, std::memory_order_relaxed);
+        this->m_committedBytes.fetch_add(pageNums * PAGE_SIZE, std::memory_order_relaxed);
+        if(this->m_trackHugePages)
+        {
+            std::lock_guard<std::mutex> lock(this->m_pageMutex);
+            this->m_hugePageMap[addr] = pageNums;
+        }
+        return addr;
+    }
+
+    void *PageCache::allocateAlignedHugePage(size_t pageNums, size_t alignPages)
+    {
+        assert(pageNums > 0 && alignPages > 0 && (alignPages & (alignPages - 1)) == 0);
+
+        size_t mapPages = pageNums + alignPages - 1;
+        void *addr = this->allocateHugePage(mapPages);
+        if(!addr)
+            return nullptr;
+
+        size_t alignBytes = alignPages * PAGE_SIZE;
+        size_t alignAddr = (reinterpret_cast<size_t>(addr) + alignBytes - 1) & ~(alignBytes - 1);
+        size_t headBytes = alignAddr - reinterpret_cast<size_t>(addr);
+        size_t tailBytes = (mapPages - pageNums) * PAGE_SIZE - headBytes;
+
+        // 多映射的头尾直接还给系统 剩下的部分与普通超大内存一样按照pageNums释放
+        if(headBytes)
+            munmap(addr, headBytes);
+        if(tailBytes)
+            munmap(reinterpret_cast<void*>(alignAddr + pageNums * PAGE_SIZE), tailBytes);
+        this->m_committedBytes.fetch_sub(headBytes + tailBytes, std::memory_order_relaxed);
+        this->m_releasedBytes.fetch_add(headBytes + tailBytes, std::memory_order_relaxed);
+        if(this->m_trackHugePages)
+        {
+            std::lock_guard<std::mutex> lock(this->m_pageMutex);
+            this->m_hugePageMap.erase(addr);
+            this->m_hugePageMap[reinterpret_cast<void*>(alignAddr)] = pageNums;
+        }
+        return reinterpret_cast<void*>(alignAddr);
+    }
+
+    void PageCache::deallocateHugePage(void *ptr, size_t pageNums)
+    {
+        assert(ptr != nullptr && pageNums > 0);
+        if(this->m_trackHugePages)
+        {
+            std::lock_guard<std::mutex> lock(this->m_pageMutex);
+            this->m_hugePageMap.erase(ptr);
+        }
+        munmap(ptr, pageNums * PAGE_SIZE);
+        this->m_committedBytes.fetch_sub(pageNums * PAGE_SIZE, std::memory_order_relaxed);
+        this->m_releasedBytes.fetch_add(pageNums * PAGE_SIZE, std::memory_order_relaxed);
+    }
+
+    void *PageCache::reallocateHugePage(void *ptr, size_t oldPageNums, size_t newPageNums)
+    {
+        // mremap由内核修改页表完成扩容 需要移动时也不会拷贝数据
+        assert(ptr != nullptr && oldPageNums > 0 && newPageNums > 0);
+
+        void *addr = mremap(ptr, oldPageNums * PAGE_SIZE, newPageNums * PAGE_SIZE, MREMAP_MAYMOVE);
+        if(addr == MAP_FAILED)
+            return nullptr;
 
-            bool isFound = false;
-            SpanPage* curNode = this->m_freePageMap[nextSpanPage->pageNums];
-            SpanPage* preNode = curNode;
-            while(curNode)
+        if(this->m_trackHugePages)
+        {
+            std::lock_guard<std::mutex> lock(this->m_pageMutex);
+            this->m_hugePageMap.erase(ptr);
+            this->m_hugePageMap[addr] = newPageNums;
+        }
+
+        if(newPageNums > oldPageNums)
+        {
+            this->m_committedBytes.fetch_add((newPageNums - oldPageNums) * PAGE_SIZE, std::memory_order_relaxed);
+        }
+        else
+        {
+            this->m_committedBytes.fetch_sub((oldPageNums - newPageNums) * PAGE_SIZE, std::memory_order_relaxed);
+            this->m_releasedBytes.fetch_add((oldPageNums - newPageNums) * PAGE_SIZE, std::memory_order_relaxed);
+        }
+        return addr;
+    }
+
+    bool PageCache::removeFreeSpanPage(SpanPage *spanPage)
+    {
+        auto listIt = this->m_freePageMap.find(spanPage->pageNums);
+        if(listIt == this->m_freePageMap.end())
+            return false;
+
+        SpanPage* preNode = nullptr;
+        SpanPage* curNode = listIt->second;
+        while(curNode)
+        {
+            if(curNode == spanPage)
             {
-                preNode = curNode;
-                curNode = curNode->next;
-                if(curNode == nextSpanPage)
-                {
-                    isFound = true;
+                if(preNode)
                     preNode->next = curNode->next;
-                    break;
-                }
+                else if(curNode->next)
+                    listIt->second = curNode->next;
+                else
+                    this->m_freePageMap.erase(listIt);
+                spanPage->next = nullptr;
+                this->m_freeBytes.fetch_sub(spanPage->pageNums * PAGE_SIZE, std::memory_order_relaxed);
+                return true;
             }
+            preNode = curNode;
+            curNode = curNode->next;
+        }
+        return false;
+    }
 
-            if(isFound)
-            {
-                // 消除掉m_recordPageMap中这两个内存页的记录 因为合并之后这俩就没有了 会产生新的内存页需要记录
-                this->m_recordPageMap.erase(spanPage->startAddr);
-                this->m_recordPageMap.erase(nextSpanPage->startAddr);
-
-                // 记录新的内存页 m_recordPageMap
-                spanPage->pageNums += nextSpanPage->pageNums;
-                this->m_recordPageMap[spanPage->startAddr] = spanPage;
-
-                // 新的内存页前插到链表中 m_freePageMap
-                SpanPage* oldHead = this->m_freePageMap[spanPage->pageNums];
-                spanPage->next = oldHead;
-                this->m_freePageMap[spanPage->pageNums] = spanPage->next;
-                return;
-            }
-            
+    void PageCache::insertFreeSpanPage(SpanPage *spanPage)
+    {
+        void* nextAddr = reinterpret_cast<void*>(reinterpret_cast<size_t>(spanPage->startAddr) + spanPage->pageNums * PAGE_SIZE);
+
+        auto nextIt = this->m_recordPageMap.find(nextAddr);
+        if(nextIt != this->m_recordPageMap.end() && this->removeFreeSpanPage(nextIt->second))
+        {
+            // 右侧相邻的内存页空闲 消除掉右侧内存页的记录 合并之后只保留左侧的SpanPage
+            SpanPage* nextSpanPage = nextIt->second;
+            this->m_recordPageMap.erase(nextIt);
+            spanPage->pageNums += nextSpanPage->pageNums;
+            delete nextSpanPage;
+            this->m_spanMergeNums.fetch_add(1, std::memory_order_relaxed);
         }
 
-        // 没有找到右侧相邻的内存页 或者 找到了右侧相邻内存页但是在空闲链表中没有找到
+        // 前插到对应内存页数量的链表上
         SpanPage* oldHead = this->m_freePageMap[spanPage->pageNums];
         spanPage->next = oldHead;
-        this->m_freePageMap[spanPage->pageNums] = spanPage->next;
-
+        this->m_freePageMap[spanPage->pageNums] = spanPage;
+        this->m_freeBytes.fetch_add(spanPage->pageNums * PAGE_SIZE, std::memory_order_relaxed);
     }
 
     void *PageCache::systemAlloc(size_t pageNums)
@@ -139,24 +471,75 @@ namespace memory_pool
         void *addr = mmap(nullptr, pageNums * PAGE_SIZE, PROT_READ | PROT_WRITE,
             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
 
-        if(!addr)
+        if(addr == MAP_FAILED)
             return nullptr;
+        this->m_mmapNums.fetch_add(1, std::memory_order_relaxed);
+        this->m_committedBytes.fetch_add(pageNums * PAGE_SIZE, std::memory_order_relaxed);
         
         memset(addr, 0, pageNums * PAGE_SIZE);
 
         return addr;
     }
 
+    PageCacheStats PageCache::getStats() const
+    {
+        PageCacheStats stats;
+        stats.mmapNums = this->m_mmapNums.load(std::memory_order_relaxed);
+        stats.spanSplitNums = this->m_spanSplitNums.load(std::memory_order_relaxed);
+        stats.spanMergeNums = this->m_spanMergeNums.load(std::memory_order_relaxed);
+        stats.freeBytes = this->m_freeBytes.load(std::memory_order_relaxed);
+        stats.committedBytes = this->m_committedBytes.load(std::memory_order_relaxed);
+        stats.releasedBytes = this->m_releasedBytes.load(std::memory_order_relaxed);
+        stats.systemAllocNums = this->m_systemAllocNums.load(std::memory_order_relaxed);
+        stats.reserveNums = this->m_reserveNums.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    void PageCache::releaseAll()
+    {
+        std::lock_guard<std::mutex> lock(this->m_pageMutex);
+        this->systemDealloc();
+    }
+
     void PageCache::systemDealloc()
     {
+        /**
+         * 整体释放所有内存页
+         * 整体流程:
+         * 收集所有内存页记录以及超大内存的地址范围 按地址排序;
+         * 分割出来的内存页以及连续映射的内存页地址相邻 合并成一段之后再munmap 避免每条记录一次系统调用;
+         */
+        std::vector<std::pair<size_t, size_t>> ranges;
+        ranges.reserve(this->m_recordPageMap.size() + this->m_hugePageMap.size());
         for(auto& [ptr, spanPage] : this->m_recordPageMap)
         {
             assert(ptr != nullptr);
-            munmap(ptr, spanPage->pageNums * PAGE_SIZE);
+            ranges.emplace_back(reinterpret_cast<size_t>(ptr), spanPage->pageNums * PAGE_SIZE);
             delete spanPage;
         }
+        for(auto& [ptr, pageNums] : this->m_hugePageMap)
+        {
+            ranges.emplace_back(reinterpret_cast<size_t>(ptr), pageNums * PAGE_SIZE);
+        }
         this->m_recordPageMap.clear();
         this->m_freePageMap.clear();
+        this->m_hugePageMap.clear();
+
+        std::sort(ranges.begin(), ranges.end());
+        size_t releasedBytes = 0;
+        size_t i = 0;
+        while(i < ranges.size())
+        {
+            size_t start = ranges[i].first;
+            size_t end = start + ranges[i].second;
+            for(++i; i < ranges.size() && ranges[i].first == end; ++i)
+                end += ranges[i].second;
+            munmap(reinterpret_cast<void*>(start), end - start);
+            releasedBytes += end - start;
+        }
 
+        this->m_freeBytes.store(0, std::memory_order_relaxed);
+        this->m_committedBytes.fetch_sub(releasedBytes, std::memory_order_relaxed);
+        this->m_releasedBytes.fetch_add(releasedBytes, std::memory_order_relaxed);
     }
 }
@@ -0,0 +1,82 @@
+#include "PoolStats.h"
+#include "MemoryPool.h"
+#include "CentralCache.h"
+#include "PageCache.h"
+#include <sstream>
+
+namespace memory_pool
+{
+
+    PoolStats MemoryPool::getStats()
+    {
+        PoolStats stats;
+        stats.sizeClasses = CentralCache::Instance()->getSizeClassStats();
+        stats.pageCache = PageCache::Instance()->getStats();
+        return stats;
+    }
+
+    std::string PoolStats::toString() const
+    {
+        std::ostringstream os;
+        os << std::left << std::setw(10) << "size" << std::setw(12) << "allocs" << std::setw(12) << "frees"
+           << std::setw(12) << "hits" << std::setw(10) << "refills" << std::setw(10) << "returns"
+           << std::setw(14) << "in_use" << std::setw(14) << "thread_cached" << std::setw(16) << "central_cached"
+           << std::setw(12) << "span_pages" << std::setw(12) << "tail_waste" << "\n";
+        for (const SizeClassStats &c : this->sizeClasses)
+        {
+            os << std::left << std::setw(10) << c.blockSize << std::setw(12) << c.allocNums << std::setw(12) << c.freeNums
+               << std::setw(12) << c.cacheHits << std::setw(10) << c.refillNums << std::setw(10) << c.returnNums
+               << std::setw(14) << c.inUseBytes() << std::setw(14) << c.threadCachedBytes
+               << std::setw(16) << c.centralCachedBytes << std::setw(12) << c.spanPages
+               << std::setw(12) << c.spanWasteBytes << "\n";
+        }
+
+        os << "page cache: mmaps=" << this->pageCache.mmapNums
+           << " splits=" << this->pageCache.spanSplitNums
+           << " merges=" << this->pageCache.spanMergeNums
+           << " free=" << this->pageCache.freeBytes
+           << " committed=" << this->pageCache.committedBytes
+           << " released=" << this->pageCache.releasedBytes
+           << " system_allocs=" << this->pageCache.systemAllocNums
+           << " reserves=" << this->pageCache.reserveNums << "\n";
+        return os.str();
+    }
+
+    std::string PoolStats::toJson() const
+    {
+        std::ostringstream os;
+        os << "{\"size_classes\":[";
+        for (size_t i = 0; i < this->sizeClasses.size(); ++i)
+        {
+            const SizeClassStats &c = this->sizeClasses[i];
+            if (i)
+                os << ",";
+            os << "{\"block_size\":" << c.blockSize
+               << ",\"allocs\":" << c.allocNums
+               << ",\"frees\":" << c.freeNums
+               << ",\"cache_hits\":" << c.cacheHits
+               << ",\"refills\":" << c.refillNums
+               << ",\"refill_blocks\":" << c.refillBlocks
+               << ",\"returns\":" << c.returnNums
+               << ",\"return_blocks\":" << c.returnBlocks
+               << ",\"in_use_bytes\":" << c.inUseBytes()
+               << ",\"thread_cached_bytes\":" << c.threadCachedBytes
+               << ",\"central_cached_bytes\":" << c.centralCachedBytes
+               << ",\"span_pages\":" << c.spanPages
+               << ",\"spans\":" << c.spanNums
+               << ",\"span_waste_bytes\":" << c.spanWasteBytes << "}";
+        }
+        os << "],\"page_cache\":{"
+           << "\"mmaps\":" << this->pageCache.mmapNums
+           << ",\"span_splits\":" << this->pageCache.spanSplitNums
+           << ",\"span_merges\":" << this->pageCache.spanMergeNums
+           << ",\"free_bytes\":" << this->pageCache.freeBytes
+           << ",\"committed_bytes\":" << this->pageCache.committedBytes
+           << ",\"released_bytes\":" << this->pageCache.releasedBytes
+           << ",\"system_allocs\":" << this->pageCache.systemAllocNums
+           << ",\"reserves\":" << this->pageCache.reserveNums
+           << "}}";
+        return os.str();
+    }
+
+}
@@ -1,9 +1,30 @@
 #include "ThreadCache.h"
 #include "CentralCache.h"
+#include "PageCache.h"
+#include "Config.h"
 
 namespace memory_pool
 {
 
+    ThreadCache::ThreadCache() : ThreadCache(CentralCache::Instance())
+    {
+    }
+
+    ThreadCache::ThreadCache(CentralCache *centralCache)
+        : m_centralCache(centralCache), m_pageCache(centralCache->getPageCache()), m_config(Config::Instance())
+    {
+        this->m_freeList.fill(nullptr);
+        this->m_freeListSize.fill(0);
+        this->m_keepNums.fill(0);
+        this->m_cachedBytes = 0;
+        this->m_cachedClasses.fill(0);
+        this->m_budgetCursor = 0;
+        for (auto &group : this->m_counterGroups)
+            group.store(nullptr, std::memory_order_relaxed);
+        this->m_bytesUntilSample = HeapProfiler::Instance()->nextSampleBytes();
+        this->m_centralCache->registerThreadCache(this);
+    }
+
     void *ThreadCache::allocate(size_t size)
     {
         /**
@@ -12,23 +33,25 @@ namespace memory_pool
          * 参数有效性判断;
          * 如果对应链表中有空闲内存 直接分配;
          * 如果对应链表中没有空闲内存 则从中心缓存中批量申请;
+         * 超过MAX_BYTES的大内存直接向页面缓存申请内存页 超过HUGE_BYTES的超大内存直接mmap;
          */
 
         assert(size > 0);
 
-        size_t idx = SizeClass::getIndex(size);
-
-        void *headNode = this->m_freeList[idx];
-        if (headNode)
+        // 超过最大内存块大小的申请不经过线程缓存和中心缓存 也不能走operator new(作为malloc替换时会递归)
+        if (size > MAX_BYTES)
         {
-            void *nextNode = *reinterpret_cast<void **>(headNode);
-            *reinterpret_cast<void **>(headNode) = nullptr;
-            this->m_freeList[idx] = nextNode;
-            this->m_freeListSize[idx]--;
-            return headNode;
+            size_t pageNums = (size + PAGE_SIZE - 1) / PAGE_SIZE;
+            void *ptr = size >= HUGE_BYTES ? this->m_pageCache->allocateHugePage(pageNums)
+                                           : this->m_pageCache->allocateSpanPage(pageNums);
+
+            this->m_bytesUntilSample -= static_cast<ptrdiff_t>(size);
+            if (this->m_bytesUntilSample < 0)
+                this->sampleAllocation(ptr, size, pageNums * PAGE_SIZE);
+            return ptr;
         }
 
-        return this->fetchFromCentralCache(idx);
+        return this->allocateByIndex(SizeClass::getIndex(size));
     }
 
     void ThreadCache::deallocate(void *ptr, size_t size)
@@ -41,16 +64,143 @@ namespace memory_pool
          */
         assert(ptr != nullptr && size > 0);
 
-        size_t idx = SizeClass::getIndex(size);
+        if (size > MAX_BYTES && HeapProfiler::mayBeSampled(ptr))
+            HeapProfiler::Instance()->recordDeallocation(ptr);
+
+        if (size >= HUGE_BYTES)
+        {
+            this->m_pageCache->deallocateHugePage(ptr, (size + PAGE_SIZE - 1) / PAGE_SIZE);
+            return;
+        }
+        if (size > MAX_BYTES)
+        {
+            this->m_pageCache->deallocateSpanPage(ptr);
+            return;
+        }
+
+        this->deallocateByIndex(ptr, SizeClass::getIndex(size));
+    }
+
+    void *ThreadCache::reallocate(void *ptr, size_t oldSize, size_t newSize)
+    {
+        /**
+         * 线程缓存调整内存大小
+         * 整体流程:
+         * 参数有效性判断;
+         * 新旧大小落在同一个内存块大小上 直接返回原地址;
+         * 新旧大小都是页面缓存分配的大内存 尝试原地缩小或者合并右侧空闲内存页;
+         * 新旧大小都是直接映射的超大内存 通过mremap调整;
+         * 其余情况重新申请内存 拷贝之后释放原内存;
+         */
+        if (!ptr)
+            return this->allocate(newSize);
+
+        assert(oldSize > 0 && newSize > 0);
+
+        size_t oldPages = (oldSize + PAGE_SIZE - 1) / PAGE_SIZE;
+        size_t newPages = (newSize + PAGE_SIZE - 1) / PAGE_SIZE;
+
+        if (oldSize <= MAX_BYTES && newSize <= MAX_BYTES)
+        {
+            if (SizeClass::getIndex(oldSize) == SizeClass::getIndex(newSize))
+                return ptr;
+        }
+        else if (oldSize >= HUGE_BYTES && newSize >= HUGE_BYTES)
+        {
+            if (oldPages == newPages)
+                return ptr;
+            // mremap之后地址可能改变 原地址上的采样不再有效
+            if (HeapProfiler::mayBeSampled(ptr))
+                HeapProfiler::Instance()->recordDeallocation(ptr);
+            return this->m_pageCache->reallocateHugePage(ptr, oldPages, newPages);
+        }
+        else if (oldSize > MAX_BYTES && oldSize < HUGE_BYTES && newSize > MAX_BYTES && newSize < HUGE_BYTES)
+        {
+            if (this->m_pageCache->resizeSpanPage(ptr, newPages))
+                return ptr;
+        }
+
+        void *newPtr = this->allocate(newSize);
+        if (!newPtr)
+            return nullptr;
+        memcpy(newPtr, ptr, std::min(oldSize, newSize));
+        this->deallocate(ptr, oldSize);
+        return newPtr;
+    }
+
+    void *ThreadCache::allocateAligned(size_t size, size_t align)
+    {
+        /**
+         * 线程缓存申请对齐的内存
+         * 整体流程:
+         * 参数有效性判断;
+         * 对齐不超过ALIGNMENT 与普通申请相同;
+         * 对齐不超过PAGE_SIZE 内存块从页对齐的内存页中按照块大小切分
+         * 大小向上取整到align的倍数后对应的内存块天然对齐 页面缓存分配的大内存本身就是页对齐;
+         * 对齐超过PAGE_SIZE 直接从页面缓存申请首地址对齐的内存页;
+         */
+        assert(size > 0 && align > 0 && (align & (align - 1)) == 0);
+
+        if (align <= ALIGNMENT)
+            return this->allocate(size);
+
+        if (align <= PAGE_SIZE)
+            return this->allocate((size + align - 1) & ~(align - 1));
 
-        void *oldHead = this->m_freeList[idx];
-        *reinterpret_cast<void **>(ptr) = oldHead;
-        this->m_freeList[idx] = ptr;
-        this->m_freeListSize[idx]++;
+        size_t pageNums = (size + PAGE_SIZE - 1) / PAGE_SIZE;
+        size_t alignPages = align / PAGE_SIZE;
+        if (size >= HUGE_BYTES)
+            return this->m_pageCache->allocateAlignedHugePage(pageNums, alignPages);
+        return this->m_pageCache->allocateAlignedSpanPage(pageNums, alignPages);
+    }
+
+    void ThreadCache::deallocateAligned(void *ptr, size_t size, size_t align)
+    {
+        assert(size > 0 && align > 0 && (align & (align - 1)) == 0);
 
-        if (this->shouldReturntoCentralCache(idx))
+        if (align <= ALIGNMENT)
+            return this->deallocate(ptr, size);
+
+        if (align <= PAGE_SIZE)
+            return this->deallocate(ptr, (size + align - 1) & ~(align - 1));
+
+        if (size >= HUGE_BYTES)
+            return this->m_pageCache->deallocateHugePage(ptr, (size + PAGE_SIZE - 1) / PAGE_SIZE);
+        this->m_pageCache->deallocateSpanPage(ptr);
+    }
+
+    void ThreadCache::prewarm(std::initializer_list<std::pair<size_t, size_t>> sizeCounts)
+    {
+        /**
+         * 预热线程缓存
+         * 整体流程:
+         * 超过MAX_BYTES的大小不经过线程缓存 跳过;
+         * 链表中的内存块不够时从中心缓存批量获取 整段链表前插到线程缓存的链表上;
+         * 记录需要保留的数量 归还给中心缓存时不低于该数量;
+         */
+        for (const auto &[size, count] : sizeCounts)
         {
-            this->returnToCentralCache(idx);
+            assert(size > 0);
+            if (size > MAX_BYTES || count == 0)
+                continue;
+
+            size_t index = SizeClass::getIndex(size);
+            while (this->m_freeListSize[index] < count)
+            {
+                std::pair<void *, size_t> fetchRet = this->m_centralCache->fetchRange(index, false);
+                if (!fetchRet.first)
+                    break;
+
+                void *tailNode = fetchRet.first;
+                for (size_t i = 1; i < fetchRet.second; ++i)
+                    tailNode = *reinterpret_cast<void **>(tailNode);
+                *reinterpret_cast<void **>(tailNode) = this->m_freeList[index];
+                this->m_freeList[index] = fetchRet.first;
+                this->m_freeListSize[index] += fetchRet.second;
+                this->m_cachedBytes += fetchRet.second * SizeClass::getBlockSize(index);
+                this->m_cachedClasses[index / 64] |= uint64_t(1) << (index % 64);
+            }
+            this->m_keepNums[index] = static_cast<uint32_t>(std::max<size_t>(this->m_keepNums[index], std::min<size_t>(count, UINT32_MAX)));
         }
     }
 
@@ -67,7 +217,7 @@ namespace memory_pool
         assert(index >= 0 && index < FREE_LIST_SIZE);
 
         // 获取得到的是一个链表
-        std::pair<void *, size_t> fetchRet = CentralCache::Instance()->fetchRange(index);
+        std::pair<void *, size_t> fetchRet = this->m_centralCache->fetchRange(index);
         assert(fetchRet.first != nullptr);
         void *ptr = fetchRet.first;
         size_t blockNums = fetchRet.second;
@@ -78,16 +228,44 @@ namespace memory_pool
         this->m_freeList[index] = nextNode;
 
         this->m_freeListSize[index] += blockNums - 1; // -1是因为第一个用于返回了
+        if (blockNums > 1)
+        {
+            this->m_cachedBytes += (blockNums - 1) * SizeClass::getBlockSize(index);
+            this->m_cachedClasses[index / 64] |= uint64_t(1) << (index % 64);
+        }
 
         return ptr;
     }
 
+    ThreadCache::CounterGroup *ThreadCache::createCounterGroup(size_t index)
+    {
+        // 复用的内存页不一定是0 值初始化清零
+        CounterGroup *group = new (this->m_centralCache->allocateCounterPage()) CounterGroup();
+
+        // 统计线程通过acquire读取 看到的一定是清零之后的计数
+        this->m_counterGroups[index / COUNTER_GROUP_SIZE].store(group, std::memory_order_release);
+        return group;
+    }
+
+    void ThreadCache::sampleAllocation(void *ptr, size_t size, size_t blockSize)
+    {
+        // 计数用完之后重新生成 没有开始采样时得到的是复查间隔 不记录本次申请
+        HeapProfiler *profiler = HeapProfiler::Instance();
+        bool sampled = profiler->isRunning();
+        this->m_bytesUntilSample = profiler->nextSampleBytes();
+        if (sampled)
+            profiler->recordAllocation(ptr, size, blockSize);
+    }
+
     bool ThreadCache::shouldReturntoCentralCache(size_t index)
     {
         assert(index >= 0 && index < FREE_LIST_SIZE);
-        if (this->m_freeListSize[index] > 64)
-            return true;
-        return false;
+        const Config *config = this->m_config;
+        size_t listSize = this->m_freeListSize[index];
+        size_t keepNums = this->m_keepNums[index];
+
+        // 预热过的链表超过保留数量一个上限以上才归还 避免每次释放都归还一个内存块
+        return listSize > config->getThreadCacheMaxBlocks() + keepNums;
     }
 
     void ThreadCache::returnToCentralCache(size_t index)
@@ -102,26 +280,88 @@ namespace memory_pool
          */
         assert(index >= 0 && index < FREE_LIST_SIZE);
 
-        size_t keepNums = std::max(this->m_freeListSize[index] / 4, size_t(1));
-        if(keepNums < 4)
+        // 按照归还比例保留一部分 默认归还75%
+        size_t listSize = this->m_freeListSize[index];
+        size_t keepNums = std::max({listSize * (100 - this->m_config->getReleaseRate()) / 100, size_t(1), size_t(this->m_keepNums[index])});
+        this->returnListTail(index, keepNums);
+    }
+
+    void ThreadCache::returnListTail(size_t index, size_t keepNums)
+    {
+        size_t listSize = this->m_freeListSize[index];
+        if(keepNums >= listSize)
             return;
-        size_t returnNums = this->m_freeListSize[index] - keepNums;
+        size_t returnNums = listSize - keepNums;
 
-        // 寻找第keepNums个内存块的位置 也就是索引keepNums-1的节点
-        void *curNode = this->m_freeList[index];
-        for (size_t i = 0; i <= keepNums - 2; ++i)
+        void *splitNode = this->m_freeList[index];
+        if (keepNums == 0)
         {
-            curNode = *reinterpret_cast<void **>(curNode);
-            // 如果遍历过程中遇到nullptr 说明数量不够 直接返回
-            if (!curNode)
-                return;
+            this->m_freeList[index] = nullptr;
         }
+        else
+        {
+            // 寻找第keepNums个内存块的位置 也就是索引keepNums-1的节点
+            void *curNode = this->m_freeList[index];
+            for (size_t i = 0; i + 1 < keepNums; ++i)
+            {
+                curNode = *reinterpret_cast<void **>(curNode);
+                // 如果遍历过程中遇到nullptr 说明数量不够 直接返回
+                if (!curNode)
+                    return;
+            }
 
-        void *splitNode = *reinterpret_cast<void **>(curNode);
-        *reinterpret_cast<void **>(curNode) = nullptr;
+            splitNode = *reinterpret_cast<void **>(curNode);
+            *reinterpret_cast<void **>(curNode) = nullptr;
+        }
         this->m_freeListSize[index] = keepNums;
+        this->m_cachedBytes -= returnNums * SizeClass::getBlockSize(index);
+
+        this->m_centralCache->returnRange(splitNode, returnNums, index);
+    }
 
-        CentralCache::Instance()->returnRange(splitNode, returnNums, index);
+    void ThreadCache::returnToByteBudget(size_t maxBytes)
+    {
+        /**
+         * 线程缓存超过字节数上限时归还
+         * 整体流程:
+         * 从上次停下的位置开始遍历可能非空的链表 每个链表归还到预热保留的数量 已经为空的链表清除标记;
+         * 总字节数降到上限的(100 - 归还比例)%以下时停止 之后的释放不会马上再次超过上限;
+         */
+        size_t targetBytes = maxBytes * (100 - this->m_config->getReleaseRate()) / 100;
+        const size_t wordNums = this->m_cachedClasses.size();
+        for (size_t n = 0; n < wordNums; ++n)
+        {
+            size_t w = (this->m_budgetCursor + n) % wordNums;
+            uint64_t bits = this->m_cachedClasses[w];
+            while (bits)
+            {
+                size_t index = w * 64 + __builtin_ctzll(bits);
+                bits &= bits - 1;
+
+                this->returnListTail(index, this->m_keepNums[index]);
+                if (this->m_freeListSize[index] == 0)
+                    this->m_cachedClasses[w] &= ~(uint64_t(1) << (index % 64));
+                if (this->m_cachedBytes <= targetBytes)
+                {
+                    this->m_budgetCursor = w;
+                    return;
+                }
+            }
+        }
+    }
+
+    void ThreadCache::returnAllToCentralCache()
+    {
+        for (size_t i = 0; i < FREE_LIST_SIZE; ++i)
+        {
+            if (this->m_freeListSize[i] == 0)
+                continue;
+            this->m_centralCache->returnRange(this->m_freeList[i], this->m_freeListSize[i], i);
+            this->m_freeList[i] = nullptr;
+            this->m_freeListSize[i] = 0;
+        }
+        this->m_cachedBytes = 0;
+        this->m_cachedClasses.fill(0);
     }
 
 }
\ No newline at end of file
@@ -0,0 +1,212 @@
+#include "TraceRecorder.h"
+#include <chrono>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace memory_pool
+{
+
+    namespace
+    {
+        thread_local void *t_traceBuffer = nullptr;
+
+        uint64_t nowNs()
+        {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+
+        bool writeAll(int fd, const void *data, size_t bytes)
+        {
+            const char *p = static_cast<const char *>(data);
+            while (bytes > 0)
+            {
+                ssize_t n = ::write(fd, p, bytes);
+                if (n <= 0)
+                    return false;
+                p += n;
+                bytes -= static_cast<size_t>(n);
+            }
+            return true;
+        }
+    }
+
+    TraceRecorder::TraceRecorder()
+    {
+        pthread_key_create(&this->m_threadKey, &TraceRecorder::onThreadExit);
+
+        const char *path = getenv("MEMPOOL_TRACE_FILE");
+        if (path && *path)
+            this->start(path);
+    }
+
+    bool TraceRecorder::start(const char *path)
+    {
+        /**
+         * 开始记录
+         * 整体流程:
+         * 打开文件并写入文件头;
+         * 第一次开始时登记进程退出回调 保证缓冲区中的记录写入文件;
+         */
+        assert(path != nullptr);
+
+        if (this->isRecording())
+            this->stop();
+
+        std::lock_guard<std::mutex> lock(this->m_fileMutex);
+
+        int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0)
+            return false;
+
+        TraceFileHeader header;
+        std::copy(TRACE_MAGIC, TRACE_MAGIC + sizeof(TRACE_MAGIC), header.magic);
+        header.version = TRACE_VERSION;
+        header.recordSize = sizeof(TraceRecord);
+        if (!writeAll(fd, &header, sizeof(header)))
+        {
+            ::close(fd);
+            return false;
+        }
+
+        static bool registered = false;
+        if (!registered)
+        {
+            registered = true;
+            atexit([]() { TraceRecorder::Instance()->stop(); });
+        }
+
+        this->m_fd = fd;
+        this->m_startNs = nowNs();
+        this->m_recording.store(true, std::memory_order_release);
+        return true;
+    }
+
+    void TraceRecorder::stop()
+    {
+        if (!this->m_recording.exchange(false, std::memory_order_acq_rel))
+            return;
+
+        while (this->m_bufferListLock.test_and_set(std::memory_order_acquire))
+            std::this_thread::yield();
+        for (ThreadBuffer *buffer = this->m_bufferList; buffer; buffer = buffer->next)
+        {
+            while (buffer->lock.test_and_set(std::memory_order_acquire))
+                std::this_thread::yield();
+            this->flushBuffer(buffer);
+            buffer->lock.clear(std::memory_order_release);
+        }
+        this->m_bufferListLock.clear(std::memory_order_release);
+
+        std::lock_guard<std::mutex> lock(this->m_fileMutex);
+        if (this->m_fd >= 0)
+        {
+            ::close(this->m_fd);
+            this->m_fd = -1;
+        }
+    }
+
+    void TraceRecorder::append(TraceOp op, void *ptr, size_t size)
+    {
+        ThreadBuffer *buffer = this->threadBuffer();
+        if (!buffer)
+            return;
+
+        // 只有stop时才会有其他线程竞争 大部分时候加锁没有冲突
+        while (buffer->lock.test_and_set(std::memory_order_acquire))
+            std::this_thread::yield();
+
+        if (buffer->recordNums == BUFFER_RECORDS)
+            this->flushBuffer(buffer);
+
+        TraceRecord &record = buffer->records[buffer->recordNums++];
+        record.timestamp = nowNs() - this->m_startNs;
+        record.ptr = reinterpret_cast<uint64_t>(ptr);
+        record.size = size > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(size);
+        record.op = op;
+        record.reserved[0] = record.reserved[1] = record.reserved[2] = 0;
+
+        buffer->lock.clear(std::memory_order_release);
+    }
+
+    TraceRecorder::ThreadBuffer *TraceRecorder::threadBuffer()
+    {
+        /**
+         * 获取当前线程的缓冲区
+         * 整体流程:
+         * 线程局部变量中已经有缓冲区 直接返回;
+         * 优先复用已经退出的线程留下的缓冲区 没有则通过mmap申请新的缓冲区;
+         * 分配新的线程编号 并通过pthread_key登记线程退出回调;
+         */
+        if (t_traceBuffer)
+            return static_cast<ThreadBuffer *>(t_traceBuffer);
+
+        while (this->m_bufferListLock.test_and_set(std::memory_order_acquire))
+            std::this_thread::yield();
+
+        ThreadBuffer *buffer = this->m_bufferList;
+        while (buffer && buffer->inUse)
+            buffer = buffer->next;
+
+        if (!buffer)
+        {
+            void *addr = mmap(nullptr, sizeof(ThreadBuffer), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (addr == MAP_FAILED)
+            {
+                this->m_bufferListLock.clear(std::memory_order_release);
+                return nullptr;
+            }
+            // mmap得到的内存全部为0 atomic_flag处于clear状态
+            buffer = static_cast<ThreadBuffer *>(addr);
+            buffer->next = this->m_bufferList;
+            this->m_bufferList = buffer;
+        }
+
+        buffer->inUse = true;
+        buffer->recordNums = 0;
+        buffer->threadId = this->m_nextThreadId++;
+        this->m_bufferListLock.clear(std::memory_order_release);
+
+        t_traceBuffer = buffer;
+        pthread_setspecific(this->m_threadKey, buffer);
+        return buffer;
+    }
+
+    void TraceRecorder::flushBuffer(ThreadBuffer *buffer)
+    {
+        if (buffer->recordNums == 0)
+            return;
+
+        std::lock_guard<std::mutex> lock(this->m_fileMutex);
+        if (this->m_fd >= 0)
+        {
+            TraceChunkHeader header;
+            header.threadId = buffer->threadId;
+            header.recordNums = buffer->recordNums;
+            writeAll(this->m_fd, &header, sizeof(header));
+            writeAll(this->m_fd, buffer->records, sizeof(TraceRecord) * buffer->recordNums);
+        }
+        buffer->recordNums = 0;
+    }
+
+    void TraceRecorder::onThreadExit(void *ptr)
+    {
+        TraceRecorder *recorder = TraceRecorder::Instance();
+        ThreadBuffer *buffer = static_cast<ThreadBuffer *>(ptr);
+
+        while (buffer->lock.test_and_set(std::memory_order_acquire))
+            std::this_thread::yield();
+        recorder->flushBuffer(buffer);
+        buffer->lock.clear(std::memory_order_release);
+
+        // 线程退出之后其他释放调用仍可能用到t_traceBuffer 之后的记录会丢失 但不会访问到已复用的缓冲区
+        t_traceBuffer = nullptr;
+
+        while (recorder->m_bufferListLock.test_and_set(std::memory_order_acquire))
+            std::this_thread::yield();
+        buffer->inUse = false;
+        recorder->m_bufferListLock.clear(std::memory_order_release);
+    }
+
+}
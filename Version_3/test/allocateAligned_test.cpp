@@ -0,0 +1,162 @@
+#include "MemoryPool.h"
+#include "PoolAllocator.h"
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <thread>
+#include <numeric>
+#include <cassert>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+
+using namespace memory_pool;
+using Clock = std::chrono::steady_clock;
+
+constexpr int loopNums = 100000;
+constexpr int repeatTimes = 10;
+constexpr int threadCount = 4;
+
+bool isAligned(void* ptr, size_t align)
+{
+    return reinterpret_cast<uintptr_t>(ptr) % align == 0;
+}
+
+// 覆盖小内存块、页面缓存的大内存、直接映射的超大内存以及超过页大小的对齐
+void testCorrectness()
+{
+    std::vector<size_t> sizes = {1, 8, 24, 100, 1000, 4096, 5000, 200 * 1024, 300 * 1024, 2 * 1024 * 1024};
+    std::vector<size_t> aligns = {8, 16, 32, 64, 128, 256, 1024, 4096, 8192, 64 * 1024, 2 * 1024 * 1024};
+
+    for (size_t size : sizes)
+    {
+        for (size_t align : aligns)
+        {
+            std::vector<char*> ptrs;
+            for (int i = 0; i < 8; ++i)
+            {
+                char* p = static_cast<char*>(MemoryPool::allocateAligned(size, align));
+                assert(p != nullptr && isAligned(p, align));
+                memset(p, i, size);
+                ptrs.push_back(p);
+            }
+            for (int i = 0; i < 8; ++i)
+            {
+                assert(ptrs[i][0] == i && ptrs[i][size - 1] == i);
+                MemoryPool::deallocateAligned(ptrs[i], size, align);
+            }
+        }
+    }
+
+    // 超过页大小的对齐归还后 页面缓存中剩余的内存页仍然可以正常使用
+    void* big = MemoryPool::allocate(600 * 1024);
+    memset(big, 1, 600 * 1024);
+    MemoryPool::deallocate(big, 600 * 1024);
+
+    std::cout << "allocateAligned correctness test passed\n";
+}
+
+struct alignas(64) CacheLine
+{
+    char data[64];
+};
+
+struct alignas(8192) BigAligned
+{
+    char data[100];
+};
+
+// 过对齐类型通过PoolAllocator使用
+void testPoolAllocator()
+{
+    std::vector<CacheLine, PoolAllocator<CacheLine>> lines(1000);
+    assert(isAligned(lines.data(), 64));
+
+    PoolAllocator<CacheLine> lineAlloc;
+    CacheLine* one = lineAlloc.allocate(1);
+    assert(isAligned(one, 64));
+    lineAlloc.deallocate(one, 1);
+
+    PoolAllocator<BigAligned> bigAlloc;
+    BigAligned* b = bigAlloc.allocate(3);
+    assert(isAligned(b, 8192));
+    bigAlloc.deallocate(b, 3);
+
+    std::cout << "PoolAllocator over-aligned test passed\n";
+}
+
+// 多线程交叉申请不同对齐的内存
+void threadTask()
+{
+    std::vector<std::pair<void*, size_t>> ptrs;
+    for (int i = 0; i < loopNums; ++i)
+    {
+        size_t align = size_t(16) << (i % 6);
+        size_t size = (i * 37) % 2000 + 1;
+        void* p = MemoryPool::allocateAligned(size, align);
+        assert(isAligned(p, align));
+        ptrs.emplace_back(p, (size << 8) | (i % 6));
+        if (ptrs.size() > 256)
+        {
+            for (auto& [q, info] : ptrs)
+                MemoryPool::deallocateAligned(q, info >> 8, size_t(16) << (info & 0xff));
+            ptrs.clear();
+        }
+    }
+    for (auto& [q, info] : ptrs)
+        MemoryPool::deallocateAligned(q, info >> 8, size_t(16) << (info & 0xff));
+}
+
+void testMultiThread()
+{
+    std::vector<std::thread> threads;
+    for (int i = 0; i < threadCount; ++i)
+        threads.emplace_back(threadTask);
+    for (auto& t : threads)
+        t.join();
+    std::cout << "allocateAligned multi-thread test passed\n";
+}
+
+// 计时函数模板
+template<typename Func>
+int64_t measure(Func&& f) {
+    auto start = Clock::now();
+    f();
+    auto end = Clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+}
+
+// 平均计算函数
+double computeAverage(const std::vector<double>& v) {
+    return std::accumulate(v.begin(), v.end(), 0.0) / v.size();
+}
+
+int main()
+{
+    testCorrectness();
+    testPoolAllocator();
+    testMultiThread();
+
+    std::cout << "\n===== allocateAligned(64B, 64) vs aligned_alloc =====\n";
+    std::vector<void*> ptrs(loopNums);
+    std::vector<double> speedup;
+    for (int i = 0; i < repeatTimes; ++i)
+    {
+        auto t_pool = measure([&]() {
+            for (int j = 0; j < loopNums; ++j)
+                ptrs[j] = MemoryPool::allocateAligned(64, 64);
+            for (int j = 0; j < loopNums; ++j)
+                MemoryPool::deallocateAligned(ptrs[j], 64, 64);
+        });
+        auto t_sys = measure([&]() {
+            for (int j = 0; j < loopNums; ++j)
+                ptrs[j] = aligned_alloc(64, 64);
+            for (int j = 0; j < loopNums; ++j)
+                free(ptrs[j]);
+        });
+        speedup.push_back((t_sys - t_pool) * 100.0 / t_sys);
+        std::cout << "Round " << i + 1 << ": allocateAligned = " << t_pool << "us, aligned_alloc = " << t_sys << "us\n";
+    }
+    std::cout << "Average speedup: " << computeAverage(speedup) << "%\n";
+    return 0;
+}
@@ -0,0 +1,171 @@
+#include "Arena.h"
+#include "MemoryPool.h"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cassert>
+#include <memory_resource>
+
+using namespace memory_pool;
+
+constexpr int requestNums = 10000;
+constexpr int objectNums = 300;
+
+// 记录析构顺序
+std::vector<int> g_destroyOrder;
+
+struct Tracked
+{
+    int id;
+    std::string name;
+    Tracked(int _id) : id(_id), name("tracked object " + std::to_string(_id)) {}
+    ~Tracked() { g_destroyOrder.push_back(id); }
+};
+
+struct alignas(64) CacheLine
+{
+    char data[64];
+};
+
+void testAllocate()
+{
+    Arena arena;
+    for (int i = 0; i < 1000; ++i)
+    {
+        size_t size = i % 100 + 1;
+        void* ptr = arena.allocate(size, 8);
+        assert(reinterpret_cast<size_t>(ptr) % 8 == 0);
+        memset(ptr, 0xAB, size);
+    }
+    CacheLine* line = arena.create<CacheLine>();
+    assert(reinterpret_cast<size_t>(line) % 64 == 0);
+
+    // 超过一段内存页的申请单独使用足够大的内存页
+    size_t bigSize = Arena::DEFAULT_SPAN_PAGE * PAGE_SIZE * 2;
+    char* big = static_cast<char*>(arena.allocate(bigSize));
+    memset(big, 0, bigSize);
+    // 超大内存直接映射
+    char* huge = static_cast<char*>(arena.allocate(2 * HUGE_BYTES));
+    memset(huge, 0, 2 * HUGE_BYTES);
+    assert(arena.getReservedBytes() >= bigSize + 2 * HUGE_BYTES);
+    assert(arena.getUsedBytes() <= arena.getReservedBytes());
+}
+
+void testReset()
+{
+    Arena arena;
+    void* first = arena.allocate(32);
+    for (int i = 0; i < 10000; ++i)
+        arena.allocate(48);
+    size_t reserved = arena.getReservedBytes();
+
+    // reset之后从第一个内存页开始复用 不再申请新的内存页
+    arena.reset();
+    assert(arena.getUsedBytes() < 64);
+    assert(arena.allocate(32) == first);
+    for (int i = 0; i < 10000; ++i)
+        arena.allocate(48);
+    assert(arena.getReservedBytes() == reserved);
+}
+
+void testDestructors()
+{
+    g_destroyOrder.clear();
+    {
+        Arena arena;
+        for (int i = 0; i < 5; ++i)
+            assert(arena.create<Tracked>(i)->id == i);
+        // 平凡析构的对象不记录
+        arena.create<int>(42);
+
+        arena.reset();
+        assert((g_destroyOrder == std::vector<int>{4, 3, 2, 1, 0}));
+
+        g_destroyOrder.clear();
+        arena.create<Tracked>(10);
+        arena.create<Tracked>(11);
+    }
+    // 析构时释放
+    assert((g_destroyOrder == std::vector<int>{11, 10}));
+}
+
+void testPmr()
+{
+    Arena arena;
+    {
+        std::pmr::vector<std::pmr::string> names(&arena);
+        for (int i = 0; i < 1000; ++i)
+            names.emplace_back("a string long enough to need its own buffer " + std::to_string(i));
+        assert(names[999].get_allocator().resource() == &arena);
+        assert(names[999] == "a string long enough to need its own buffer 999");
+    }
+    assert(arena.getUsedBytes() > 1000 * 40);
+    assert(arena.is_equal(arena));
+}
+
+void testRelease()
+{
+    Arena arena;
+    for (int i = 0; i < 10000; ++i)
+        arena.allocate(64);
+    size_t reserved = arena.getReservedBytes();
+    size_t freeBefore = MemoryPool::getStats().pageCache.freeBytes;
+
+    // 内存页归还给页面缓存
+    arena.release();
+    assert(arena.getReservedBytes() == 0);
+    assert(MemoryPool::getStats().pageCache.freeBytes >= freeBefore + reserved);
+
+    // release之后仍然可以继续使用
+    assert(arena.allocate(16) != nullptr);
+}
+
+// 模拟请求处理 每个请求申请objectNums个小对象 请求结束时全部释放
+void benchmark()
+{
+    std::vector<std::pair<void*, size_t>> ptrs;
+    ptrs.reserve(objectNums);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < requestNums; ++r)
+    {
+        for (int i = 0; i < objectNums; ++i)
+        {
+            size_t size = (i % 16 + 1) * 8;
+            ptrs.emplace_back(MemoryPool::allocate(size), size);
+        }
+        for (auto& [ptr, size] : ptrs)
+            MemoryPool::deallocate(ptr, size);
+        ptrs.clear();
+    }
+    auto poolTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    Arena arena;
+    start = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < requestNums; ++r)
+    {
+        for (int i = 0; i < objectNums; ++i)
+            ptrs.emplace_back(arena.allocate((i % 16 + 1) * 8, 8), 0);
+        ptrs.clear();
+        arena.reset();
+    }
+    auto arenaTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    std::cout << requestNums << " requests x " << objectNums << " objects" << std::endl;
+    std::cout << "MemoryPool allocate/deallocate: " << poolTime << " ms" << std::endl;
+    std::cout << "Arena allocate/reset: " << arenaTime << " ms" << std::endl;
+}
+
+int main()
+{
+    testAllocate();
+    testReset();
+    testDestructors();
+    testPmr();
+    testRelease();
+    benchmark();
+
+    std::cout << "arena test passed" << std::endl;
+    return 0;
+}
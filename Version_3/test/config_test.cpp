@@ -0,0 +1,83 @@
+#include "MemoryPool.h"
+#include "Config.h"
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <cassert>
+
+using namespace memory_pool;
+
+SizeClassStats findClass(size_t blockSize)
+{
+    for (const SizeClassStats& c : MemoryPool::getStats().sizeClasses)
+        if (c.blockSize == blockSize)
+            return c;
+    return SizeClassStats();
+}
+
+void allocateAndFree(size_t size, int nums)
+{
+    std::vector<void*> ptrs;
+    for (int i = 0; i < nums; ++i)
+        ptrs.push_back(MemoryPool::allocate(size));
+    for (void* ptr : ptrs)
+        MemoryPool::deallocate(ptr, size);
+}
+
+int main()
+{
+    // 环境变量在第一次使用时读取 格式错误的值使用默认值
+    setenv("MEMPOOL_TC_MAX_BLOCKS", "16", 1);
+    setenv("MEMPOOL_TC_MAX_BYTES", "64K", 1);
+    setenv("MEMPOOL_BATCH_BLOCKS", "8", 1);
+    setenv("MEMPOOL_SPAN_PAGES", "8", 1);
+    setenv("MEMPOOL_RELEASE_RATE", "abc", 1);
+
+    Config* config = Config::Instance();
+    assert(config->getThreadCacheMaxBlocks() == 16);
+    assert(config->getThreadCacheMaxBytes() == 64 * 1024);
+    assert(config->getBatchBlocks() == 8);
+    assert(config->getSpanPages() == 8);
+    assert(config->getReleaseRate() == Config::DEFAULT_RELEASE_RATE);
+
+    // 批量大小和内存页数量
+    allocateAndFree(8, 100);
+    SizeClassStats small = findClass(8);
+    assert(small.refillBlocks <= small.refillNums * 8);
+    assert(small.spanPages == 8 && small.spanNums == 1);
+    // 链表超过16个内存块时归还
+    assert(small.returnNums > 0);
+    assert(small.threadCachedBytes <= (16 + 1) * 8);
+
+    // 字节数上限是整个线程缓存的 每个链表都没超过16个内存块 但总数超过64KB就归还
+    allocateAndFree(4096, 12);
+    allocateAndFree(8192, 12);
+    allocateAndFree(16384, 12);
+    size_t cachedBytes = 0;
+    for (const SizeClassStats& c : MemoryPool::getStats().sizeClasses)
+        cachedBytes += c.threadCachedBytes;
+    assert(cachedBytes <= 64 * 1024);
+    assert(findClass(4096).returnNums > 0 || findClass(8192).returnNums > 0);
+
+    // 通过接口调整 超出范围的值被限制
+    config->setSpanPages(1000);
+    assert(config->getSpanPages() == MAX_SPAN_PAGE);
+    config->setReleaseRate(0);
+    assert(config->getReleaseRate() == 1);
+    config->setBatchBlocks(0);
+    assert(config->getBatchBlocks() == 1);
+
+    // 恢复默认值后与原来的行为一致
+    config->reset();
+    assert(config->getThreadCacheMaxBlocks() == Config::DEFAULT_TC_MAX_BLOCKS);
+    assert(config->getThreadCacheMaxBytes() == 0);
+    assert(config->getSpanPages() == SPAN_PAGE);
+    allocateAndFree(24, 1000);
+    SizeClassStats restored = findClass(24);
+    assert(restored.spanPages == SPAN_PAGE);
+    assert(restored.refillBlocks <= restored.refillNums * Config::DEFAULT_BATCH_BLOCKS);
+
+    std::cout << MemoryPool::getStats().toString() << std::endl;
+    std::cout << "config test passed" << std::endl;
+    return 0;
+}
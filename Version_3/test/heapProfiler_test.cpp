@@ -0,0 +1,81 @@
+#include "MemoryPool.h"
+#include "HeapProfiler.h"
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <cassert>
+
+using namespace memory_pool;
+
+constexpr size_t sampleBytes = 64 * 1024;
+
+// 两个不同的调用点 申请量相差4倍 采样结果应该大致反映这个比例
+__attribute__((noinline)) void* allocateSmall()
+{
+    return MemoryPool::allocate(64);
+}
+
+__attribute__((noinline)) void* allocateLarge()
+{
+    return MemoryPool::allocate(256);
+}
+
+int main()
+{
+    HeapProfiler* profiler = HeapProfiler::Instance();
+    profiler->start(sampleBytes);
+
+    std::vector<void*> small;
+    std::vector<void*> large;
+    for (int i = 0; i < 200000; ++i)
+    {
+        small.push_back(allocateSmall());
+        large.push_back(allocateLarge());
+    }
+    void* big = MemoryPool::allocate(8 * 1024 * 1024);
+
+    size_t smallBytes = 0;
+    size_t largeBytes = 0;
+    bool bigSampled = false;
+    for (const HeapProfiler::Sample& sample : profiler->getLiveSamples())
+    {
+        assert(sample.depth > 0);
+        if (sample.blockSize == 64)
+            smallBytes += sample.size;
+        else if (sample.blockSize == 256)
+            largeBytes += sample.size;
+        else if (sample.ptr == big)
+            bigSampled = true;
+    }
+    // 64B*20万 + 256B*20万 大约 64MB 平均64KB采样一次 每个调用点都有几百次采样
+    std::cout << "sampled bytes: 64B site = " << smallBytes << ", 256B site = " << largeBytes << std::endl;
+    assert(smallBytes > 0 && largeBytes > smallBytes * 2);
+    // 超过采样间隔很多的申请几乎一定会被采样
+    assert(bigSampled);
+
+    std::ostringstream os;
+    profiler->dump(os);
+    std::string profile = os.str();
+    assert(profile.rfind("heap profile: ", 0) == 0);
+    assert(profile.find("@ heap_v2/65536") != std::string::npos);
+    assert(profile.find("MAPPED_LIBRARIES:") != std::string::npos);
+    std::cout << profile.substr(0, profile.find('\n')) << std::endl;
+
+    // 释放之后存活采样全部移除
+    for (void* p : small)
+        MemoryPool::deallocate(p, 64);
+    for (void* p : large)
+        MemoryPool::deallocate(p, 256);
+    MemoryPool::deallocate(big, 8 * 1024 * 1024);
+    assert(profiler->getLiveSamples().empty());
+
+    profiler->stop();
+    for (int i = 0; i < 100000; ++i)
+        MemoryPool::deallocate(MemoryPool::allocate(64), 64);
+    assert(profiler->getLiveSamples().empty());
+
+    bool written = profiler->dumpToFile("/tmp/memory_pool_heap.prof");
+    assert(written);
+    std::cout << "heap profiler test passed, profile written to /tmp/memory_pool_heap.prof" << std::endl;
+    return 0;
+}
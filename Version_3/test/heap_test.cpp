@@ -0,0 +1,249 @@
+#include "Heap.h"
+#include "MemoryPool.h"
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <cassert>
+
+using namespace memory_pool;
+
+constexpr int loopNums = 100000;
+constexpr int threadCount = 4;
+
+size_t inUseBytes(const PoolStats& stats)
+{
+    size_t bytes = 0;
+    for (const SizeClassStats& c : stats.sizeClasses)
+        bytes += c.inUseBytes();
+    return bytes;
+}
+
+// 中心缓存单独申请 堆对象可以放在栈上
+static_assert(sizeof(Heap) < PAGE_SIZE, "the central cache is allocated out of line");
+
+void testIsolation()
+{
+    Heap heapA;
+    Heap heapB;
+    size_t defaultCommitted = MemoryPool::getStats().pageCache.committedBytes;
+
+    std::vector<void*> ptrsA;
+    std::vector<void*> ptrsB;
+    for (int i = 0; i < 1000; ++i)
+    {
+        ptrsA.push_back(heapA.allocate(64));
+        ptrsB.push_back(heapB.allocate(128));
+        memset(ptrsA.back(), 0xA, 64);
+        memset(ptrsB.back(), 0xB, 128);
+    }
+
+    // 各个堆只统计自己的申请 默认内存池不受影响
+    assert(inUseBytes(heapA.getStats()) == 1000 * 64);
+    assert(inUseBytes(heapB.getStats()) == 1000 * 128);
+    assert(MemoryPool::getStats().pageCache.committedBytes == defaultCommitted);
+
+    for (void* ptr : ptrsA)
+        heapA.deallocate(ptr, 64);
+    for (void* ptr : ptrsB)
+        heapB.deallocate(ptr, 128);
+    assert(inUseBytes(heapA.getStats()) == 0);
+    assert(inUseBytes(heapB.getStats()) == 0);
+}
+
+void testThreads()
+{
+    Heap heap;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; ++t)
+    {
+        threads.emplace_back([&heap, t]() {
+            std::vector<std::pair<void*, size_t>> ptrs;
+            for (int i = 0; i < loopNums; ++i)
+            {
+                size_t size = ((i * 131 + t) % 64 + 1) * 8;
+                ptrs.emplace_back(heap.allocate(size), size);
+                if (ptrs.size() >= 512)
+                {
+                    for (auto& [p, s] : ptrs)
+                        heap.deallocate(p, s);
+                    ptrs.clear();
+                }
+            }
+            for (auto& [p, s] : ptrs)
+                heap.deallocate(p, s);
+        });
+    }
+    for (auto& t : threads)
+        t.join();
+
+    // 退出线程的计数合并到中心缓存 空闲内存块都已经归还给中心缓存
+    PoolStats stats = heap.getStats();
+    size_t allocNums = 0;
+    for (const SizeClassStats& c : stats.sizeClasses)
+    {
+        allocNums += c.allocNums;
+        assert(c.threadCachedBytes == 0);
+    }
+    assert(allocNums == size_t(threadCount) * loopNums);
+    assert(inUseBytes(stats) == 0);
+}
+
+void testDestroy()
+{
+    Heap heap;
+
+    // 不逐个释放 包括大内存和直接映射的超大内存
+    for (int i = 0; i < 10000; ++i)
+        heap.allocate(i % 512 + 1);
+    void* big = heap.allocate(512 * 1024);
+    void* huge = heap.allocate(4 * HUGE_BYTES);
+    void* alignedHuge = heap.allocateAligned(2 * HUGE_BYTES, 4 * HUGE_BYTES);
+    memset(big, 0, 512 * 1024);
+    memset(huge, 0, 4 * HUGE_BYTES);
+    assert(reinterpret_cast<size_t>(alignedHuge) % (4 * HUGE_BYTES) == 0);
+    huge = heap.reallocate(huge, 4 * HUGE_BYTES, 8 * HUGE_BYTES);
+    assert(heap.getStats().pageCache.committedBytes >= 10 * HUGE_BYTES);
+
+    heap.destroy();
+    PageCacheStats stats = heap.getStats().pageCache;
+    assert(stats.committedBytes == 0);
+    assert(stats.freeBytes == 0);
+    assert(heap.getStats().sizeClasses.empty());
+
+    // destroy之后可以继续使用 新的线程第一次使用时创建线程缓存
+    void* ptr = heap.allocate(64);
+    memset(ptr, 0, 64);
+    std::thread([&heap]() {
+        void* p = heap.allocate(32);
+        heap.deallocate(p, 32);
+    }).join();
+    heap.deallocate(ptr, 64);
+    assert(inUseBytes(heap.getStats()) == 0);
+
+    // 跨越destroy存活的线程保留线程缓存 其中的链表已经清空 不会拿到已经释放的内存块
+    std::atomic<int> step{0};
+    std::thread worker([&heap, &step]() {
+        for (int i = 0; i < 1000; ++i)
+            heap.deallocate(heap.allocate(48), 48);
+        step.store(1);
+        while (step.load() != 2)
+            std::this_thread::yield();
+        std::vector<void*> ptrs;
+        for (int i = 0; i < 1000; ++i)
+        {
+            ptrs.push_back(heap.allocate(48));
+            memset(ptrs.back(), 0, 48);
+        }
+        for (void* p : ptrs)
+            heap.deallocate(p, 48);
+    });
+    while (step.load() != 1)
+        std::this_thread::yield();
+    heap.destroy();
+    assert(heap.getStats().pageCache.committedBytes == 0);
+    step.store(2);
+    worker.join();
+    assert(inUseBytes(heap.getStats()) == 0);
+}
+
+// 其他库占满pthread_key之后仍然可以创建和使用堆 所有堆共用一个key
+void testKeyLimit()
+{
+    std::vector<pthread_key_t> keys;
+    pthread_key_t key;
+    while (pthread_key_create(&key, nullptr) == 0)
+        keys.push_back(key);
+
+    {
+        std::vector<Heap*> heaps;
+        for (int i = 0; i < 8; ++i)
+            heaps.push_back(new Heap);
+
+        // 线程退出时每个堆的线程缓存都归还给对应的堆
+        std::thread([&heaps]() {
+            for (Heap* heap : heaps)
+            {
+                void* p = heap->allocate(64);
+                memset(p, 0, 64);
+                heap->deallocate(p, 64);
+            }
+        }).join();
+        for (Heap* heap : heaps)
+        {
+            std::vector<SizeClassStats> stats = heap->getStats().sizeClasses;
+            assert(stats.size() == 1 && stats[0].threadCachedBytes == 0);
+        }
+
+        // 先析构一部分堆 存活的线程退出时跳过已经析构的堆
+        std::thread([&heaps]() {
+            for (Heap* heap : heaps)
+                heap->deallocate(heap->allocate(64), 64);
+            for (int i = 0; i < 4; ++i)
+            {
+                delete heaps[i];
+                heaps[i] = nullptr;
+            }
+        }).join();
+        for (Heap* heap : heaps)
+            delete heap;
+    }
+
+    for (pthread_key_t k : keys)
+        pthread_key_delete(k);
+}
+
+// 模拟一个会话结束时的释放 同一个堆上逐个释放与整体释放对比 只统计释放的时间
+// 会话中是大量小对象(例如解析树的节点) 逐个释放的耗时与对象数量成正比 整体释放只与内存页数量相关
+void benchmark()
+{
+    constexpr int sessionNums = 100;
+    constexpr int objectNums = 100000;
+    using Clock = std::chrono::high_resolution_clock;
+    std::vector<std::pair<void*, size_t>> ptrs;
+    ptrs.reserve(objectNums);
+
+    Heap eachHeap;
+    double eachTime = 0;
+    for (int s = 0; s < sessionNums; ++s)
+    {
+        for (int i = 0; i < objectNums; ++i)
+        {
+            size_t size = (i % 8 + 1) * 8;
+            ptrs.emplace_back(eachHeap.allocate(size), size);
+        }
+        auto start = Clock::now();
+        for (auto& [ptr, size] : ptrs)
+            eachHeap.deallocate(ptr, size);
+        eachTime += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        ptrs.clear();
+    }
+
+    Heap destroyHeap;
+    double destroyTime = 0;
+    for (int s = 0; s < sessionNums; ++s)
+    {
+        for (int i = 0; i < objectNums; ++i)
+            destroyHeap.allocate((i % 8 + 1) * 8);
+        auto start = Clock::now();
+        destroyHeap.destroy();
+        destroyTime += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    std::cout << sessionNums << " sessions x " << objectNums << " objects" << std::endl;
+    std::cout << "Heap deallocate each object: " << eachTime << " ms" << std::endl;
+    std::cout << "Heap destroy: " << destroyTime << " ms" << std::endl;
+}
+
+int main()
+{
+    testIsolation();
+    testThreads();
+    testDestroy();
+    testKeyLimit();
+    benchmark();
+
+    std::cout << "heap test passed" << std::endl;
+    return 0;
+}
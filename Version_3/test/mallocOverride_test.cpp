@@ -0,0 +1,140 @@
+/**
+ * 测试libmemorypool_malloc.so
+ * 该可执行文件直接链接libmemorypool_malloc.so 其中的malloc/free/operator new会覆盖libc中的版本
+ * 也可以通过 LD_PRELOAD=lib/libmemorypool_malloc.so 对任意程序进行替换
+ */
+#include <iostream>
+#include <vector>
+#include <string>
+#include <map>
+#include <thread>
+#include <memory>
+#include <cassert>
+#include <cstring>
+#include <cstdint>
+#include <malloc.h>
+#include <dlfcn.h>
+
+constexpr int threadCount = 4;
+constexpr int loopNums = 100000;
+
+bool isAligned(void* ptr, size_t align)
+{
+    return reinterpret_cast<uintptr_t>(ptr) % align == 0;
+}
+
+// 各种C接口的正确性
+void testCInterface()
+{
+    for (size_t size : {1, 8, 15, 16, 100, 4096, 100000, 300 * 1024, 4 * 1024 * 1024})
+    {
+        char* p = static_cast<char*>(malloc(size));
+        assert(p != nullptr && isAligned(p, 16));
+        assert(malloc_usable_size(p) >= size);
+        memset(p, 0x5a, size);
+        free(p);
+    }
+
+    int* arr = static_cast<int*>(calloc(1000, sizeof(int)));
+    for (int i = 0; i < 1000; ++i)
+        assert(arr[i] == 0);
+    for (int i = 0; i < 1000; ++i)
+        arr[i] = i;
+
+    // realloc 扩大和缩小都需要保留原有数据
+    arr = static_cast<int*>(realloc(arr, 100000 * sizeof(int)));
+    for (int i = 0; i < 1000; ++i)
+        assert(arr[i] == i);
+    arr = static_cast<int*>(realloc(arr, 10 * sizeof(int)));
+    for (int i = 0; i < 10; ++i)
+        assert(arr[i] == i);
+    free(arr);
+
+    for (size_t align : {16, 32, 64, 4096, 65536})
+    {
+        void* p = nullptr;
+        assert(posix_memalign(&p, align, 100) == 0 && isAligned(p, align));
+        free(p);
+
+        p = aligned_alloc(align, align * 2);
+        assert(p != nullptr && isAligned(p, align));
+        free(p);
+
+        p = memalign(align, 24);
+        assert(p != nullptr && isAligned(p, align));
+        assert(malloc_usable_size(p) >= 24);
+        free(p);
+    }
+}
+
+struct alignas(64) CacheLine
+{
+    char data[64];
+};
+
+// 各种operator new/delete重载
+void testOperatorNew()
+{
+    int* p = new int(42);
+    delete p;
+
+    int* arr = new int[100];
+    delete[] arr;
+
+    CacheLine* line = new CacheLine;
+    assert(isAligned(line, 64));
+    delete line;
+
+    CacheLine* lines = new CacheLine[10];
+    assert(isAligned(lines, 64));
+    delete[] lines;
+
+    void* q = operator new(100, std::nothrow);
+    operator delete(q, std::nothrow);
+
+    q = operator new(100);
+    operator delete(q, 100);
+}
+
+// 多线程下交叉使用STL容器 线程之间的释放也需要正确
+void workTask(std::vector<std::string>* out)
+{
+    std::map<int, std::string> m;
+    for (int i = 0; i < loopNums; ++i)
+        m.emplace(i, std::to_string(i) + std::string(i % 64, 'x'));
+    for (int i = 0; i < loopNums; i += 100)
+        out->push_back(m[i]);
+}
+
+void testMultiThread()
+{
+    std::vector<std::vector<std::string>> results(threadCount);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < threadCount; ++i)
+        threads.emplace_back(workTask, &results[i]);
+    for (auto& t : threads)
+        t.join();
+
+    // 主线程释放子线程申请的内存
+    for (auto& v : results)
+    {
+        assert(v.size() == loopNums / 100);
+        assert(v[1] == "100" + std::string(100 % 64, 'x'));
+        v.clear();
+        v.shrink_to_fit();
+    }
+}
+
+int main()
+{
+    Dl_info info;
+    if (dladdr(reinterpret_cast<void*>(&malloc), &info) && info.dli_fname)
+        std::cout << "malloc from: " << info.dli_fname << std::endl;
+
+    testCInterface();
+    testOperatorNew();
+    testMultiThread();
+
+    std::cout << "malloc override test passed" << std::endl;
+    return 0;
+}
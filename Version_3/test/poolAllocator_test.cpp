@@ -0,0 +1,132 @@
+#include "PoolAllocator.h"
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <thread>
+#include <numeric>
+#include <string>
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <cassert>
+#include <cstdint>
+
+using namespace memory_pool;
+using Clock = std::chrono::steady_clock;
+
+constexpr int elementNums = 200000;
+constexpr int repeatTimes = 10;
+constexpr int threadCount = 4;
+
+// 节点类容器 每次插入都会申请一个节点
+template<class Alloc>
+void listTask()
+{
+    std::list<int, Alloc> l;
+    for (int i = 0; i < elementNums; ++i)
+        l.push_back(i);
+    while (!l.empty())
+        l.pop_front();
+}
+
+template<class Alloc>
+void mapTask()
+{
+    std::map<int, int, std::less<int>, Alloc> m;
+    for (int i = 0; i < elementNums; ++i)
+        m.emplace(i * 7 % elementNums, i);
+    for (int i = 0; i < elementNums; ++i)
+        m.erase(i);
+}
+
+template<class Alloc>
+void unorderedMapTask()
+{
+    std::unordered_map<int, int, std::hash<int>, std::equal_to<int>, Alloc> m;
+    for (int i = 0; i < elementNums; ++i)
+        m.emplace(i, i);
+    for (int i = 0; i < elementNums; ++i)
+        m.erase(i);
+}
+
+// 计时函数模板
+template<typename Func>
+int64_t measure(Func&& f) {
+    auto start = Clock::now();
+    f();
+    auto end = Clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+}
+
+// 多线程同时执行同一个任务
+template<typename Func>
+int64_t measureMulti(Func f) {
+    return measure([&]() {
+        std::vector<std::thread> threads;
+        for (int j = 0; j < threadCount; ++j)
+            threads.emplace_back(f);
+        for (auto& t : threads) t.join();
+    });
+}
+
+// 平均计算函数
+double computeAverage(const std::vector<double>& v) {
+    return std::accumulate(v.begin(), v.end(), 0.0) / v.size();
+}
+
+// 对比同一个容器在std::allocator和PoolAllocator下的耗时
+template<typename StdTask, typename PoolTask>
+void compare(const std::string& name, StdTask stdTask, PoolTask poolTask) {
+    // 预热内存池
+    poolTask();
+
+    std::vector<double> speedupSingle;
+    std::vector<double> speedupMulti;
+    for (int i = 0; i < repeatTimes; ++i) {
+        auto t_pool = measure(poolTask);
+        auto t_std = measure(stdTask);
+        speedupSingle.push_back((t_std - t_pool) * 100.0 / t_std);
+
+        t_pool = measureMulti(poolTask);
+        t_std = measureMulti(stdTask);
+        speedupMulti.push_back((t_std - t_pool) * 100.0 / t_std);
+    }
+
+    std::cout << name << ": speedup single-thread = " << computeAverage(speedupSingle)
+              << "%, " << threadCount << " threads = " << computeAverage(speedupMulti) << "%\n";
+}
+
+// 申请0个对象与std::allocator一样返回不为空且互不相同的地址 可以正常释放
+void testZero()
+{
+    PoolAllocator<int> alloc;
+    int* ptr = alloc.allocate(0);
+    int* other = alloc.allocate(0);
+    assert(ptr != nullptr && other != nullptr && ptr != other);
+    alloc.deallocate(ptr, 0);
+    alloc.deallocate(other, 0);
+
+    struct alignas(64) Aligned { char c[64]; };
+    PoolAllocator<Aligned> alignedAlloc;
+    Aligned* aligned = alignedAlloc.allocate(0);
+    assert(aligned != nullptr && reinterpret_cast<uintptr_t>(aligned) % 64 == 0);
+    alignedAlloc.deallocate(aligned, 0);
+
+    std::vector<int, PoolAllocator<int>> v;
+    v.reserve(0);
+    v.shrink_to_fit();
+    assert(v.empty());
+}
+
+int main() {
+    testZero();
+
+    using StdPair = std::allocator<std::pair<const int, int>>;
+    using PoolPair = PoolAllocator<std::pair<const int, int>>;
+
+    std::cout << "\n===== PoolAllocator vs std::allocator =====\n";
+    compare("std::list", listTask<std::allocator<int>>, listTask<PoolAllocator<int>>);
+    compare("std::map", mapTask<StdPair>, mapTask<PoolPair>);
+    compare("std::unordered_map", unorderedMapTask<StdPair>, unorderedMapTask<PoolPair>);
+    return 0;
+}
@@ -0,0 +1,103 @@
+#include "MemoryPool.h"
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <cassert>
+
+using namespace memory_pool;
+
+constexpr int loopNums = 100000;
+constexpr int threadCount = 4;
+
+// 每个线程申请一批大小不同的内存后全部释放
+void threadTask(size_t seed)
+{
+    std::vector<std::pair<void*, size_t>> ptrs;
+    for (int i = 0; i < loopNums; ++i)
+    {
+        size_t size = ((i * 131 + seed) % 64 + 1) * 8;
+        ptrs.emplace_back(MemoryPool::allocate(size), size);
+        if (ptrs.size() >= 512)
+        {
+            for (auto& [p, s] : ptrs)
+                MemoryPool::deallocate(p, s);
+            ptrs.clear();
+        }
+    }
+    for (auto& [p, s] : ptrs)
+        MemoryPool::deallocate(p, s);
+}
+
+int main()
+{
+    std::vector<std::thread> threads;
+    for (int i = 0; i < threadCount; ++i)
+        threads.emplace_back(threadTask, i);
+    for (auto& t : threads)
+        t.join();
+
+    // 主线程保留一部分内存 以及页面缓存中的大内存
+    std::vector<void*> keep;
+    for (int i = 0; i < 100; ++i)
+        keep.push_back(MemoryPool::allocate(64));
+    void* big = MemoryPool::allocate(512 * 1024);
+    void* huge = MemoryPool::allocate(4 * 1024 * 1024);
+
+    PoolStats stats = MemoryPool::getStats();
+
+    size_t allocNums = 0;
+    size_t freeNums = 0;
+    for (const SizeClassStats& c : stats.sizeClasses)
+    {
+        allocNums += c.allocNums;
+        freeNums += c.freeNums;
+        // 每次未命中都对应一次批量申请
+        assert(c.cacheHits + c.refillNums == c.allocNums);
+        if (c.blockSize == 64)
+            assert(c.inUseBytes() == 100 * 64);
+        else
+            assert(c.inUseBytes() == 0);
+    }
+    // 已经退出的线程的计数也需要保留
+    assert(allocNums == threadCount * loopNums + 100);
+    assert(freeNums == threadCount * loopNums);
+    assert(stats.pageCache.mmapNums > 0);
+    assert(stats.pageCache.committedBytes >= 4 * 1024 * 1024 + 512 * 1024);
+
+    std::cout << stats.toString() << std::endl;
+    std::cout << stats.toJson() << std::endl;
+
+    MemoryPool::deallocate(huge, 4 * 1024 * 1024);
+    MemoryPool::deallocate(big, 512 * 1024);
+    for (void* p : keep)
+        MemoryPool::deallocate(p, 64);
+
+    PoolStats after = MemoryPool::getStats();
+    assert(after.pageCache.releasedBytes >= 4 * 1024 * 1024);
+    assert(after.pageCache.freeBytes >= stats.pageCache.freeBytes + 512 * 1024);
+
+    // 每个内存块大小的内存页尾部浪费都不超过1/8
+    for (size_t i = 0; i < FREE_LIST_SIZE; ++i)
+    {
+        size_t blockSize = SizeClass::getBlockSize(i);
+        size_t spanBytes = SizeClass::computeSpanPages(blockSize) * PAGE_SIZE;
+        assert(spanBytes >= blockSize);
+        assert(spanBytes % blockSize * 8 <= spanBytes);
+    }
+
+    // 4页只能切出2个5464字节的内存块 浪费三分之一 按表申请6页
+    void* mid = MemoryPool::allocate(5464);
+    for (const SizeClassStats& c : MemoryPool::getStats().sizeClasses)
+    {
+        if (c.blockSize == 5464)
+        {
+            assert(c.spanPages == 6 && c.spanNums == 1);
+            assert(c.spanWasteBytes == 6 * PAGE_SIZE % 5464);
+        }
+        assert(c.spanWasteBytes * 8 <= c.spanNums * c.spanPages * PAGE_SIZE);
+    }
+    MemoryPool::deallocate(mid, 5464);
+
+    std::cout << "pool stats test passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,124 @@
+#include "MemoryPool.h"
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <numeric>
+#include <cassert>
+#include <cstring>
+#include <cstdlib>
+
+using namespace memory_pool;
+using Clock = std::chrono::steady_clock;
+
+constexpr int repeatTimes = 10;
+constexpr size_t startSize = 64;
+constexpr size_t endSize = 64 * 1024 * 1024;
+
+// 检查前size字节是否仍然是写入时的内容
+void checkPattern(const char* ptr, size_t size)
+{
+    for (size_t i = 0; i < size; i += 97)
+        assert(ptr[i] == static_cast<char>(i % 127));
+}
+
+void fillPattern(char* ptr, size_t from, size_t to)
+{
+    for (size_t i = from; i < to; ++i)
+        ptr[i] = static_cast<char>(i % 127);
+}
+
+// 依次经过小内存块、页面缓存的大内存、直接映射的超大内存 扩大再缩小 数据都需要保留
+void testCorrectness()
+{
+    std::vector<size_t> sizes = {8, 16, 100, 4000, 200 * 1024, 300 * 1024, 600 * 1024,
+                                 2 * 1024 * 1024, 16 * 1024 * 1024, 700 * 1024, 300 * 1024, 64, 8};
+
+    char* ptr = static_cast<char*>(MemoryPool::allocate(sizes[0]));
+    fillPattern(ptr, 0, sizes[0]);
+    for (size_t i = 1; i < sizes.size(); ++i)
+    {
+        size_t oldSize = sizes[i - 1];
+        size_t newSize = sizes[i];
+        ptr = static_cast<char*>(MemoryPool::reallocate(ptr, oldSize, newSize));
+        assert(ptr != nullptr);
+        checkPattern(ptr, std::min(oldSize, newSize));
+        fillPattern(ptr, 0, newSize);
+    }
+    MemoryPool::deallocate(ptr, sizes.back());
+
+    // 同一个内存块大小内调整 地址不变
+    void* p = MemoryPool::allocate(17);
+    assert(MemoryPool::reallocate(p, 17, 24) == p);
+    MemoryPool::deallocate(p, 24);
+
+    // 右侧相邻内存页空闲时原地扩大
+    char* a = static_cast<char*>(MemoryPool::allocate(800 * 1024));
+    assert(MemoryPool::reallocate(a, 800 * 1024, 400 * 1024) == a);
+    assert(MemoryPool::reallocate(a, 400 * 1024, 700 * 1024) == a);
+    MemoryPool::deallocate(a, 700 * 1024);
+
+    std::cout << "reallocate correctness test passed\n";
+}
+
+// 按照1.5倍不断扩容 模拟vector/string的增长
+template<typename Grow, typename Free>
+int64_t growTask(Grow grow, Free release)
+{
+    auto start = Clock::now();
+    char* ptr = nullptr;
+    size_t size = 0;
+    for (size_t newSize = startSize; newSize <= endSize; newSize += newSize / 2)
+    {
+        ptr = static_cast<char*>(grow(ptr, size, newSize));
+        // 只写入新增的部分 与容器扩容后的写入方式相同
+        memset(ptr + size, 1, newSize - size);
+        size = newSize;
+    }
+    release(ptr, size);
+    auto end = Clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+}
+
+// 平均计算函数
+double computeAverage(const std::vector<double>& v) {
+    return std::accumulate(v.begin(), v.end(), 0.0) / v.size();
+}
+
+int main()
+{
+    testCorrectness();
+
+    auto poolRealloc = [](void* p, size_t oldSize, size_t newSize) {
+        return MemoryPool::reallocate(p, oldSize, newSize);
+    };
+    auto poolCopy = [](void* p, size_t oldSize, size_t newSize) {
+        void* newPtr = MemoryPool::allocate(newSize);
+        if (p)
+        {
+            memcpy(newPtr, p, oldSize);
+            MemoryPool::deallocate(p, oldSize);
+        }
+        return newPtr;
+    };
+    auto poolFree = [](void* p, size_t size) { MemoryPool::deallocate(p, size); };
+    auto sysRealloc = [](void* p, size_t, size_t newSize) { return realloc(p, newSize); };
+    auto sysFree = [](void* p, size_t) { free(p); };
+
+    std::vector<double> speedupCopy;
+    std::vector<double> speedupSys;
+    std::cout << "\n===== 扩容测试 " << startSize << "B -> " << endSize / 1024 / 1024 << "MB =====\n";
+    for (int i = 0; i < repeatTimes; ++i)
+    {
+        auto t_realloc = growTask(poolRealloc, poolFree);
+        auto t_copy = growTask(poolCopy, poolFree);
+        auto t_sys = growTask(sysRealloc, sysFree);
+        speedupCopy.push_back((t_copy - t_realloc) * 100.0 / t_copy);
+        speedupSys.push_back((t_sys - t_realloc) * 100.0 / t_sys);
+        std::cout << "Round " << i + 1 << ": reallocate = " << t_realloc << "us, allocate+copy = " << t_copy
+                  << "us, realloc = " << t_sys << "us\n";
+    }
+
+    std::cout << "Average speedup vs allocate+copy: " << computeAverage(speedupCopy) << "%\n";
+    std::cout << "Average speedup vs realloc: " << computeAverage(speedupSys) << "%\n";
+    return 0;
+}
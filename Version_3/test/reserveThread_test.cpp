@@ -0,0 +1,91 @@
+#include "MemoryPool.h"
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <thread>
+#include <cassert>
+
+using namespace memory_pool;
+using Clock = std::chrono::steady_clock;
+
+constexpr int allocNums = 2000;
+constexpr size_t allocSize = 128 * 1024;
+constexpr size_t lowBytes = 16 * 1024 * 1024;
+constexpr size_t highBytes = 64 * 1024 * 1024;
+
+struct PhaseResult
+{
+    size_t systemAllocNums;
+    double p50Us;
+    double p999Us;
+    double maxUs;
+};
+
+// 持续增长的工作集 每次申请的大内存都需要新的内存页 申请之间模拟请求处理的间隔
+PhaseResult runPhase(std::vector<void*>& keep)
+{
+    std::vector<double> latencies;
+    latencies.reserve(allocNums);
+    size_t systemAllocNums = MemoryPool::getStats().pageCache.systemAllocNums;
+
+    for (int i = 0; i < allocNums; ++i)
+    {
+        auto start = Clock::now();
+        void* ptr = MemoryPool::allocate(allocSize);
+        latencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+        memset(ptr, 0, allocSize);
+        keep.push_back(ptr);
+
+        auto until = Clock::now() + std::chrono::microseconds(100);
+        while (Clock::now() < until)
+            ;
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    PhaseResult result;
+    result.systemAllocNums = MemoryPool::getStats().pageCache.systemAllocNums - systemAllocNums;
+    result.p50Us = latencies[latencies.size() / 2];
+    result.p999Us = latencies[latencies.size() * 999 / 1000];
+    result.maxUs = latencies.back();
+    return result;
+}
+
+int main()
+{
+    std::vector<void*> keep;
+
+    PhaseResult lazy = runPhase(keep);
+
+    MemoryPool::setReserveWatermark(lowBytes, highBytes);
+    // 等待第一次补充到高水位
+    while (MemoryPool::getStats().pageCache.freeBytes < highBytes)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    PhaseResult reserved = runPhase(keep);
+
+    PoolStats stats = MemoryPool::getStats();
+    assert(stats.pageCache.reserveNums > 0);
+    // 后台线程跟得上时申请线程几乎不再同步mmap
+    assert(reserved.systemAllocNums * 4 < lazy.systemAllocNums);
+
+    std::cout << allocNums << " allocations of " << allocSize / 1024 << " KB" << std::endl;
+    std::cout << "lazy:     system allocs=" << lazy.systemAllocNums << " p50=" << lazy.p50Us << " us p999=" << lazy.p999Us
+              << " us max=" << lazy.maxUs << " us" << std::endl;
+    std::cout << "reserved: system allocs=" << reserved.systemAllocNums << " p50=" << reserved.p50Us << " us p999=" << reserved.p999Us
+              << " us max=" << reserved.maxUs << " us" << std::endl;
+
+    for (void* ptr : keep)
+        MemoryPool::deallocate(ptr, allocSize);
+
+    // 关闭之后停止后台线程
+    MemoryPool::setReserveWatermark(0, 0);
+    size_t reserveNums = MemoryPool::getStats().pageCache.reserveNums;
+    for (int i = 0; i < 1000; ++i)
+        keep[i] = MemoryPool::allocate(allocSize);
+    assert(MemoryPool::getStats().pageCache.reserveNums == reserveNums);
+    for (int i = 0; i < 1000; ++i)
+        MemoryPool::deallocate(keep[i], allocSize);
+
+    std::cout << "reserve thread test passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,78 @@
+#include "MemoryPool.h"
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cassert>
+
+using namespace memory_pool;
+
+constexpr size_t reserveBytes = 64 * 1024 * 1024;
+constexpr int loopNums = 200000;
+
+const SizeClassStats* findClass(const PoolStats& stats, size_t blockSize)
+{
+    for (const SizeClassStats& c : stats.sizeClasses)
+        if (c.blockSize == blockSize)
+            return &c;
+    return nullptr;
+}
+
+int main()
+{
+    // 启动阶段: 预留内存页并预热线程缓存
+    auto start = std::chrono::high_resolution_clock::now();
+    assert(MemoryPool::reserve(reserveBytes));
+    MemoryPool::prewarm({{64, 2000}, {256, 500}, {4096, 100}, {MAX_BYTES + 1, 1}});
+    auto startupTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    PoolStats before = MemoryPool::getStats();
+    assert(before.pageCache.freeBytes >= reserveBytes - 2 * 1024 * 1024);
+    const SizeClassStats* prewarmed = findClass(before, 64);
+    assert(prewarmed && prewarmed->refillNums == 0 && prewarmed->threadCachedBytes >= 2000 * 64);
+
+    // 运行阶段: 预热的大小全部命中线程缓存 释放时也不会归还给中心缓存
+    std::vector<void*> ptrs;
+    for (int round = 0; round < 10; ++round)
+    {
+        for (int i = 0; i < 2000; ++i)
+            ptrs.push_back(MemoryPool::allocate(64));
+        for (void* ptr : ptrs)
+            MemoryPool::deallocate(ptr, 64);
+        ptrs.clear();
+    }
+    PoolStats after = MemoryPool::getStats();
+    const SizeClassStats* after64 = findClass(after, 64);
+    assert(after64->refillNums == 0 && after64->returnNums == 0);
+
+    // 其他小于HUGE_BYTES的大小从预留的内存页中分割 不再调用mmap
+    std::vector<std::pair<void*, size_t>> mixed;
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < loopNums; ++i)
+    {
+        size_t size = (i % 7 == 0) ? (i % 64 + 1) * 8 * 1024 : (i * 131 % 1024 + 1) * 8;
+        mixed.emplace_back(MemoryPool::allocate(size), size);
+        memset(mixed.back().first, 0, size);
+        if (mixed.size() >= 256)
+        {
+            for (auto& [p, s] : mixed)
+                MemoryPool::deallocate(p, s);
+            mixed.clear();
+        }
+    }
+    for (auto& [p, s] : mixed)
+        MemoryPool::deallocate(p, s);
+    auto steadyTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    PoolStats steady = MemoryPool::getStats();
+    assert(steady.pageCache.mmapNums == before.pageCache.mmapNums);
+
+    // mlock受RLIMIT_MEMLOCK限制 失败时内存页仍然可以使用
+    bool locked = MemoryPool::reserve(1024 * 1024, true);
+
+    std::cout << "reserve + prewarm: " << startupTime << " ms" << std::endl;
+    std::cout << loopNums << " steady-state allocations: " << steadyTime << " ms, mmaps "
+              << before.pageCache.mmapNums << " -> " << steady.pageCache.mmapNums << std::endl;
+    std::cout << "mlock " << (locked ? "succeeded" : "failed (RLIMIT_MEMLOCK)") << std::endl;
+    std::cout << "reserve test passed" << std::endl;
+    return 0;
+}
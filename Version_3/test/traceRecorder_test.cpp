@@ -0,0 +1,100 @@
+#include "MemoryPool.h"
+#include "PoolAllocator.h"
+#include "TraceRecorder.h"
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <list>
+#include <thread>
+#include <unordered_map>
+#include <cassert>
+
+using namespace memory_pool;
+
+constexpr int threadNums = 4;
+constexpr int rounds = 20000;
+const char* tracePath = "/tmp/memory_pool_trace.bin";
+
+void threadTask(int id)
+{
+    std::vector<std::pair<void*, size_t>> ptrs;
+    for (int i = 0; i < rounds; ++i)
+    {
+        size_t size = 8 + (i * 7 + id) % 1024;
+        ptrs.emplace_back(MemoryPool::allocate(size), size);
+        if (i % 3 == 2)
+        {
+            MemoryPool::deallocate(ptrs.back().first, ptrs.back().second);
+            ptrs.pop_back();
+        }
+    }
+    for (auto& [ptr, size] : ptrs)
+        MemoryPool::deallocate(ptr, size);
+
+    std::list<int, PoolAllocator<int>> nodes;
+    for (int i = 0; i < 100; ++i)
+        nodes.push_back(i);
+}
+
+int main()
+{
+    TraceRecorder* recorder = TraceRecorder::Instance();
+    bool opened = recorder->start(tracePath);
+    assert(opened);
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < threadNums; ++i)
+        threads.emplace_back(threadTask, i);
+    for (auto& t : threads)
+        t.join();
+    recorder->stop();
+
+    // 读回文件 检查每个线程的记录数量以及申请释放能一一对应
+    std::ifstream file(tracePath, std::ios::binary);
+    TraceFileHeader header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    assert(file && std::equal(header.magic, header.magic + 8, TRACE_MAGIC));
+    assert(header.version == TRACE_VERSION && header.recordSize == sizeof(TraceRecord));
+
+    std::unordered_map<uint32_t, size_t> threadRecords;
+    std::unordered_map<uint32_t, uint64_t> lastTimestamp;
+    std::unordered_map<uint64_t, int> live;
+    size_t allocNums = 0;
+    size_t freeNums = 0;
+    TraceChunkHeader chunk;
+    while (file.read(reinterpret_cast<char*>(&chunk), sizeof(chunk)))
+    {
+        std::vector<TraceRecord> records(chunk.recordNums);
+        file.read(reinterpret_cast<char*>(records.data()), sizeof(TraceRecord) * chunk.recordNums);
+        assert(file);
+        for (const TraceRecord& record : records)
+        {
+            // 同一个线程的记录按照时间顺序写入
+            assert(record.timestamp >= lastTimestamp[chunk.threadId]);
+            lastTimestamp[chunk.threadId] = record.timestamp;
+            if (record.op == TRACE_ALLOCATE)
+            {
+                allocNums++;
+                live[record.ptr]++;
+            }
+            else
+            {
+                freeNums++;
+                live[record.ptr]--;
+            }
+        }
+        threadRecords[chunk.threadId] += chunk.recordNums;
+    }
+
+    // 每个线程: rounds次申请 rounds次释放 100个链表节点的申请和释放
+    assert(threadRecords.size() == threadNums);
+    for (auto& [threadId, count] : threadRecords)
+        assert(count == 2 * rounds + 200);
+    assert(allocNums == freeNums);
+    for (auto& [ptr, count] : live)
+        assert(count == 0);
+
+    std::cout << "trace records: " << allocNums + freeNums << " from " << threadRecords.size() << " threads" << std::endl;
+    std::cout << "traceRecorder test passed" << std::endl;
+    return 0;
+}